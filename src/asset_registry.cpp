@@ -1,143 +1,413 @@
-#include <fstream>
+#include <algorithm>
+#include <cmath>
 #include <spdlog/spdlog.h>
 #include <json.hpp>
 #include <ECS.h>
 #include "asset_registry.h"
 #include "game.h"
+#include "file_utils.h"
+#include "job_system.h"
+#include "spec_cache.h"
+#include "texture_cache.h"
+
+namespace Archipelago {
+
+	const unsigned int placeholderTextureSize{ 16 }; /// pixels, repeated over the texture rect of whatever waits for its texture
+	const sf::Color placeholderTextureColor{ 128, 128, 128, 96 };
+
+	/// Image decoded on a worker, turned into a texture on the game thread
+	struct DecodedImage {
+		sf::Image image;
+		bool isDecoded{ false };
+	};
+
+}
 
 using namespace Archipelago;
 
+namespace {
+
+	/** Index of specification in its atlas. Specification files and generated spec_ids.h must agree on ids and keys,
+	* otherwise the header is stale and game code would mix up types. Returns 0 then
+	*/
+	size_t generatedIdIndex(const nlohmann::json& spec, size_t count, const char* const keys[], const std::string& filename) {
+		int id = spec.at("id").get<int>();
+		std::string key = spec.value("key", std::string());
+		if (id < 1 || static_cast<size_t>(id) >= count || key != keys[id]) {
+			spdlog::get(loggerName)->error("Specification '{}' with id {} in '{}' isn't in spec_ids.h, run the game with --generate-spec-ids and rebuild", key, id, filename);
+			return 0;
+		}
+		return static_cast<size_t>(id);
+	}
+
+	/// Icon of a specification is registered as a texture named after it
+	void addIcon(const nlohmann::json& spec, texture_list_t& icons) {
+		icons.emplace_back(spec.at("name").get<std::string>(), spec.at("icon").get<std::string>());
+	}
+
+	void parseWares(const nlohmann::json& stacks, std::vector<WaresStack>& wares) {
+		for (const auto& stack : stacks) {
+			WaresStack ws;
+			ws.type = static_cast<WaresTypeId>(stack.at("type").get<int>());
+			ws.amount = stack.at("amount").get<int>();
+			wares.push_back(ws);
+		}
+	}
+
+	bool parseSpecifications(const nlohmann::json& specsJSON, const std::string& filename, wares_atlas_t& atlas, texture_list_t& icons) {
+		for (const auto& waresSpec : specsJSON) {
+			size_t index = generatedIdIndex(waresSpec, waresTypeCount, waresTypeKeys, filename);
+			if (index == 0) return false;
+			atlas[index].name = waresSpec.at("name").get<std::string>();
+			addIcon(waresSpec, icons);
+			spdlog::get(loggerName)->trace("Wares Specification loaded: '{}'", atlas[index].name);
+		}
+		return true;
+	}
+
+	bool parseSpecifications(const nlohmann::json& specsJSON, const std::string& filename, natres_atlas_t& atlas, texture_list_t& icons) {
+		for (const auto& natresSpec : specsJSON) {
+			size_t index = generatedIdIndex(natresSpec, naturalResourceTypeCount, naturalResourceTypeKeys, filename);
+			if (index == 0) return false;
+			atlas[index].name = natresSpec.at("name").get<std::string>();
+			addIcon(natresSpec, icons);
+			spdlog::get(loggerName)->trace("Natural resources specification loaded: '{}'", atlas[index].name);
+		}
+		return true;
+	}
+
+	bool parseSpecifications(const nlohmann::json& specsJSON, const std::string& filename, buildings_atlas_t& atlas, texture_list_t& icons) {
+		for (const auto& buildingSpec : specsJSON) {
+			size_t index = generatedIdIndex(buildingSpec, buildingTypeCount, buildingTypeKeys, filename);
+			if (index == 0) return false;
+			BuildingSpecification& bs = atlas[index];
+			bs.id = static_cast<BuildingTypeId>(index);
+			bs.name = buildingSpec.at("name").get<std::string>();
+			bs.description = buildingSpec.at("description").get<std::string>();
+			bs.tileRising = buildingSpec.at("tile_rising");
+			bs.maxAllowedOnMap = buildingSpec.at("max_allowed_on_map");
+			bs.natresRequired = static_cast<NaturalResourceTypeId>(buildingSpec.at("natres_required").get<int>());
+			bs.natresRadius = buildingSpec.value("natres_radius", 0u);
+			bs.isStorage = buildingSpec.value("storage", false);
+			bs.workers = buildingSpec.value("workers", 0u);
+			parseWares(buildingSpec.at("wares_required"), bs.waresRequired);
+			for (const auto& br : buildingSpec.at("building_required")) {
+				bs.buildingsRequired.push_back(static_cast<BuildingTypeId>(br.get<int>()));
+			}
+			parseWares(buildingSpec.at("provided_instant_wares"), bs.providedInstantWares);
+			parseWares(buildingSpec.at("wares_produced"), bs.waresProduced);
+			// Optional, fractional amounts are allowed: a building may need half a ware a month
+			auto consumed = buildingSpec.find("wares_consumed");
+			if (consumed != buildingSpec.end()) {
+				for (const auto& wareCons : *consumed) {
+					WaresStack ws;
+					ws.type = static_cast<WaresTypeId>(wareCons.at("type").get<int>());
+					ws.amount = static_cast<int>(std::lround(wareCons.at("amount").get<double>() * consumedWaresScale));
+					bs.waresConsumed.push_back(ws);
+				}
+			}
+			addIcon(buildingSpec, icons);
+			spdlog::get(loggerName)->trace("Building specification loaded: '{}'", bs.name);
+		}
+		return true;
+	}
+
+	enum class SpecFileStatus { Loaded, Unreadable, Malformed };
+
+	/** Fills atlas from specification file, from its binary cache if file didn't change since the cache was written.
+	* Touches nothing but its arguments and the cache file, so it may run on any thread
+	*/
+	template<typename Atlas>
+	SpecFileStatus readSpecificationFile(const std::string& filename, Atlas& atlas, texture_list_t& icons) {
+		std::vector<char> source;
+		if (!FileUtils::readFile(filename, source)) return SpecFileStatus::Unreadable;
+		uint64_t sourceHash = hashSpecSource(source);
+		if (loadSpecCache(filename, sourceHash, atlas, icons)) {
+			spdlog::get(loggerName)->trace("Specifications of '{}' loaded from cache", filename);
+			return SpecFileStatus::Loaded;
+		}
+		atlas = Atlas{};
+		icons.clear();
+		try {
+			if (!parseSpecifications(nlohmann::json::parse(source.begin(), source.end()), filename, atlas, icons)) {
+				return SpecFileStatus::Malformed;
+			}
+		}
+		catch (std::exception& e) {
+			spdlog::get(loggerName)->error("AssetRegistry: Can't parse specifications '{}': {}", filename, e.what());
+			return SpecFileStatus::Malformed;
+		}
+		if (!saveSpecCache(filename, sourceHash, atlas, icons)) {
+			spdlog::get(loggerName)->warn("AssetRegistry: Can't write specification cache of '{}'", filename);
+		}
+		return SpecFileStatus::Loaded;
+	}
+
+	/// Startup has no specifications to fall back to: unreadable file leaves atlas empty, malformed one ends the game
+	template<typename Atlas>
+	bool readStartupSpecificationFile(const std::string& filename, Atlas& atlas, texture_list_t& icons) {
+		SpecFileStatus status = readSpecificationFile(filename, atlas, icons);
+		if (status == SpecFileStatus::Malformed) exit(-1);
+		return status == SpecFileStatus::Loaded;
+	}
+
+}
+
+AssetRegistry::~AssetRegistry() {
+	// Decoding jobs only hold their own image, but they shouldn't outlive the registry which asked for them
+	for (TextureHandle handle : _loadingTextures) {
+		_jobSystem->wait(_textureAtlas[handle].loadJob);
+	}
+}
+
+TextureHandle AssetRegistry::registerTexture(const std::string& assetName, const std::string& filename) {
+	auto known = _textureHandles.find(assetName);
+	if (known != _textureHandles.end()) return known->second;
+	_textureAtlas.emplace_back();
+	_textureAtlas.back().fileName = filename;
+	TextureHandle handle = static_cast<TextureHandle>(_textureAtlas.size() - 1);
+	_textureHandles.emplace(assetName, handle);
+	return handle;
+}
+
 void AssetRegistry::loadTexture(const std::string& assetName, const std::string& filename) {
-	sf::Texture texture;
-	if (!texture.loadFromFile(filename)) {
-		spdlog::get(loggerName)->trace("Error loading texture '{}' from file '{}'", assetName, filename);
-		return;
-	};
-	_textureAtlas.insert(std::pair<std::string, sf::Texture>(assetName, std::move(texture)));
-	spdlog::get(loggerName)->trace("Loaded texture '{}' from file '{}', size {}x{}", assetName, filename, texture.getSize().x, texture.getSize().y);
+	loadTextures(texture_list_t{ { assetName, filename } });
+}
+
+void AssetRegistry::loadTextures(const texture_list_t& textures) {
+	std::vector<TextureHandle> handles;
+	handles.reserve(textures.size());
+	for (const auto& texture : textures) {
+		handles.push_back(registerTexture(texture.first, texture.second));
+	}
+	loadTextures(handles);
+	for (TextureHandle handle : handles) {
+		TextureSlot& slot = _textureAtlas[handle];
+		if (slot.isResident && !slot.isPinned) {
+			slot.isPinned = true;
+			_residentBytes -= static_cast<size_t>(slot.texture.getSize().x) * slot.texture.getSize().y * 4;
+		}
+	}
 	spdlog::get(loggerName)->trace("Texture atlas contains {} textures", _textureAtlas.size());
 }
 
+void AssetRegistry::loadTextures(const std::vector<TextureHandle>& handles) {
+	// Only decoding is parallel, textures have to be created on the thread owning the GL context
+	std::vector<TextureHandle> pending;
+	for (TextureHandle handle : handles) {
+		if (handle >= _textureAtlas.size()) continue;
+		TextureSlot& slot = _textureAtlas[handle];
+		if (slot.isResident || slot.isMissing) continue;
+		if (slot.loadJob) {
+			_jobSystem->wait(slot.loadJob);
+			_finishTexture(handle);
+			continue;
+		}
+		if (slot.decoded) continue; // handle listed twice, e.g. an icon shared by several specifications
+		slot.decoded = std::make_shared<DecodedImage>();
+		pending.push_back(handle);
+	}
+	auto decode = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			TextureSlot& slot = _textureAtlas[pending[i]];
+			slot.decoded->isDecoded = loadCachedImage(slot.fileName, slot.decoded->image);
+		}
+	};
+	if (_jobSystem) {
+		_jobSystem->parallelFor(pending.size(), 1, decode);
+	}
+	else {
+		decode(0, pending.size());
+	}
+	for (TextureHandle handle : pending) {
+		_finishTexture(handle);
+	}
+}
+
+TextureHandle AssetRegistry::findTexture(const std::string& textureName) const {
+	auto m = _textureHandles.find(textureName);
+	return m != _textureHandles.end() ? m->second : noTextureHandle;
+}
+
+sf::Texture* AssetRegistry::getTexture(TextureHandle handle) {
+	if (handle >= _textureAtlas.size()) return nullptr;
+	TextureSlot& slot = _textureAtlas[handle];
+	if (!slot.isResident) {
+		loadTextures(std::vector<TextureHandle>{ handle });
+	}
+	slot.lastUsedFrame = _frame;
+	return slot.isResident ? &slot.texture : nullptr;
+}
+
 sf::Texture* AssetRegistry::getTexture(const std::string& textureName) {
-	auto m = _textureAtlas.find(textureName);
-	if (m != _textureAtlas.end()) {
-		return &(m->second);
+	TextureHandle handle = findTexture(textureName);
+	if (handle == noTextureHandle) {
+		spdlog::get(loggerName)->error("Texture '{}' not found in registry", textureName);
+		return nullptr;
 	}
-	std::string s("Texture '" + textureName + "' not found in registry");
-	spdlog::get(loggerName)->error(s);
-	return nullptr;
+	return getTexture(handle);
 }
 
-void AssetRegistry::prepareWaresAtlas() {
-	spdlog::get(loggerName)->trace("AssetRegistry::prepareWaresAtlas started...");
-	std::string filename("assets/wares_specification.json");
-	nlohmann::json waresSpecJSON;
-	std::fstream waresSpecFile;
-	waresSpecFile.open(filename);
-	if (waresSpecFile.fail()) {
-		spdlog::get(loggerName)->error("AssetRegistry::prepareWaresAtlas failed. Error opening specification file '{}'", filename);
+const sf::Texture& AssetRegistry::useTexture(TextureHandle handle) {
+	if (handle >= _textureAtlas.size()) return _getPlaceholderTexture();
+	TextureSlot& slot = _textureAtlas[handle];
+	slot.lastUsedFrame = _frame;
+	if (slot.isResident) return slot.texture;
+	if (!slot.loadJob && !slot.isMissing) {
+		_requestTexture(handle);
+		if (slot.isResident) return slot.texture;
+	}
+	return _getPlaceholderTexture();
+}
+
+void AssetRegistry::endFrame() {
+	for (size_t i = 0; i < _loadingTextures.size();) {
+		TextureHandle handle = _loadingTextures[i];
+		const std::shared_ptr<Job>& job = _textureAtlas[handle].loadJob;
+		// Without workers nobody else runs queued jobs
+		if (!job->isDone() && _jobSystem->getWorkerCount() == 0) {
+			_jobSystem->wait(job);
+		}
+		if (job->isDone()) {
+			_finishTexture(handle); // removes it from _loadingTextures
+		}
+		else {
+			i++;
+		}
+	}
+	if (_residentBytes > _textureBudget) {
+		_evictTextures();
+	}
+	_frame++;
+}
+
+void AssetRegistry::_requestTexture(TextureHandle handle) {
+	TextureSlot& slot = _textureAtlas[handle];
+	slot.decoded = std::make_shared<DecodedImage>();
+	if (!_jobSystem) {
+		slot.decoded->isDecoded = loadCachedImage(slot.fileName, slot.decoded->image);
+		_finishTexture(handle);
+		return;
+	}
+	// Job gets its own references, slot may be evicted or the registry gone by the time it runs
+	std::shared_ptr<DecodedImage> decoded = slot.decoded;
+	std::string fileName = slot.fileName;
+	slot.loadJob = _jobSystem->schedule([decoded, fileName]() {
+		decoded->isDecoded = loadCachedImage(fileName, decoded->image);
+	});
+	_loadingTextures.push_back(handle);
+}
+
+void AssetRegistry::_finishTexture(TextureHandle handle) {
+	TextureSlot& slot = _textureAtlas[handle];
+	if (slot.loadJob) {
+		slot.loadJob.reset();
+		_loadingTextures.erase(std::find(_loadingTextures.begin(), _loadingTextures.end(), handle));
+	}
+	std::shared_ptr<DecodedImage> decoded = std::move(slot.decoded);
+	if (!decoded->isDecoded || !slot.texture.loadFromImage(decoded->image)) {
+		spdlog::get(loggerName)->error("Error loading texture from file '{}'", slot.fileName);
+		slot.isMissing = true;
 		return;
 	}
-	waresSpecFile >> waresSpecJSON;
-	waresSpecFile.close();
-	try {
-		for (auto waresSpec : waresSpecJSON) {
-			WaresSpecification gs;
-			gs.name = std::move(waresSpec.at("name").get<std::string>());
-			loadTexture(waresSpec.at("name"), waresSpec.at("icon"));
-			gs.icon = getTexture(waresSpec.at("name"));
-			_wareAtlas.insert(std::pair<WaresTypeId, Archipelago::WaresSpecification>(static_cast<WaresTypeId>(waresSpec.at("id").get<int>()), std::move(gs)));
-			spdlog::get(loggerName)->trace("Wares Specification loaded: '{}'", (waresSpec.at("name")).get<std::string>());
+	slot.isResident = true;
+	if (!slot.isPinned) {
+		_residentBytes += static_cast<size_t>(slot.texture.getSize().x) * slot.texture.getSize().y * 4;
+	}
+	spdlog::get(loggerName)->trace("Loaded texture from file '{}', size {}x{}", slot.fileName, slot.texture.getSize().x, slot.texture.getSize().y);
+}
+
+void AssetRegistry::_evictTextures() {
+	// Textures used this frame are still being drawn, everything older goes least recently used first
+	_evictionCandidates.clear();
+	for (TextureHandle handle = 0; handle < _textureAtlas.size(); handle++) {
+		const TextureSlot& slot = _textureAtlas[handle];
+		if (slot.isResident && !slot.isPinned && slot.lastUsedFrame < _frame) {
+			_evictionCandidates.push_back(handle);
 		}
 	}
-	catch (std::out_of_range& e) {
-		spdlog::get(loggerName)->error("AssetRegistry::prepareWaresAtlas: Can't parse wares specifications: {}", e.what());
-		exit(-1);
+	std::sort(_evictionCandidates.begin(), _evictionCandidates.end(), [this](TextureHandle a, TextureHandle b) {
+		return _textureAtlas[a].lastUsedFrame < _textureAtlas[b].lastUsedFrame;
+	});
+	for (TextureHandle handle : _evictionCandidates) {
+		if (_residentBytes <= _textureBudget) break;
+		TextureSlot& slot = _textureAtlas[handle];
+		_residentBytes -= static_cast<size_t>(slot.texture.getSize().x) * slot.texture.getSize().y * 4;
+		slot.texture = sf::Texture();
+		slot.isResident = false;
+		spdlog::get(loggerName)->trace("Evicted texture '{}', {} bytes of textures resident", slot.fileName, _residentBytes);
+	}
+}
+
+const sf::Texture& AssetRegistry::_getPlaceholderTexture() {
+	if (_placeholderTexture.getSize().x == 0) {
+		sf::Image image;
+		image.create(placeholderTextureSize, placeholderTextureSize, placeholderTextureColor);
+		_placeholderTexture.loadFromImage(image);
+		_placeholderTexture.setRepeated(true);
+	}
+	return _placeholderTexture;
+}
+
+void AssetRegistry::prepareWaresAtlas() {
+	spdlog::get(loggerName)->trace("AssetRegistry::prepareWaresAtlas started...");
+	std::string filename(waresSpecificationFileName);
+	texture_list_t icons;
+	if (!readStartupSpecificationFile(filename, _wareAtlas, icons)) {
+		spdlog::get(loggerName)->error("AssetRegistry::prepareWaresAtlas failed. Error opening specification file '{}'", filename);
+		return;
 	}
-	spdlog::get(loggerName)->trace("Wares atlas contains {} wares specifications", _wareAtlas.size());
+	_resolveIcons(_wareAtlas, icons);
+	spdlog::get(loggerName)->trace("Wares atlas contains {} wares specifications", waresTypeCount - 1);
 }
 
 void AssetRegistry::prepareNaturalResourcesAtlas() {
 	spdlog::get(loggerName)->trace("AssetRegistry::prepareNaturalResourcesAtlas started...");
-	std::string filename("assets/natural_resources_specification.json");
-	nlohmann::json natresSpecJSON;
-	std::fstream natresSpecFile;
-	natresSpecFile.open(filename);
-	if (natresSpecFile.fail()) {
+	std::string filename(naturalResourcesSpecificationFileName);
+	texture_list_t icons;
+	if (!readStartupSpecificationFile(filename, _natresAtlas, icons)) {
 		spdlog::get(loggerName)->error("AssetRegistry::prepareNaturalResourcesAtlas failed. Error opening specification file '{}'", filename);
 		return;
 	}
-	natresSpecFile >> natresSpecJSON;
-	natresSpecFile.close();
-	try {
-		for (auto natresSpec : natresSpecJSON) {
-			NaturalResourceSpecification nrs;
-			nrs.name = std::move(natresSpec.at("name").get<std::string>());
-			loadTexture(natresSpec.at("name"), natresSpec.at("icon"));
-			nrs.icon = getTexture(natresSpec.at("name"));
-			_natresAtlas.insert(std::pair<NaturalResourceTypeId, Archipelago::NaturalResourceSpecification>(static_cast<NaturalResourceTypeId>(natresSpec.at("id").get<int>()), std::move(nrs)));
-			spdlog::get(loggerName)->trace("Natural resources specification loaded: '{}'", (natresSpec.at("name")).get<std::string>());
-		}
-	}
-	catch (std::out_of_range& e) {
-		spdlog::get(loggerName)->error("AssetRegistry::prepareNaturalResourcesAtlas: Can't parse natural resources specifications: {}", e.what());
-		exit(-1);
-	}
-	spdlog::get(loggerName)->trace("Natural resources atlas contains {} natural resources specifications", _natresAtlas.size());
+	_resolveIcons(_natresAtlas, icons);
+	spdlog::get(loggerName)->trace("Natural resources atlas contains {} natural resources specifications", naturalResourceTypeCount - 1);
 }
 
 void AssetRegistry::prepareBuildingAtlas() {
 	spdlog::get(loggerName)->trace("AssetRegistry::prepareBuildingAtlas started...");
-	std::string filename("assets/buildings_specification.json");
-	nlohmann::json buildingSpecJSON;
-	std::fstream buildingSpecFile;
-	buildingSpecFile.open(filename);
-	if (buildingSpecFile.fail()) {
+	std::string filename(buildingsSpecificationFileName);
+	texture_list_t icons;
+	if (!readStartupSpecificationFile(filename, _buildingAtlas, icons)) {
 		spdlog::get(loggerName)->error("AssetRegistry::prepareBuildingAtlas failed. Error opening specification file '{}'", filename);
 		return;
 	}
-	buildingSpecFile >> buildingSpecJSON;
-	buildingSpecFile.close();
-	try {
-		for (auto buildingSpec : buildingSpecJSON) {
-			BuildingSpecification bs;
-			bs.id = static_cast<BuildingTypeId>(buildingSpec.at("id").get<int>());
-			bs.name = std::move(buildingSpec.at("name").get<std::string>());
-			bs.description = std::move(buildingSpec.at("description").get<std::string>());
-			loadTexture(buildingSpec.at("name"), buildingSpec.at("icon"));
-			bs.icon = getTexture(buildingSpec.at("name"));
-			bs.tileRising = buildingSpec.at("tile_rising");
-			bs.maxAllowedOnMap = buildingSpec.at("max_allowed_on_map");
-			bs.natresRequired = static_cast<NaturalResourceTypeId>(buildingSpec.at("natres_required").get<int>());
-			for (auto wareReq : buildingSpec.at("wares_required")) {
-				WaresStack ws;
-				ws.type = static_cast<WaresTypeId>(wareReq.at("type").get<int>());
-				ws.amount = wareReq.at("amount").get<int>();
-				bs.waresRequired.push_back(ws);
-			}
-			std::vector<int> briv = std::move(buildingSpec.at("building_required").get<std::vector<int>>());
-			for (auto br : briv) {
-				bs.buildingsRequired.push_back(static_cast<BuildingTypeId>(br));
-			}
-			for (auto providedInstantWare : buildingSpec.at("provided_instant_wares")) {
-				WaresStack ws;
-				ws.type = static_cast<WaresTypeId>(providedInstantWare.at("type").get<int>());
-				ws.amount = providedInstantWare.at("amount").get<int>();
-				bs.providedInstantWares.push_back(ws);
-			}
-			for (auto wareProd : buildingSpec.at("wares_produced")) {
-				WaresStack ws;
-				ws.type = static_cast<WaresTypeId>(wareProd.at("type").get<int>());
-				ws.amount = wareProd.at("amount").get<int>();
-				bs.waresProduced.push_back(ws);
-			}
-			_buildingAtlas.insert(std::pair<BuildingTypeId, Archipelago::BuildingSpecification>(bs.id, std::move(bs)));
-			spdlog::get(loggerName)->trace("Building specification loaded: '{}'", (buildingSpec.at("name")).get<std::string>());
-		}
-	}
-	catch (std::out_of_range& e) {
-		spdlog::get(loggerName)->error("AssetRegistry::prepareBuildingAtlas: Can't parse building specifications: {}", e.what());
-		exit(-1);
-	}
-	spdlog::get(loggerName)->trace("Natural resources atlas contains {} building specifications", _natresAtlas.size());
-}
\ No newline at end of file
+	_resolveIcons(_buildingAtlas, icons);
+	spdlog::get(loggerName)->trace("Building atlas contains {} building specifications", buildingTypeCount - 1);
+}
+
+bool AssetRegistry::parseSpecificationFile(const std::string& filename, wares_atlas_t& atlas, texture_list_t& icons) {
+	return readSpecificationFile(filename, atlas, icons) == SpecFileStatus::Loaded;
+}
+
+bool AssetRegistry::parseSpecificationFile(const std::string& filename, natres_atlas_t& atlas, texture_list_t& icons) {
+	return readSpecificationFile(filename, atlas, icons) == SpecFileStatus::Loaded;
+}
+
+bool AssetRegistry::parseSpecificationFile(const std::string& filename, buildings_atlas_t& atlas, texture_list_t& icons) {
+	return readSpecificationFile(filename, atlas, icons) == SpecFileStatus::Loaded;
+}
+
+void AssetRegistry::replaceSpecifications(wares_atlas_t& atlas, const texture_list_t& icons) {
+	_replaceSpecifications(_wareAtlas, atlas, icons);
+	spdlog::get(loggerName)->info("Wares specifications reloaded");
+}
+
+void AssetRegistry::replaceSpecifications(natres_atlas_t& atlas, const texture_list_t& icons) {
+	_replaceSpecifications(_natresAtlas, atlas, icons);
+	spdlog::get(loggerName)->info("Natural resources specifications reloaded");
+}
+
+void AssetRegistry::replaceSpecifications(buildings_atlas_t& atlas, const texture_list_t& icons) {
+	_replaceSpecifications(_buildingAtlas, atlas, icons);
+	spdlog::get(loggerName)->info("Building specifications reloaded");
+}
@@ -1,40 +1,144 @@
 #ifndef ASSET_REGISTRY_H
 #define ASSET_REGISTRY_H
 
+#include <array>
+#include <cstdint>
+#include <deque>
 #include <memory>
-#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <SFML/Graphics.hpp>
 #include "natural_resources_specification.h"
 #include "wares_specification.h"
 #include "building_specification.h"
+#include "texture_handle.h"
 
 namespace Archipelago {
 
-	typedef std::map<std::string, sf::Texture> texture_atlas_t;
-	typedef std::map<WaresTypeId, Archipelago::WaresSpecification> wares_atlas_t;
-	typedef std::map<NaturalResourceTypeId, Archipelago::NaturalResourceSpecification> natres_atlas_t;
-	typedef std::map<BuildingTypeId, Archipelago::BuildingSpecification> buildings_atlas_t;
+	const size_t textureBudgetDefault{ 256 * 1024 * 1024 }; /// bytes of evictable textures kept resident
+
+	class Job;
+	struct DecodedImage;
+
+	/// Texture behind a handle. Slots never move, so sprites may point at their texture while it is resident
+	struct TextureSlot {
+		std::string fileName;
+		sf::Texture texture; // empty while not resident
+		bool isResident{ false };
+		bool isPinned{ false }; // loaded explicitly for UI and the like, never evicted
+		bool isMissing{ false }; // file couldn't be decoded, isn't tried again
+		uint64_t lastUsedFrame{ 0 };
+		std::shared_ptr<Job> loadJob; // decoding in background, null if not loading
+		std::shared_ptr<DecodedImage> decoded; // filled by loadJob
+	};
+
+	typedef std::deque<TextureSlot> texture_atlas_t; // by handle
+	// Specifications are indexed by their ids, table sizes come from generated spec_ids.h
+	typedef std::array<Archipelago::WaresSpecification, waresTypeCount> wares_atlas_t;
+	typedef std::array<Archipelago::NaturalResourceSpecification, naturalResourceTypeCount> natres_atlas_t;
+	typedef std::array<Archipelago::BuildingSpecification, buildingTypeCount> buildings_atlas_t;
+
+	const char* const waresSpecificationFileName{ "assets/wares_specification.json" };
+	const char* const naturalResourcesSpecificationFileName{ "assets/natural_resources_specification.json" };
+	const char* const buildingsSpecificationFileName{ "assets/buildings_specification.json" };
 
 	enum class AssetType { Texture, NaturalResource, Ware, Building };
 
+	class JobSystem;
+	/// Asset name and file name of a texture
+	typedef std::vector<std::pair<std::string, std::string>> texture_list_t;
+
 	class AssetRegistry {
 	public:
+		explicit AssetRegistry(JobSystem* jobSystem = nullptr) : _jobSystem(jobSystem) {};
+		~AssetRegistry();
+		/// Bytes of resident textures which aren't pinned, least recently used ones above it are evicted at the end of a frame
+		void setTextureBudget(size_t bytes) { _textureBudget = bytes; };
+		/// Only remembers the file, texture is loaded on first use. Registering a known name returns its handle
+		TextureHandle registerTexture(const std::string& assetName, const std::string& filename);
+		/// Loads texture now and pins it, for textures which are needed all the time
 		void loadTexture(const std::string& assetName, const std::string& filename);
-		//void loadMap(const std::string& assetName, const std::string& filename, World* world);
+		/// Image files are decoded in parallel on the job system, textures are then created on the calling thread. Textures are pinned
+		void loadTextures(const texture_list_t& textures);
+		/// Makes registered textures resident now, decoded in parallel. They stay evictable
+		void loadTextures(const std::vector<TextureHandle>& handles);
+		/// Name lookup for loading code, noTextureHandle if texture isn't registered
+		TextureHandle findTexture(const std::string& textureName) const;
+		/** Texture for reading its size or pixels, loaded right away if it isn't resident.
+		* Null for unknown handles and files which can't be decoded. The pointer stays valid, but the texture
+		* is evicted unless it is used, so code which draws it every frame has to go through useTexture()
+		*/
+		sf::Texture* getTexture(TextureHandle handle);
+		/// Resolves name on every call, keep the handle instead of calling this repeatedly
 		sf::Texture* getTexture(const std::string& textureName);
+		/** Texture to draw this frame. Marks it used, and if it isn't resident yet starts decoding it in background
+		* and returns the placeholder, a small repeated texture, so a sprite keeping its texture rect draws a plain quad.
+		*/
+		const sf::Texture& useTexture(TextureHandle handle);
+		/// Game thread, once per frame. Creates textures decoded in background and evicts over budget
+		void endFrame();
+		size_t getResidentTextureBytes() const { return _residentBytes; };
 		//Archipelago::Map& getMap(const std::string& mapName);
 		void prepareWaresAtlas();
 		void prepareNaturalResourcesAtlas();
 		void prepareBuildingAtlas();
-		const std::string& getWaresName(WaresTypeId type) { return _wareAtlas.at(type).name; };
-		const WaresSpecification& getWaresSpecification(WaresTypeId type) { return _wareAtlas.at(type); }
-		const NaturalResourceSpecification& getNatresSpecification(NaturalResourceTypeId type) { return _natresAtlas.at(type); }
-		const BuildingSpecification& getBuildingSpecification(BuildingTypeId type) { return _buildingAtlas.at(type); }
+		/** Parses specification file into a separate atlas, e.g. on a file watcher thread, registry isn't touched.
+		* Returns false if file can't be read or is malformed, an unfinished edit must not replace working specifications
+		*/
+		static bool parseSpecificationFile(const std::string& filename, wares_atlas_t& atlas, texture_list_t& icons);
+		static bool parseSpecificationFile(const std::string& filename, natres_atlas_t& atlas, texture_list_t& icons);
+		static bool parseSpecificationFile(const std::string& filename, buildings_atlas_t& atlas, texture_list_t& icons);
+		/** Moves parsed specifications into the registry slot by slot. Specifications stay at their addresses,
+		* so pointers held by components and the economy see new values without being touched.
+		* Game thread only and nothing may read specifications meanwhile, i.e. simulation has to be stopped
+		*/
+		void replaceSpecifications(wares_atlas_t& atlas, const texture_list_t& icons);
+		void replaceSpecifications(natres_atlas_t& atlas, const texture_list_t& icons);
+		void replaceSpecifications(buildings_atlas_t& atlas, const texture_list_t& icons);
+		const std::string& getWaresName(WaresTypeId type) const { return _wareAtlas.at(static_cast<size_t>(type)).name; };
+		const WaresSpecification& getWaresSpecification(WaresTypeId type) const { return _wareAtlas.at(static_cast<size_t>(type)); }
+		const NaturalResourceSpecification& getNatresSpecification(NaturalResourceTypeId type) const { return _natresAtlas.at(static_cast<size_t>(type)); }
+		const BuildingSpecification& getBuildingSpecification(BuildingTypeId type) const { return _buildingAtlas.at(static_cast<size_t>(type)); }
 	private:
+		/// Registers icons, they are loaded when UI or map first shows them
+		template<typename Atlas>
+		void _resolveIcons(Atlas& atlas, const texture_list_t& icons) {
+			for (const auto& icon : icons) {
+				registerTexture(icon.first, icon.second);
+			}
+			for (size_t id = 1; id < atlas.size(); id++) {
+				atlas[id].icon = findTexture(atlas[id].name);
+			}
+		}
+
+		template<typename Atlas>
+		void _replaceSpecifications(Atlas& current, Atlas& reloaded, const texture_list_t& icons) {
+			_resolveIcons(reloaded, icons);
+			for (size_t id = 1; id < current.size(); id++) {
+				current[id] = std::move(reloaded[id]);
+			}
+		}
+
+		/// Starts background decoding, or decodes right away without job system
+		void _requestTexture(TextureHandle handle);
+		/// Creates texture from decoded image on the calling thread, which must own the GL context
+		void _finishTexture(TextureHandle handle);
+		void _evictTextures();
+		const sf::Texture& _getPlaceholderTexture();
+
+		JobSystem* _jobSystem;
 		texture_atlas_t _textureAtlas;
-		wares_atlas_t _wareAtlas;
-		natres_atlas_t _natresAtlas;
-		buildings_atlas_t _buildingAtlas;
+		std::unordered_map<std::string, TextureHandle> _textureHandles; // by asset name, used only to resolve handles
+		std::vector<TextureHandle> _loadingTextures;
+		std::vector<TextureHandle> _evictionCandidates; // scratch, kept to avoid allocating every frame
+		sf::Texture _placeholderTexture;
+		size_t _textureBudget{ textureBudgetDefault };
+		size_t _residentBytes{ 0 }; // evictable textures only
+		uint64_t _frame{ 1 };
+		wares_atlas_t _wareAtlas{};
+		natres_atlas_t _natresAtlas{};
+		buildings_atlas_t _buildingAtlas{};
 	};
 }
 
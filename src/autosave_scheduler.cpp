@@ -0,0 +1,63 @@
+#include <spdlog/spdlog.h>
+#include <SFML/System/Clock.hpp>
+#include "autosave_scheduler.h"
+#include "file_utils.h"
+
+namespace Archipelago {
+
+	extern const std::string& loggerName;
+
+}
+
+using namespace Archipelago;
+
+AutosaveScheduler::AutosaveScheduler(const std::string& fileName, unsigned int intervalMonths) :
+	_fileName(fileName),
+	_intervalMonths(intervalMonths),
+	_stopRequested(false) {
+	_worker = std::thread(&AutosaveScheduler::_workerLoop, this);
+}
+
+AutosaveScheduler::~AutosaveScheduler() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopRequested = true;
+	}
+	_wakeUp.notify_one();
+	_worker.join();
+}
+
+void AutosaveScheduler::schedule(std::shared_ptr<const SaveGameSnapshot> snapshot) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_pending) {
+			spdlog::get(loggerName)->warn("AutosaveScheduler: previous autosave is still pending, replacing it with newer snapshot");
+		}
+		_pending = std::move(snapshot);
+	}
+	_wakeUp.notify_one();
+}
+
+void AutosaveScheduler::_workerLoop() {
+	auto logger = spdlog::get(loggerName);
+	while (true) {
+		std::shared_ptr<const SaveGameSnapshot> snapshot;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wakeUp.wait(lock, [this] { return _stopRequested || _pending; });
+			if (!_pending) {
+				return; // stop requested and nothing left to write
+			}
+			snapshot = std::move(_pending);
+			_pending.reset();
+		}
+		sf::Clock clock;
+		writeSaveGame(*snapshot, _payloadBuffer, _compressBuffer, _fileImage);
+		if (!FileUtils::writeFileAtomically(_fileName, _fileImage.data(), _fileImage.size())) {
+			logger->error("AutosaveScheduler: failed to write autosave file '{}'", _fileName);
+			continue;
+		}
+		logger->info("Autosaved game at month {} to '{}': {} bytes ({} uncompressed) in {} ms",
+			snapshot->gameTime, _fileName, _fileImage.size(), _payloadBuffer.size(), clock.getElapsedTime().asMilliseconds());
+	}
+}
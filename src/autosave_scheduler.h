@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "savegame.h"
+
+namespace Archipelago {
+
+	/** Writes save game snapshots on a background thread.
+	* The game schedules from the simulation thread's month callback, which only pays for capturing the snapshot
+	* and swapping a pointer. If a write is still in progress when next snapshot arrives, the pending one is
+	* replaced, so at most one snapshot waits in memory and the game never blocks on disk I/O.
+	*/
+	class AutosaveScheduler {
+	public:
+		AutosaveScheduler(const std::string& fileName, unsigned int intervalMonths);
+		AutosaveScheduler(const AutosaveScheduler&) = delete;
+		~AutosaveScheduler();
+		bool isDue(unsigned int gameTime) const { return _intervalMonths > 0 && gameTime % _intervalMonths == 0; };
+		/// Any thread, in the game the simulation thread. Never waits for a write in progress
+		void schedule(std::shared_ptr<const SaveGameSnapshot> snapshot);
+	private:
+		void _workerLoop();
+
+		std::string _fileName;
+		unsigned int _intervalMonths;
+		std::thread _worker;
+		std::mutex _mutex;
+		std::condition_variable _wakeUp;
+		std::shared_ptr<const SaveGameSnapshot> _pending;
+		bool _stopRequested;
+		// worker-owned buffers, reused between saves
+		std::vector<char> _payloadBuffer;
+		std::vector<char> _compressBuffer;
+		std::vector<char> _fileImage;
+	};
+
+} // namespace Archipelago
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <spdlog/spdlog.h>
+#include <json.hpp>
+#include "balance_sweep.h"
+#include "file_utils.h"
+#include "job_system.h"
+#include "logistics.h"
+#include "map_generator.h"
+
+namespace Archipelago {
+
+	extern const std::string& loggerName;
+
+	const unsigned int balanceStepCost{ 2 }; /// route cost of a step towards storage, as of a plains tile
+	const size_t balanceSweepMaxRuns{ 10000000 };
+	const char* const balanceFieldKeys[]{ "wares_required", "wares_produced", "provided_instant_wares" }; /// by BalanceField, as in specification files
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	template<size_t Count>
+	bool findKey(const std::string& key, const char* const (&keys)[Count], size_t& index) {
+		for (size_t i = 0; i < Count; i++) {
+			if (key == keys[i]) {
+				index = i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::vector<WaresStack>& fieldWares(BuildingSpecification& bs, BalanceField field) {
+		switch (field) {
+		case BalanceField::WaresRequired: return bs.waresRequired;
+		case BalanceField::WaresProduced: return bs.waresProduced;
+		default: return bs.providedInstantWares;
+		}
+	}
+
+	/// Value of a parameter in a variant, variants count through the grid with the last parameter changing fastest
+	int variantValue(const BalanceSweepSettings& settings, size_t variant, size_t parameter) {
+		for (size_t p = settings.parameters.size() - 1; p > parameter; p--) {
+			variant /= settings.parameters[p].values.size();
+		}
+		return settings.parameters[parameter].values[variant % settings.parameters[parameter].values.size()];
+	}
+
+	void applyVariant(const BalanceSweepSettings& settings, size_t variant, buildings_atlas_t& specs) {
+		for (size_t p = 0; p < settings.parameters.size(); p++) {
+			const BalanceParameter& parameter = settings.parameters[p];
+			int amount = variantValue(settings, variant, p);
+			std::vector<WaresStack>& wares = fieldWares(specs[static_cast<size_t>(parameter.building)], parameter.field);
+			auto stack = std::find_if(wares.begin(), wares.end(), [&parameter](const WaresStack& ware) { return ware.type == parameter.ware; });
+			if (amount == 0) {
+				if (stack != wares.end()) wares.erase(stack);
+			}
+			else if (stack != wares.end()) {
+				stack->amount = amount;
+			}
+			else {
+				wares.push_back({ parameter.ware, amount });
+			}
+		}
+	}
+
+	/// Same rule as the game's: resource on the tile, or within natresRadius steps if the building has one
+	bool requiredNatresInReach(const BalanceMap& map, uint32_t resourceSet, uint32_t tile, const BuildingSpecification& bs) {
+		if (resourceSet == 0) return false;
+		if (bs.natresRequired == NaturalResourceTypeId::Unknown) return true;
+		const DistanceField& field = map.natresFields[static_cast<size_t>(bs.natresRequired)];
+		if (bs.natresRadius == 0 || field.isEmpty()) {
+			return NaturalResourceTypeId(resourceSet & 0x000000FF) == bs.natresRequired;
+		}
+		return field.getDistance(tile) <= bs.natresRadius;
+	}
+
+	void buildBalanceMap(const MapData& mapData, const buildings_atlas_t& specs, BalanceMap& map) {
+		buildLogisticsGrid(mapData, map.grid);
+		map.resources = mapData.resourcesLayer;
+		map.resources.resize(map.grid.cost.size(), 0);
+		// Sweeps vary wares only, so radii of the base specifications hold for every variant
+		for (NaturalResourceTypeId natresId : naturalResourceTypeIds) {
+			size_t type = static_cast<size_t>(natresId);
+			unsigned int radius = 0;
+			for (BuildingTypeId bldId : buildingTypeIds) {
+				const BuildingSpecification& bs = specs[static_cast<size_t>(bldId)];
+				if (static_cast<size_t>(bs.natresRequired) == type) radius = std::max(radius, bs.natresRadius);
+			}
+			map.natresFields[type] = DistanceField(radius);
+			if (radius == 0) continue;
+			std::vector<uint32_t> sources;
+			for (uint32_t tile = 0; tile < map.resources.size(); tile++) {
+				for (uint32_t resourceSet = map.resources[tile]; resourceSet; resourceSet >>= 8) {
+					if ((resourceSet & 0xFF) == type) {
+						sources.push_back(tile);
+						break;
+					}
+				}
+			}
+			map.natresFields[type].build(map.grid, sources);
+		}
+	}
+
+	void appendCSVHeader(const BalanceSweepSettings& settings, std::string& csv) {
+		csv += "variant,seed";
+		for (const BalanceParameter& parameter : settings.parameters) {
+			csv += ',';
+			csv += buildingTypeKeys[static_cast<size_t>(parameter.building)];
+			csv += '.';
+			csv += balanceFieldKeys[static_cast<size_t>(parameter.field)];
+			csv += '.';
+			csv += waresTypeKeys[static_cast<size_t>(parameter.ware)];
+		}
+		csv += ",buildings";
+		for (unsigned int target : settings.buildingTargets) {
+			csv += ",months_to_" + std::to_string(target);
+		}
+		for (size_t sample = 1; sample <= settings.getSampleCount(); sample++) {
+			for (WaresTypeId ware : waresTypeIds) {
+				csv += ',';
+				csv += waresTypeKeys[static_cast<size_t>(ware)];
+				csv += "_m" + std::to_string(sample * settings.sampleMonths);
+			}
+		}
+		csv += '\n';
+	}
+
+	void appendCSVRow(const BalanceSweepSettings& settings, size_t variant, uint32_t seed, const int32_t* metrics, std::string& csv) {
+		csv += std::to_string(variant);
+		csv += ',';
+		csv += std::to_string(seed);
+		for (size_t p = 0; p < settings.parameters.size(); p++) {
+			csv += ',';
+			csv += std::to_string(variantValue(settings, variant, p));
+		}
+		for (size_t i = 0; i < settings.getMetricsCount(); i++) {
+			csv += ',';
+			// Targets never reached are left empty
+			if (i == 0 || i > settings.buildingTargets.size() || metrics[i] >= 0) csv += std::to_string(metrics[i]);
+		}
+		csv += '\n';
+	}
+
+}
+
+size_t BalanceSweepSettings::getVariantCount() const {
+	size_t count = 1;
+	for (const BalanceParameter& parameter : parameters) {
+		if (parameter.values.empty()) return 0;
+		if (count > balanceSweepMaxRuns / parameter.values.size()) return balanceSweepMaxRuns + 1;
+		count *= parameter.values.size();
+	}
+	return count;
+}
+
+bool Archipelago::loadBalanceSweepSettings(const std::string& fileName, BalanceSweepSettings& settings) {
+	auto logger = spdlog::get(loggerName);
+	std::vector<char> source;
+	if (!FileUtils::readFile(fileName, source)) {
+		logger->error("Can't read balance sweep file '{}'", fileName);
+		return false;
+	}
+	try {
+		nlohmann::json sweepJSON = nlohmann::json::parse(source.begin(), source.end());
+		settings.years = sweepJSON.value("years", balanceSweepDefaultYears);
+		settings.seeds = sweepJSON.value("seeds", 1u);
+		settings.sampleMonths = sweepJSON.value("sample_months", balanceSweepDefaultSampleMonths);
+		settings.buildingTargets = sweepJSON.value("building_targets", std::vector<unsigned int>());
+		settings.parameters.clear();
+		for (const auto& parameterJSON : sweepJSON.at("parameters")) {
+			BalanceParameter parameter;
+			size_t building, field, ware;
+			if (!findKey(parameterJSON.at("building").get<std::string>(), buildingTypeKeys, building) || building == 0 ||
+				!findKey(parameterJSON.at("field").get<std::string>(), balanceFieldKeys, field) ||
+				!findKey(parameterJSON.at("ware").get<std::string>(), waresTypeKeys, ware) || ware == 0) {
+				logger->error("Balance sweep '{}': unknown building, field or ware in parameter {}", fileName, parameterJSON.dump());
+				return false;
+			}
+			parameter.building = static_cast<BuildingTypeId>(building);
+			parameter.field = static_cast<BalanceField>(field);
+			parameter.ware = static_cast<WaresTypeId>(ware);
+			parameter.values = parameterJSON.at("values").get<std::vector<int>>();
+			settings.parameters.push_back(std::move(parameter));
+		}
+	}
+	catch (std::exception& e) {
+		logger->error("Can't parse balance sweep '{}': {}", fileName, e.what());
+		return false;
+	}
+	if (settings.years == 0 || settings.seeds == 0 || settings.sampleMonths == 0) {
+		logger->error("Balance sweep '{}': years, seeds and sample_months must not be 0", fileName);
+		return false;
+	}
+	size_t variants = settings.getVariantCount();
+	if (variants == 0 || variants * settings.seeds > balanceSweepMaxRuns) {
+		logger->error("Balance sweep '{}' has {} runs, it must have 1 to {}", fileName, variants * settings.seeds, balanceSweepMaxRuns);
+		return false;
+	}
+	return true;
+}
+
+BalanceRun::BalanceRun(const BalanceMap& map) :
+	_map(map),
+	_specs(nullptr),
+	_settlement(playerSettlementId),
+	_economy(nullptr),
+	_isOccupied(map.grid.cost.size(), 0),
+	_storageField(maxRouteCost / balanceStepCost) {
+}
+
+void BalanceRun::run(const buildings_atlas_t& specs, uint32_t seed, const BalanceSweepSettings& settings, int32_t* metrics) {
+	_specs = &specs;
+	_settlement = Settlement(playerSettlementId);
+	_economy.reset();
+	_stockpile = _settlement.getWares();
+	for (uint32_t tile : _buildingTiles) {
+		_isOccupied[tile] = 0;
+	}
+	_buildingTiles.clear();
+	_storageField.reset(_map.grid);
+
+	int32_t* reachedMonths = metrics + 1;
+	int32_t* samples = reachedMonths + settings.buildingTargets.size();
+	std::fill(reachedMonths, samples, -1);
+	SettlementBuilder builder(*this, playerSettlementId, seed);
+	// Same order as in the game: AI builders act, then the month is simulated
+	for (unsigned int month = 0; month < settings.years * 12; month++) {
+		builder.run(aiStepsPerMonth);
+		for (size_t target = 0; target < settings.buildingTargets.size(); target++) {
+			if (reachedMonths[target] < 0 && _buildingTiles.size() >= settings.buildingTargets[target]) {
+				reachedMonths[target] = static_cast<int32_t>(month);
+			}
+		}
+		_economy.tick(_stockpile);
+		for (size_t i = 0; i < _stockpile.size(); i++) {
+			_settlement.syncWare(i, _stockpile[i].amount);
+		}
+		if ((month + 1) % settings.sampleMonths == 0) {
+			for (const WaresStack& ware : _stockpile) {
+				*samples++ = ware.amount;
+			}
+		}
+	}
+	metrics[0] = static_cast<int32_t>(_buildingTiles.size());
+}
+
+uint32_t BalanceRun::getTileResources(unsigned int tileX, unsigned int tileY) const {
+	if (tileX >= _map.grid.width || tileY >= _map.grid.height) return 0;
+	return _map.resources[tileY * _map.grid.width + tileX];
+}
+
+bool BalanceRun::anyBuildingInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const {
+	// A run has a single settlement of a few hundred buildings at most, a list is all the index it needs
+	for (uint32_t tile : _buildingTiles) {
+		unsigned int x = tile % _map.grid.width, y = tile / _map.grid.width;
+		if (x >= x0 && x <= x1 && y >= y0 && y <= y1) return true;
+	}
+	return false;
+}
+
+bool BalanceRun::isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const {
+	if (tileX >= _map.grid.width || tileY >= _map.grid.height) return false;
+	uint32_t tile = tileY * _map.grid.width + tileX;
+	return !_isOccupied[tile] && requiredNatresInReach(_map, _map.resources[tile], tile, bs);
+}
+
+bool BalanceRun::placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) {
+	const BuildingSpecification& bs = getBuildingSpecification(buildingID);
+	if (settlementId != playerSettlementId || !_settlement.hasWaresForBuilding(bs) || _settlement.exceededAllowedBuildingAmount(bs) ||
+		!isBuildingSite(bs, tileX, tileY)) return false;
+	uint32_t tile = tileY * _map.grid.width + tileX;
+	_isOccupied[tile] = 1;
+	_buildingTiles.push_back(tile);
+	_settlement.addBuilding(bs, [this](WaresTypeId ware, int amount) {
+		_stockpile[static_cast<size_t>(ware) - static_cast<size_t>(WaresTypeId::_First)].amount += amount;
+	});
+	_economy.addBuilding(&bs, tileX, tileY);
+	if (!bs.isStorage) {
+		_economy.setDeliveryMonths(_buildingTiles.size() - 1, _getDeliveryMonths(tile));
+		return true;
+	}
+	// New storage may be closer for any building
+	_storageField.addSource(_map.grid, tile, static_cast<uint32_t>(_buildingTiles.size() - 1));
+	const std::vector<EconomyBuilding>& buildings = _economy.getBuildings();
+	for (size_t building = 0; building < buildings.size(); building++) {
+		if (buildings[building].spec->isStorage) continue;
+		unsigned int months = _getDeliveryMonths(_buildingTiles[building]);
+		if (months != buildings[building].deliveryMonths) _economy.setDeliveryMonths(building, months);
+	}
+	return true;
+}
+
+unsigned int BalanceRun::_getDeliveryMonths(uint32_t tile) const {
+	uint16_t distance = _storageField.getDistance(tile);
+	if (distance == unreachedDistance || distance * balanceStepCost > maxRouteCost) return noDelivery;
+	return distance * balanceStepCost / logisticsCostPerMonth;
+}
+
+int Archipelago::runBalanceSweep(const std::string& sweepFileName, const std::string& csvFileName, const BenchmarkOptions& options) {
+	if (!spdlog::get(loggerName)) {
+		spdlog::basic_logger_mt(loggerName, "archipelago.log");
+	}
+	auto logger = spdlog::get(loggerName);
+	if (options.mapSize > maxGeneratedMapSize) {
+		std::printf("Map size is limited to %u\n", maxGeneratedMapSize);
+		return 1;
+	}
+	BalanceSweepSettings settings;
+	if (!loadBalanceSweepSettings(sweepFileName, settings)) {
+		std::printf("Can't load balance sweep '%s', see log for details\n", sweepFileName.c_str());
+		return 1;
+	}
+	buildings_atlas_t baseSpecs;
+	texture_list_t icons;
+	if (!AssetRegistry::parseSpecificationFile(buildingsSpecificationFileName, baseSpecs, icons)) {
+		std::printf("Can't load building specifications '%s'\n", buildingsSpecificationFileName);
+		return 1;
+	}
+
+	MapGeneratorSettings mapSettings;
+	mapSettings.mapWidth = mapSettings.mapHeight = options.mapSize ? options.mapSize : balanceSweepDefaultMapSize;
+	mapSettings.seed = options.seed;
+	MapData mapData;
+	generateMap(mapSettings, mapData);
+	BalanceMap map;
+	buildBalanceMap(mapData, baseSpecs, map);
+
+	// Runs are independent, so they are split into plain ranges, each worked through with one reused run and set of specifications
+	size_t variants = settings.getVariantCount();
+	size_t runCount = variants * settings.seeds;
+	size_t metricsCount = settings.getMetricsCount();
+	std::vector<int32_t> metrics(runCount * metricsCount);
+	unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	JobSystem jobSystem(hardwareThreads - 1);
+	auto start = std::chrono::steady_clock::now();
+	jobSystem.parallelFor(runCount, runCount / (jobSystem.getThreadCount() * 8) + 1, [&](size_t begin, size_t end) {
+		BalanceRun run(map);
+		buildings_atlas_t specs;
+		for (size_t runIndex = begin; runIndex < end; runIndex++) {
+			specs = baseSpecs;
+			applyVariant(settings, runIndex / settings.seeds, specs);
+			run.run(specs, options.seed + static_cast<uint32_t>(runIndex % settings.seeds), settings, &metrics[runIndex * metricsCount]);
+		}
+	});
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::string csv;
+	appendCSVHeader(settings, csv);
+	for (size_t runIndex = 0; runIndex < runCount; runIndex++) {
+		appendCSVRow(settings, runIndex / settings.seeds, options.seed + static_cast<uint32_t>(runIndex % settings.seeds), &metrics[runIndex * metricsCount], csv);
+	}
+	if (!FileUtils::writeFileAtomically(csvFileName, csv.data(), csv.size())) {
+		std::printf("Can't write balance sweep results to '%s'\n", csvFileName.c_str());
+		return 1;
+	}
+	double runsPerMinute = seconds > 0 ? runCount * 60.0 / seconds : 0.0;
+	std::printf("%zu variants x %u seeds, %u years each on %ux%u map: %.2f s on %u threads (%.0f runs/min), results in '%s'\n",
+		variants, settings.seeds, settings.years, map.grid.width, map.grid.height, seconds, hardwareThreads, runsPerMinute, csvFileName.c_str());
+	logger->info("Balance sweep '{}': {} runs of {} years in {:.2f} s on {} threads, results in '{}'",
+		sweepFileName, runCount, settings.years, seconds, hardwareThreads, csvFileName);
+	return 0;
+}
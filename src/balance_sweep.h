@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "asset_registry.h"
+#include "benchmarks.h"
+#include "distance_field.h"
+#include "economy.h"
+#include "settlement_builder.h"
+
+namespace Archipelago {
+
+	const unsigned int balanceSweepDefaultMapSize{ 256 };
+	const unsigned int balanceSweepDefaultYears{ 10 };
+	const unsigned int balanceSweepDefaultSampleMonths{ 12 };
+	const char* const balanceSweepDefaultCSVFileName{ "balance_sweep.csv" };
+
+	/// Specification field a sweep parameter sets the amount of one ware in
+	enum class BalanceField { WaresRequired, WaresProduced, ProvidedInstantWares };
+
+	/// One axis of the grid: amounts one ware of one building specification field takes in turn
+	struct BalanceParameter {
+		BuildingTypeId building;
+		BalanceField field;
+		WaresTypeId ware;
+		std::vector<int> values; // 0 removes the ware from the field
+	};
+
+	/** Parameter grid and run settings, read from a JSON file like bin/balance_sweep.json.
+	* Every combination of parameter values is a variant, and every variant runs once per seed.
+	*/
+	struct BalanceSweepSettings {
+		std::vector<BalanceParameter> parameters;
+		std::vector<unsigned int> buildingTargets; // CSV gets the month each of these building counts was reached
+		unsigned int years{ balanceSweepDefaultYears };
+		unsigned int seeds{ 1 }; // runs per variant, from the map seed on
+		unsigned int sampleMonths{ balanceSweepDefaultSampleMonths }; // stockpile curves get a point every this many months
+
+		size_t getVariantCount() const;
+		size_t getSampleCount() const { return years * 12 / sampleMonths; };
+		/// Values a run yields, see BalanceRun::run()
+		size_t getMetricsCount() const { return 1 + buildingTargets.size() + getSampleCount() * economyWaresCount; };
+	};
+
+	bool loadBalanceSweepSettings(const std::string& fileName, BalanceSweepSettings& settings);
+
+	/// Map of a sweep, made once and read by all runs at the same time
+	struct BalanceMap {
+		LogisticsGrid grid;
+		std::vector<uint32_t> resources; // row-major, as resources layer of map files
+		DistanceField natresFields[naturalResourceTypeCount]; // by NaturalResourceTypeId, only for resources wanted within a radius
+	};
+
+	/** One headless settlement run on a sweep map: AI builder, settlement and economy, nothing else of the game.
+	* Placement follows the rules of the game, wares travel to the nearest storage at the pace of plains,
+	* whatever the terrain between. Everything a run needs is kept between runs, so that a worker going
+	* through thousands of runs allocates next to nothing after its first one, and runs share only the
+	* read-only map and nothing is random but the builder seeded with the run seed.
+	*/
+	class BalanceRun : public SettlementWorld {
+	public:
+		explicit BalanceRun(const BalanceMap& map);
+		BalanceRun(const BalanceRun&) = delete;
+		/** Runs a settlement for the years of the settings with given specifications, indexed by id.
+		* Fills getMetricsCount() values: buildings placed, then the game month each building target was reached in
+		* or -1, then stockpile amounts after every sampleMonths months, ware by ware
+		*/
+		void run(const buildings_atlas_t& specs, uint32_t seed, const BalanceSweepSettings& settings, int32_t* metrics);
+		virtual const Settlement& getSettlement(SettlementId) const override { return _settlement; };
+		virtual const BuildingSpecification& getBuildingSpecification(BuildingTypeId type) const override { return (*_specs)[static_cast<size_t>(type)]; };
+		virtual const LogisticsGrid& getReachGrid() const override { return _map.grid; };
+		virtual uint32_t getTileResources(unsigned int tileX, unsigned int tileY) const override;
+		virtual bool anyBuildingInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const override;
+		virtual bool isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const override;
+		virtual bool placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) override;
+	private:
+		/// Months wares of a building on the tile take to the nearest storage, noDelivery if it's too far
+		unsigned int _getDeliveryMonths(uint32_t tile) const;
+
+		const BalanceMap& _map;
+		const buildings_atlas_t* _specs;
+		Settlement _settlement;
+		Economy _economy;
+		std::vector<WaresStack> _stockpile; // simulation side of the settlement's stockpile
+		std::vector<uint8_t> _isOccupied; // by tile
+		std::vector<uint32_t> _buildingTiles; // in placement order, as economy buildings
+		DistanceField _storageField;
+	};
+
+	/** Runs every variant of the sweep file on a generated map, in parallel on all hardware threads,
+	* and writes one CSV row per run. Returns process exit code.
+	*/
+	int runBalanceSweep(const std::string& sweepFileName, const std::string& csvFileName, const BenchmarkOptions& options);
+
+} // namespace Archipelago
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <iterator>
+#include <thread>
+#include <vector>
+#include "benchmarks.h"
+#include "game.h"
+#include "economy.h"
+#include "hierarchical_pathfinder.h"
+#include "job_system.h"
+#include "logistics.h"
+#include "map_data.h"
+#include "map_generator.h"
+#include "simulation.h"
+
+namespace Archipelago {
+
+	const std::string& benchmarkMapFileName{ "assets/maps/default_map.json" };
+	const unsigned int mapGenBenchmarkSizes[] = { 256, 1024, 4096 };
+	const unsigned int maxJSONBenchmarkMapSize{ 1024 }; /// parsing larger JSON maps takes minutes and gigabytes
+	const unsigned int mapLoadBenchmarkDefaultSize{ 512 };
+	const unsigned int generatedMapDefaultSize{ 1024 };
+	const size_t economyBenchmarkBuildings{ 1000000 };
+	const unsigned int economyBenchmarkMonths{ 120 };
+	const unsigned int settlementsBenchmarkSettlements{ 256 };
+	const size_t settlementsBenchmarkBuildings{ 2000 }; /// per settlement
+	const unsigned int aiBuilderBenchmarkDefaultSize{ 512 };
+	const unsigned int aiBuilderBenchmarkSettlements{ 64 };
+	const unsigned int aiBuilderBenchmarkMonths{ 120 };
+	const unsigned int pathfindingBenchmarkDefaultSize{ 1024 };
+	const unsigned int pathfindingBenchmarkQueries{ 200 };
+	const unsigned int pathfindingBenchmarkMaxDistance{ 256 }; /// tiles along each axis between query ends
+	const unsigned int pathfindingBenchmarkRoads{ 1000 };
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	class Stopwatch {
+	public:
+		Stopwatch() : _start(std::chrono::steady_clock::now()) {};
+		double elapsedMs() const {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+		}
+	private:
+		std::chrono::steady_clock::time_point _start;
+	};
+
+	void createLogger() {
+		if (!spdlog::get(loggerName)) {
+			spdlog::basic_logger_mt(loggerName, "archipelago.log");
+		}
+	}
+
+	MapGeneratorSettings makeGeneratorSettings(unsigned int mapSize, uint32_t seed) {
+		MapGeneratorSettings settings;
+		settings.mapWidth = mapSize;
+		settings.mapHeight = mapSize;
+		settings.seed = seed;
+		return settings;
+	}
+
+	/// Generation, binary and JSON round trips of procedural maps, entirely in memory
+	int benchmarkMapGen(const BenchmarkOptions& options) {
+		std::vector<unsigned int> sizes;
+		if (options.mapSize) {
+			sizes.push_back(options.mapSize);
+		}
+		else {
+			sizes.assign(std::begin(mapGenBenchmarkSizes), std::end(mapGenBenchmarkSizes));
+		}
+		std::printf("%-10s %12s %12s %12s %12s %12s %12s\n", "size", "generate ms", "bin write ms", "bin read ms", "bin bytes", "json write ms", "json read ms");
+		for (unsigned int size : sizes) {
+			MapData map;
+			Stopwatch generateTime;
+			generateMap(makeGeneratorSettings(size, options.seed), map);
+			double generateMs = generateTime.elapsedMs();
+
+			std::vector<char> fileImage;
+			Stopwatch binWriteTime;
+			writeMapBinary(map, fileImage);
+			double binWriteMs = binWriteTime.elapsedMs();
+			MapData loaded;
+			Stopwatch binReadTime;
+			if (!readMapBinary(fileImage.data(), fileImage.size(), loaded) || loaded.terrainLayer != map.terrainLayer || loaded.resourcesLayer != map.resourcesLayer) {
+				std::printf("Binary map round trip failed for %ux%u map\n", size, size);
+				return 1;
+			}
+			double binReadMs = binReadTime.elapsedMs();
+
+			double jsonWriteMs = 0, jsonReadMs = 0;
+			if (map.mapWidth <= maxJSONBenchmarkMapSize) {
+				std::string json;
+				Stopwatch jsonWriteTime;
+				writeMapJSON(map, json);
+				jsonWriteMs = jsonWriteTime.elapsedMs();
+				Stopwatch jsonReadTime;
+				if (!parseMapJSON(json.data(), json.size(), loaded)) {
+					std::printf("JSON map round trip failed for %ux%u map\n", size, size);
+					return 1;
+				}
+				jsonReadMs = jsonReadTime.elapsedMs();
+			}
+			std::printf("%4ux%-5u %12.1f %12.1f %12.1f %12zu %12.1f %12.1f\n", map.mapWidth, map.mapHeight,
+				generateMs, binWriteMs, binReadMs, fileImage.size(), jsonWriteMs, jsonReadMs);
+			spdlog::get(loggerName)->info("Benchmark mapgen {}x{}: generate {:.1f} ms, binary write {:.1f} ms, read {:.1f} ms ({} bytes), JSON write {:.1f} ms, read {:.1f} ms",
+				map.mapWidth, map.mapHeight, generateMs, binWriteMs, binReadMs, fileImage.size(), jsonWriteMs, jsonReadMs);
+		}
+		return 0;
+	}
+
+	/// Builds ECS entities of a generated map, i.e. MapSystem map loading minus file parsing
+	int benchmarkMapLoad(const BenchmarkOptions& options) {
+		unsigned int size = options.mapSize ? options.mapSize : mapLoadBenchmarkDefaultSize;
+		MapData map;
+		generateMap(makeGeneratorSettings(size, options.seed), map);
+
+		Game game;
+		game.initHeadless(benchmarkMapFileName);
+		Stopwatch loadTime;
+		game.loadMap(map);
+		double loadMs = loadTime.elapsedMs();
+		Stopwatch tickTime;
+		game.getWorld()->tick(0);
+		double tickMs = tickTime.elapsedMs();
+		std::printf("Map %ux%u: load %.1f ms (%.2f us/tile), world tick %.2f ms, %zu entities\n", map.mapWidth, map.mapHeight,
+			loadMs, loadMs * 1000.0 / (static_cast<double>(map.mapWidth) * map.mapHeight), tickMs, game.getWorld()->getCount());
+		spdlog::get(loggerName)->info("Benchmark mapload {}x{}: load {:.1f} ms, world tick {:.2f} ms", map.mapWidth, map.mapHeight, loadMs, tickMs);
+		game.shutdown();
+		return 0;
+	}
+
+	/// Monthly production of a million buildings, single-threaded against job system on all hardware threads
+	int benchmarkEconomy(const BenchmarkOptions& options) {
+		// Specifications are made up here, the benchmark doesn't need assets
+		std::vector<BuildingSpecification> specs(3);
+		specs[0].id = BuildingTypeId::BaseCamp;
+		specs[0].waresProduced = { { WaresTypeId::People, 1 } };
+		specs[1].id = BuildingTypeId::Woodcutter;
+		specs[1].waresProduced = { { WaresTypeId::Wood, 3 } };
+		specs[2].id = BuildingTypeId::Farm;
+		specs[2].waresProduced = { { WaresTypeId::Crops, 2 }, { WaresTypeId::FreshWater, -1 } };
+		unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+		std::vector<WaresStack> results[2];
+		double msPerMonth[2];
+		JobSystem jobSystem(hardwareThreads - 1);
+		for (int run = 0; run < 2; run++) {
+			Economy economy(run == 0 ? nullptr : &jobSystem);
+			for (size_t i = 0; i < economyBenchmarkBuildings; i++) {
+				// Efficiency varies so that integer rounding is exercised
+				economy.addBuilding(&specs[i % specs.size()], static_cast<unsigned int>(i % 4096), static_cast<unsigned int>(i / 4096), 500 + (i * 7919) % 501);
+			}
+			for (WaresTypeId type : waresTypeIds) {
+				results[run].push_back({ type, 0 });
+			}
+			Stopwatch tickTime;
+			for (unsigned int month = 0; month < economyBenchmarkMonths; month++) {
+				economy.tick(results[run]);
+			}
+			msPerMonth[run] = tickTime.elapsedMs() / economyBenchmarkMonths;
+		}
+		bool identical = true;
+		for (size_t i = 0; i < results[0].size(); i++) {
+			identical = identical && results[0][i].amount == results[1][i].amount;
+		}
+		std::printf("Economy of %zu buildings: %.3f ms/month on 1 thread, %.3f ms/month on %u threads (x%.2f), results %s\n",
+			economyBenchmarkBuildings, msPerMonth[0], msPerMonth[1], hardwareThreads, msPerMonth[0] / msPerMonth[1], identical ? "identical" : "DIFFER");
+		spdlog::get(loggerName)->info("Benchmark economy: {:.3f} ms/month on 1 thread, {:.3f} ms/month on {} threads, results {}",
+			msPerMonth[0], msPerMonth[1], hardwareThreads, identical ? "identical" : "differ");
+		return identical ? 0 : 1;
+	}
+
+
+	/// Month ticks of hundreds of settlements in one simulation, single-threaded against settlements ticked in parallel
+	int benchmarkSettlements(const BenchmarkOptions& options) {
+		std::vector<BuildingSpecification> specs(3);
+		specs[0].id = BuildingTypeId::BaseCamp;
+		specs[0].waresProduced = { { WaresTypeId::People, 1 } };
+		specs[1].id = BuildingTypeId::Woodcutter;
+		specs[1].waresProduced = { { WaresTypeId::Wood, 3 } };
+		specs[2].id = BuildingTypeId::Farm;
+		specs[2].waresProduced = { { WaresTypeId::Crops, 2 }, { WaresTypeId::FreshWater, -1 } };
+		unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<WaresStack> startingWares;
+		for (WaresTypeId type : waresTypeIds) {
+			startingWares.push_back({ type, 0 });
+		}
+
+		std::vector<std::vector<WaresStack>> results[2];
+		double msPerMonth[2];
+		JobSystem jobSystem(hardwareThreads - 1);
+		for (int run = 0; run < 2; run++) {
+			Simulation simulation(run == 0 ? nullptr : &jobSystem, startingWares, 1);
+			std::mt19937 random(options.seed);
+			for (SettlementId settlement = 0; settlement < settlementsBenchmarkSettlements; settlement++) {
+				if (settlement != playerSettlementId) simulation.push(SimulationCommand::addSettlement());
+				// Settlements differ in size and mix, as they would in a game
+				size_t buildings = settlementsBenchmarkBuildings / 2 + random() % settlementsBenchmarkBuildings;
+				for (size_t i = 0; i < buildings; i++) {
+					simulation.push(SimulationCommand::addBuilding(settlement, &specs[random() % specs.size()], static_cast<unsigned int>(i % 64), settlement));
+				}
+			}
+			Stopwatch tickTime;
+			for (unsigned int month = 0; month < economyBenchmarkMonths; month++) {
+				simulation.advanceMonth();
+			}
+			msPerMonth[run] = tickTime.elapsedMs() / economyBenchmarkMonths;
+			results[run] = simulation.getSnapshot().settlementWares;
+		}
+		bool identical = results[0].size() == settlementsBenchmarkSettlements;
+		for (size_t settlement = 0; identical && settlement < results[0].size(); settlement++) {
+			for (size_t i = 0; i < results[0][settlement].size(); i++) {
+				identical = identical && results[0][settlement][i].amount == results[1][settlement][i].amount;
+			}
+		}
+		std::printf("%u settlements of about %zu buildings: %.3f ms/month on 1 thread, %.3f ms/month on %u threads (x%.2f), results %s\n",
+			settlementsBenchmarkSettlements, settlementsBenchmarkBuildings, msPerMonth[0], msPerMonth[1], hardwareThreads, msPerMonth[0] / msPerMonth[1], identical ? "identical" : "DIFFER");
+		spdlog::get(loggerName)->info("Benchmark settlements: {} settlements, {:.3f} ms/month on 1 thread, {:.3f} ms/month on {} threads, results {}",
+			settlementsBenchmarkSettlements, msPerMonth[0], msPerMonth[1], hardwareThreads, identical ? "identical" : "differ");
+		return identical ? 0 : 1;
+	}
+
+	/// AI settlements expanding on a generated map: placement steps per second and month ticks under their load
+	int benchmarkAiBuilder(const BenchmarkOptions& options) {
+		unsigned int size = options.mapSize ? options.mapSize : aiBuilderBenchmarkDefaultSize;
+		MapData map;
+		generateMap(makeGeneratorSettings(size, options.seed), map);
+
+		Game game;
+		game.initHeadless(benchmarkMapFileName);
+		game.loadMap(map);
+		game.addAiSettlements(aiBuilderBenchmarkSettlements, options.seed);
+		double builderMs = 0, monthMs = 0;
+		size_t placed = 0;
+		for (unsigned int month = 0; month < aiBuilderBenchmarkMonths; month++) {
+			Stopwatch builderTime;
+			placed += game.runAiBuilders();
+			builderMs += builderTime.elapsedMs();
+			Stopwatch monthTime;
+			game.advanceMonth();
+			monthMs += monthTime.elapsedMs();
+		}
+		double stepsPerSecond = builderMs > 0 ? placed * 1000.0 / builderMs : 0.0;
+		std::printf("Map %ux%u, %u AI settlements, %u months: %zu buildings placed, %.0f placements/s, %.3f ms/month\n",
+			size, size, aiBuilderBenchmarkSettlements, aiBuilderBenchmarkMonths, placed, stepsPerSecond, monthMs / aiBuilderBenchmarkMonths);
+		spdlog::get(loggerName)->info("Benchmark aibuilder {}x{}: {} settlements, {} buildings, {:.0f} placements/s, {:.3f} ms/month",
+			size, size, aiBuilderBenchmarkSettlements, placed, stepsPerSecond, monthMs / aiBuilderBenchmarkMonths);
+		game.shutdown();
+		return placed > 0 ? 0 : 1;
+	}
+
+	/// Plain A* over every tile, the reference hierarchical paths are measured against
+	unsigned int findFlatPath(const LogisticsGrid& grid, uint32_t from, uint32_t to) {
+		auto heuristic = [&](uint32_t tile) {
+			return static_cast<unsigned int>(std::abs(static_cast<int>(tile % grid.width) - static_cast<int>(to % grid.width)) +
+				std::abs(static_cast<int>(tile / grid.width) - static_cast<int>(to / grid.width))) * roadTileCost;
+		};
+		std::vector<unsigned int> costs(grid.cost.size(), noPath);
+		std::vector<std::pair<unsigned int, uint32_t>> open;
+		std::greater<std::pair<unsigned int, uint32_t>> lowestFirst;
+		costs[from] = 0;
+		open.push_back({ heuristic(from), from });
+		while (!open.empty()) {
+			std::pop_heap(open.begin(), open.end(), lowestFirst);
+			uint32_t tile = open.back().second;
+			unsigned int estimate = open.back().first;
+			open.pop_back();
+			if (estimate > costs[tile] + heuristic(tile)) continue;
+			if (tile == to) return costs[tile];
+			unsigned int x = tile % grid.width, y = tile / grid.width;
+			const uint32_t neighbours[4] = {
+				x > 0 ? tile - 1 : tile,
+				x + 1 < grid.width ? tile + 1 : tile,
+				y > 0 ? tile - grid.width : tile,
+				y + 1 < grid.height ? tile + grid.width : tile
+			};
+			for (uint32_t next : neighbours) {
+				unsigned int step = next == to && grid.cost[next] == impassableTileCost ? roadTileCost : grid.cost[next];
+				if (next == tile || step == impassableTileCost || costs[tile] + step >= costs[next]) continue;
+				costs[next] = costs[tile] + step;
+				open.push_back({ costs[next] + heuristic(next), next });
+				std::push_heap(open.begin(), open.end(), lowestFirst);
+			}
+		}
+		return noPath;
+	}
+
+	/// Hierarchical pathfinder on a generated map: precomputation, queries against flat A*, cluster updates by roads
+	int benchmarkPathfinding(const BenchmarkOptions& options) {
+		unsigned int size = options.mapSize ? options.mapSize : pathfindingBenchmarkDefaultSize;
+		MapData map;
+		generateMap(makeGeneratorSettings(size, options.seed), map);
+		LogisticsGrid grid;
+		buildLogisticsGrid(map, grid);
+
+		HierarchicalPathfinder pathfinder;
+		Stopwatch buildTime;
+		pathfinder.build(grid);
+		double buildMs = buildTime.elapsedMs();
+
+		// Query ends are random land tiles not too far apart, as buildings and their storages would be
+		std::mt19937 random(options.seed);
+		auto randomLandTile = [&](unsigned int x0, unsigned int y0, unsigned int range) {
+			for (;;) {
+				unsigned int x = std::min(size - 1, x0 + static_cast<unsigned int>(random() % range));
+				unsigned int y = std::min(size - 1, y0 + static_cast<unsigned int>(random() % range));
+				uint32_t tile = y * size + x;
+				if (grid.cost[tile] != impassableTileCost) return tile;
+			}
+		};
+		double hierarchicalMs = 0, flatMs = 0, costRatio = 0;
+		unsigned int found = 0, mismatches = 0;
+		std::vector<uint32_t> tiles;
+		for (unsigned int query = 0; query < pathfindingBenchmarkQueries; query++) {
+			uint32_t from = randomLandTile(0, 0, size);
+			uint32_t to = randomLandTile(from % size, from / size, pathfindingBenchmarkMaxDistance);
+			Stopwatch hierarchicalTime;
+			unsigned int cost = pathfinder.findPath(from, to, noPath - 1, &tiles);
+			hierarchicalMs += hierarchicalTime.elapsedMs();
+			Stopwatch flatTime;
+			unsigned int flatCost = findFlatPath(grid, from, to);
+			flatMs += flatTime.elapsedMs();
+			if ((cost == noPath) != (flatCost == noPath) || cost < flatCost) {
+				++mismatches;
+			}
+			else if (cost != noPath && flatCost > 0) {
+				++found;
+				costRatio += static_cast<double>(cost) / flatCost;
+			}
+		}
+
+		Stopwatch updateTime;
+		for (unsigned int road = 0; road < pathfindingBenchmarkRoads; road++) {
+			pathfinder.setTileCost(static_cast<unsigned int>(random() % size), static_cast<unsigned int>(random() % size), roadTileCost);
+		}
+		double updateMs = updateTime.elapsedMs();
+
+		double hierarchicalUs = hierarchicalMs * 1000.0 / pathfindingBenchmarkQueries, flatUs = flatMs * 1000.0 / pathfindingBenchmarkQueries;
+		double averageRatio = found ? costRatio / found : 1.0;
+		std::printf("Map %ux%u: %zu clusters, %zu portals, built in %.1f ms\n", size, size, pathfinder.getClusterCount(), pathfinder.getPortalCount(), buildMs);
+		std::printf("%u queries: hierarchical %.1f us, flat A* %.1f us (x%.1f), path cost %.3f of optimal, %u mismatches\n",
+			pathfindingBenchmarkQueries, hierarchicalUs, flatUs, flatUs / hierarchicalUs, averageRatio, mismatches);
+		std::printf("Road placement: %.1f us per tile\n", updateMs * 1000.0 / pathfindingBenchmarkRoads);
+		spdlog::get(loggerName)->info("Benchmark pathfinding {}x{}: build {:.1f} ms, query {:.1f} us hierarchical, {:.1f} us flat, cost ratio {:.3f}, {} mismatches, road {:.1f} us",
+			size, size, buildMs, hierarchicalUs, flatUs, averageRatio, mismatches, updateMs * 1000.0 / pathfindingBenchmarkRoads);
+		return mismatches == 0 ? 0 : 1;
+	}
+
+}
+
+int Archipelago::runBenchmark(const std::string& name, const BenchmarkOptions& options) {
+	if (options.mapSize > maxGeneratedMapSize) {
+		std::printf("Map size is limited to %u\n", maxGeneratedMapSize);
+		return 1;
+	}
+	createLogger();
+	if (name == "mapgen") return benchmarkMapGen(options);
+	if (name == "mapload") return benchmarkMapLoad(options);
+	if (name == "economy") return benchmarkEconomy(options);
+	if (name == "settlements") return benchmarkSettlements(options);
+	if (name == "aibuilder") return benchmarkAiBuilder(options);
+	if (name == "pathfinding") return benchmarkPathfinding(options);
+	std::printf("Unknown benchmark '%s'. Available benchmarks: mapgen, mapload, economy, settlements, aibuilder, pathfinding\n", name.c_str());
+	return 1;
+}
+
+int Archipelago::generateMapFile(const std::string& fileName, const BenchmarkOptions& options) {
+	if (options.mapSize > maxGeneratedMapSize) {
+		std::printf("Map size is limited to %u\n", maxGeneratedMapSize);
+		return 1;
+	}
+	createLogger();
+	unsigned int size = options.mapSize ? options.mapSize : generatedMapDefaultSize;
+	MapData map;
+	generateMap(makeGeneratorSettings(size, options.seed), map);
+	if (!saveMapFile(map, fileName)) {
+		std::printf("Can't write map file '%s'\n", fileName.c_str());
+		return 1;
+	}
+	std::printf("Generated %ux%u map with seed %u to '%s'\n", map.mapWidth, map.mapHeight, options.seed, fileName.c_str());
+	return 0;
+}
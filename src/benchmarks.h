@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Archipelago {
+
+	/// Command line options shared by benchmarks and map generation
+	struct BenchmarkOptions {
+		unsigned int mapSize{ 0 }; // tiles per side, 0 = benchmark default
+		uint32_t seed{ 1 };
+	};
+
+	/** Runs named benchmark headlessly and prints results to stdout (and log).
+	* Returns process exit code, non-zero if benchmark is unknown or failed.
+	*/
+	int runBenchmark(const std::string& name, const BenchmarkOptions& options);
+	/// Generates procedural map and saves it, binary format if file name ends with ".amap"
+	int generateMapFile(const std::string& fileName, const BenchmarkOptions& options);
+
+} // namespace Archipelago
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+namespace Archipelago {
+
+	/** Append-only binary writer over a byte buffer.
+	* Values are stored in host byte order, which is little-endian on every platform we ship.
+	*/
+	class BinaryWriter {
+	public:
+		explicit BinaryWriter(std::vector<char>& buffer) : _buffer(buffer) {};
+		template<typename T>
+		void write(T value) {
+			static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::write requires trivially copyable type");
+			writeBytes(&value, sizeof(T));
+		}
+		void writeBytes(const void* data, size_t size) {
+			const char* bytes = static_cast<const char*>(data);
+			_buffer.insert(_buffer.end(), bytes, bytes + size);
+		}
+		void writeString(const std::string& s) {
+			write<uint32_t>(static_cast<uint32_t>(s.size()));
+			writeBytes(s.data(), s.size());
+		}
+		size_t size() const { return _buffer.size(); };
+	private:
+		std::vector<char>& _buffer;
+	};
+
+	/** Bounds-checked binary reader, counterpart of BinaryWriter.
+	* Every read returns false once the input is exhausted, so parsers can bail out on truncated files.
+	*/
+	class BinaryReader {
+	public:
+		BinaryReader(const char* data, size_t size) : _data(data), _size(size), _pos(0) {};
+		template<typename T>
+		bool read(T& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "BinaryReader::read requires trivially copyable type");
+			return readBytes(&value, sizeof(T));
+		}
+		bool readBytes(void* data, size_t size) {
+			if (size > _size - _pos) return false;
+			std::memcpy(data, _data + _pos, size);
+			_pos += size;
+			return true;
+		}
+		bool readString(std::string& s) {
+			uint32_t length;
+			if (!read(length) || length > _size - _pos) return false;
+			s.assign(_data + _pos, length);
+			_pos += length;
+			return true;
+		}
+		const char* current() const { return _data + _pos; };
+		size_t remaining() const { return _size - _pos; };
+	private:
+		const char* _data;
+		size_t _size;
+		size_t _pos;
+	};
+
+} // namespace Archipelago
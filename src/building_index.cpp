@@ -0,0 +1,119 @@
+#include <algorithm>
+#include "building_index.h"
+
+using namespace Archipelago;
+
+namespace {
+
+	uint64_t squaredDistance(const IndexedBuilding& building, unsigned int x, unsigned int y) {
+		int64_t dx = static_cast<int64_t>(building.x) - x, dy = static_cast<int64_t>(building.y) - y;
+		return static_cast<uint64_t>(dx * dx + dy * dy);
+	}
+
+	bool rowMajorLess(const IndexedBuilding& a, const IndexedBuilding& b) {
+		return a.y != b.y ? a.y < b.y : a.x < b.x;
+	}
+
+}
+
+void BuildingIndex::reset(unsigned int mapWidth, unsigned int mapHeight) {
+	_mapWidth = mapWidth;
+	_mapHeight = mapHeight;
+	_bucketsX = (mapWidth + buildingIndexBucketSize - 1) / buildingIndexBucketSize;
+	_bucketsY = (mapHeight + buildingIndexBucketSize - 1) / buildingIndexBucketSize;
+	_buckets.assign(static_cast<size_t>(_bucketsX) * _bucketsY, std::vector<IndexedBuilding>());
+	_count = 0;
+	std::fill(std::begin(_typeCounts), std::end(_typeCounts), 0);
+}
+
+bool BuildingIndex::insert(const IndexedBuilding& building) {
+	if (building.x >= _mapWidth || building.y >= _mapHeight) return false;
+	std::vector<IndexedBuilding>& bucket = _buckets[_bucketAt(building.x, building.y)];
+	auto it = std::lower_bound(bucket.begin(), bucket.end(), building, rowMajorLess);
+	if (it != bucket.end() && it->x == building.x && it->y == building.y) return false;
+	bucket.insert(it, building);
+	++_count;
+	++_typeCounts[static_cast<size_t>(building.type)];
+	return true;
+}
+
+const IndexedBuilding* BuildingIndex::find(unsigned int x, unsigned int y) const {
+	if (x >= _mapWidth || y >= _mapHeight) return nullptr;
+	const std::vector<IndexedBuilding>& bucket = _buckets[_bucketAt(x, y)];
+	IndexedBuilding key{ x, y, BuildingTypeId::Unknown, 0 };
+	auto it = std::lower_bound(bucket.begin(), bucket.end(), key, rowMajorLess);
+	return it != bucket.end() && it->x == x && it->y == y ? &*it : nullptr;
+}
+
+template<typename Visitor>
+void BuildingIndex::_visitRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, Visitor visit) const {
+	if (_buckets.empty() || x0 > x1 || y0 > y1 || x0 >= _mapWidth || y0 >= _mapHeight) return;
+	x1 = std::min(x1, _mapWidth - 1);
+	y1 = std::min(y1, _mapHeight - 1);
+	for (unsigned int by = y0 / buildingIndexBucketSize; by <= y1 / buildingIndexBucketSize; by++) {
+		for (unsigned int bx = x0 / buildingIndexBucketSize; bx <= x1 / buildingIndexBucketSize; bx++) {
+			for (const IndexedBuilding& building : _buckets[static_cast<size_t>(by) * _bucketsX + bx]) {
+				visit(building);
+			}
+		}
+	}
+}
+
+void BuildingIndex::queryRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, std::vector<IndexedBuilding>& out) const {
+	out.clear();
+	_visitRect(x0, y0, x1, y1, [&](const IndexedBuilding& building) {
+		if (building.x >= x0 && building.x <= x1 && building.y >= y0 && building.y <= y1) out.push_back(building);
+	});
+}
+
+bool BuildingIndex::anyInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const {
+	bool found = false;
+	_visitRect(x0, y0, x1, y1, [&](const IndexedBuilding& building) {
+		found = found || (building.x >= x0 && building.x <= x1 && building.y >= y0 && building.y <= y1);
+	});
+	return found;
+}
+
+void BuildingIndex::queryRadius(unsigned int x, unsigned int y, unsigned int radius, std::vector<IndexedBuilding>& out) const {
+	out.clear();
+	uint64_t squaredRadius = static_cast<uint64_t>(radius) * radius;
+	_visitRect(x > radius ? x - radius : 0, y > radius ? y - radius : 0, x + radius, y + radius, [&](const IndexedBuilding& building) {
+		if (squaredDistance(building, x, y) <= squaredRadius) out.push_back(building);
+	});
+}
+
+void BuildingIndex::queryNearest(unsigned int x, unsigned int y, size_t k, std::vector<IndexedBuilding>& out, BuildingTypeId type) const {
+	out.clear();
+	if (k == 0 || _buckets.empty()) return;
+	if (type != BuildingTypeId::Unknown && _typeCounts[static_cast<size_t>(type)] == 0) return;
+	auto nearer = [x, y](const IndexedBuilding& a, const IndexedBuilding& b) {
+		uint64_t da = squaredDistance(a, x, y), db = squaredDistance(b, x, y);
+		return da != db ? da < db : rowMajorLess(a, b);
+	};
+	// Rings of buckets around the tile's bucket, until no unvisited bucket can hold anything nearer than the k-th candidate
+	int centerX = static_cast<int>(std::min(x, _mapWidth - 1) / buildingIndexBucketSize);
+	int centerY = static_cast<int>(std::min(y, _mapHeight - 1) / buildingIndexBucketSize);
+	int maxRing = std::max(std::max(centerX, static_cast<int>(_bucketsX) - 1 - centerX), std::max(centerY, static_cast<int>(_bucketsY) - 1 - centerY));
+	for (int ring = 0; ring <= maxRing; ring++) {
+		for (int by = centerY - ring; by <= centerY + ring; by++) {
+			if (by < 0 || by >= static_cast<int>(_bucketsY)) continue;
+			bool edgeRow = by == centerY - ring || by == centerY + ring;
+			for (int bx = centerX - ring; bx <= centerX + ring; bx += edgeRow ? 1 : 2 * ring) {
+				if (bx >= 0 && bx < static_cast<int>(_bucketsX)) {
+					for (const IndexedBuilding& building : _buckets[static_cast<size_t>(by) * _bucketsX + bx]) {
+						if (type == BuildingTypeId::Unknown || building.type == type) out.push_back(building);
+					}
+				}
+				if (ring == 0) break;
+			}
+		}
+		if (out.size() >= k) {
+			std::nth_element(out.begin(), out.begin() + (k - 1), out.end(), nearer);
+			// Tiles of the next ring are at least ring * bucket size + 1 away along one axis
+			uint64_t nextRingDistance = static_cast<uint64_t>(ring) * buildingIndexBucketSize + 1;
+			if (squaredDistance(out[k - 1], x, y) <= nextRingDistance * nextRingDistance) break;
+		}
+	}
+	std::sort(out.begin(), out.end(), nearer);
+	if (out.size() > k) out.resize(k);
+}
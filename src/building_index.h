@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "building_specification.h"
+#include "settlement.h"
+
+namespace Archipelago {
+
+	const unsigned int buildingIndexBucketSize{ 16 }; /// bucket side in tiles
+
+	/// Placed building, all the game keeps of it outside settlements and simulation: rendering and queries need no more
+	struct IndexedBuilding {
+		unsigned int x;
+		unsigned int y;
+		BuildingTypeId type;
+		SettlementId owner;
+	};
+
+	/** Spatial index of placed buildings: uniform grid of square buckets over the map.
+	* A bucket keeps buildings of its tiles in row-major order. Queries visit only buckets
+	* overlapping the queried area, so their cost grows with area and results, not with the number of buildings.
+	* Distances are euclidean, in tiles. Queries replace contents of out.
+	*/
+	class BuildingIndex {
+	public:
+		/// Empties index for map of given size
+		void reset(unsigned int mapWidth, unsigned int mapHeight);
+		/// Returns false if tile is outside the map or already has a building
+		bool insert(const IndexedBuilding& building);
+		/// Building on tile or nullptr. Pointer is valid until next insert
+		const IndexedBuilding* find(unsigned int x, unsigned int y) const;
+		size_t getCount() const { return _count; };
+		size_t getCount(BuildingTypeId type) const { return _typeCounts[static_cast<size_t>(type)]; };
+		/// Buildings within inclusive tile rectangle, bucket by bucket
+		void queryRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, std::vector<IndexedBuilding>& out) const;
+		bool anyInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const;
+		void queryRadius(unsigned int x, unsigned int y, unsigned int radius, std::vector<IndexedBuilding>& out) const;
+		/// Up to k buildings nearest to tile, nearest first. BuildingTypeId::Unknown matches any type
+		void queryNearest(unsigned int x, unsigned int y, size_t k, std::vector<IndexedBuilding>& out, BuildingTypeId type = BuildingTypeId::Unknown) const;
+	private:
+		size_t _bucketAt(unsigned int x, unsigned int y) const { return static_cast<size_t>(y / buildingIndexBucketSize) * _bucketsX + x / buildingIndexBucketSize; };
+		/// Calls visit for every building of buckets overlapping inclusive tile rectangle, clamped to the map
+		template<typename Visitor>
+		void _visitRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1, Visitor visit) const;
+
+		unsigned int _mapWidth{ 0 };
+		unsigned int _mapHeight{ 0 };
+		unsigned int _bucketsX{ 0 };
+		unsigned int _bucketsY{ 0 };
+		std::vector<std::vector<IndexedBuilding>> _buckets; // row-major
+		size_t _count{ 0 };
+		size_t _typeCounts[buildingTypeCount]{};
+	};
+
+} // namespace Archipelago
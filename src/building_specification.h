@@ -1,27 +1,32 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "natural_resources_specification.h"
+#include "spec_ids.h"
+#include "texture_handle.h"
 #include "wares_specification.h"
 
-class sf::Texture;
-
 namespace Archipelago {
 
-	enum class BuildingTypeId { Unknown = 0, BaseCamp = 1, Woodcutter = 2, Farm = 3, _Last = Farm, _First = BaseCamp };
+	const int consumedWaresScale{ 1000 }; /// consumption rates are kept in thousandths of a ware
 
 	struct BuildingSpecification {
 		BuildingTypeId id;
 		std::string name;
 		std::string description;
-		sf::Texture* icon; // non-owning pointer
+		TextureHandle icon{ noTextureHandle }; // loaded on first use
 		unsigned int tileRising;
-		unsigned int maxAllowedOnMap; // 0 = unlimited
+		unsigned int maxAllowedOnMap; // per settlement, 0 = unlimited
 		NaturalResourceTypeId natresRequired;
+		unsigned int natresRadius; // steps from building tile within which natresRequired must be, 0 = on the tile itself
+		bool isStorage; // produced wares of other buildings are carried here
+		unsigned int workers; // people the building employs, production drops when settlement has fewer
 		std::vector<WaresStack> waresRequired;
 		std::vector<BuildingTypeId> buildingsRequired;
 		std::vector<WaresStack> providedInstantWares;
 		std::vector<WaresStack> waresProduced;
+		std::vector<WaresStack> waresConsumed; // every month, amounts in 1/consumedWaresScale of a ware
 	};
 
 }
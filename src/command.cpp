@@ -0,0 +1,105 @@
+#include "command.h"
+#include "binary_stream.h"
+#include "file_utils.h"
+
+namespace Archipelago {
+
+	const uint32_t commandRecordingMagic{ 0x52435241 }; // "ARCR"
+	const uint32_t commandRecordingVersion{ 1 };
+
+}
+
+using namespace Archipelago;
+
+namespace {
+	Command makeCommand(CommandType type) {
+		Command command{};
+		command.type = type;
+		command.building = BuildingTypeId::Unknown;
+		command.zoomFactor = 1.0f;
+		return command;
+	}
+}
+
+Command Command::selectBuilding(BuildingTypeId building) {
+	Command command = makeCommand(CommandType::SelectBuilding);
+	command.building = building;
+	return command;
+}
+
+Command Command::placeBuilding(BuildingTypeId building, unsigned int tileX, unsigned int tileY) {
+	Command command = makeCommand(CommandType::PlaceBuilding);
+	command.building = building;
+	command.tileX = tileX;
+	command.tileY = tileY;
+	return command;
+}
+
+Command Command::changeSpeed(int speedStep) {
+	Command command = makeCommand(CommandType::ChangeSpeed);
+	command.speedStep = speedStep;
+	return command;
+}
+
+Command Command::moveCamera(float offsetX, float offsetY) {
+	Command command = makeCommand(CommandType::MoveCamera);
+	command.offsetX = offsetX;
+	command.offsetY = offsetY;
+	return command;
+}
+
+Command Command::zoomCamera(float zoomFactor) {
+	Command command = makeCommand(CommandType::ZoomCamera);
+	command.zoomFactor = zoomFactor;
+	return command;
+}
+
+bool Archipelago::saveCommandRecording(const CommandRecording& recording, const std::string& fileName) {
+	std::vector<char> buffer;
+	BinaryWriter writer(buffer);
+	writer.write<uint32_t>(commandRecordingMagic);
+	writer.write<uint32_t>(commandRecordingVersion);
+	writer.writeString(recording.mapFileName);
+	writer.write<uint32_t>(static_cast<uint32_t>(recording.commands.size()));
+	for (const Command& command : recording.commands) {
+		writer.write<uint8_t>(static_cast<uint8_t>(command.type));
+		writer.write<uint32_t>(command.gameTime);
+		writer.write<uint32_t>(command.monthProgress);
+		writer.write<uint32_t>(static_cast<uint32_t>(command.building));
+		writer.write<uint32_t>(command.tileX);
+		writer.write<uint32_t>(command.tileY);
+		writer.write<int32_t>(command.speedStep);
+		writer.write<float>(command.offsetX);
+		writer.write<float>(command.offsetY);
+		writer.write<float>(command.zoomFactor);
+	}
+	return FileUtils::writeFileAtomically(fileName, buffer.data(), buffer.size());
+}
+
+bool Archipelago::loadCommandRecording(const std::string& fileName, CommandRecording& recording) {
+	std::vector<char> buffer;
+	if (!FileUtils::readFile(fileName, buffer)) return false;
+	BinaryReader reader(buffer.data(), buffer.size());
+	uint32_t magic, version, count;
+	if (!reader.read(magic) || magic != commandRecordingMagic) return false;
+	if (!reader.read(version) || version != commandRecordingVersion) return false;
+	if (!reader.readString(recording.mapFileName)) return false;
+	if (!reader.read(count)) return false;
+	recording.commands.clear();
+	recording.commands.reserve(count);
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t type;
+		uint32_t building;
+		Command command = makeCommand(CommandType::SelectBuilding);
+		if (!reader.read(type) || !reader.read(command.gameTime) || !reader.read(command.monthProgress) ||
+			!reader.read(building) || !reader.read(command.tileX) || !reader.read(command.tileY) ||
+			!reader.read(command.speedStep) || !reader.read(command.offsetX) || !reader.read(command.offsetY) ||
+			!reader.read(command.zoomFactor)) {
+			return false;
+		}
+		command.type = static_cast<CommandType>(type);
+		command.building = static_cast<BuildingTypeId>(building);
+		recording.commands.push_back(command);
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "building_specification.h"
+
+namespace Archipelago {
+
+	enum class CommandType : uint8_t { SelectBuilding = 0, PlaceBuilding = 1, ChangeSpeed = 2, MoveCamera = 3, ZoomCamera = 4 };
+
+	/** Player action in serializable form.
+	* Everything the player does to the game goes through a Command, so a session can be recorded
+	* and later replayed. Only fields relevant to the command type are meaningful.
+	*/
+	struct Command {
+		CommandType type;
+		unsigned int gameTime; // Game month the command was issued in
+		unsigned int monthProgress; // Realtime milliseconds elapsed within that month
+		BuildingTypeId building; // SelectBuilding, PlaceBuilding
+		unsigned int tileX; // PlaceBuilding
+		unsigned int tileY; // PlaceBuilding
+		int speedStep; // ChangeSpeed: +1 faster, -1 slower
+		float offsetX; // MoveCamera
+		float offsetY; // MoveCamera
+		float zoomFactor; // ZoomCamera
+
+		static Command selectBuilding(BuildingTypeId building);
+		static Command placeBuilding(BuildingTypeId building, unsigned int tileX, unsigned int tileY);
+		static Command changeSpeed(int speedStep);
+		static Command moveCamera(float offsetX, float offsetY);
+		static Command zoomCamera(float zoomFactor);
+	};
+
+	/// Recorded session: map it was played on and all issued commands in order
+	struct CommandRecording {
+		std::string mapFileName;
+		std::vector<Command> commands;
+	};
+
+	bool saveCommandRecording(const CommandRecording& recording, const std::string& fileName);
+	bool loadCommandRecording(const std::string& fileName, CommandRecording& recording);
+
+} // namespace Archipelago
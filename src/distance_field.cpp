@@ -0,0 +1,76 @@
+#include <algorithm>
+#include "distance_field.h"
+
+using namespace Archipelago;
+
+void DistanceField::reset(const LogisticsGrid& grid) {
+	_distance.assign(grid.cost.size(), unreachedDistance);
+	_nearestSource.assign(grid.cost.size(), noFieldSource);
+}
+
+void DistanceField::build(const LogisticsGrid& grid, const std::vector<uint32_t>& sourceTiles) {
+	reset(grid);
+	_queue.clear();
+	for (size_t source = 0; source < sourceTiles.size(); source++) {
+		uint32_t tile = sourceTiles[source];
+		if (_distance[tile] == 0) continue; // first source of a tile wins
+		_distance[tile] = 0;
+		_nearestSource[tile] = static_cast<uint32_t>(source);
+		_queue.push_back(tile);
+	}
+	_propagate(grid);
+}
+
+void DistanceField::addSource(const LogisticsGrid& grid, uint32_t tile, uint32_t sourceId) {
+	if (_distance[tile] == 0) return;
+	_distance[tile] = 0;
+	_nearestSource[tile] = sourceId;
+	_queue.clear();
+	_queue.push_back(tile);
+	_propagate(grid);
+}
+
+void DistanceField::openTile(const LogisticsGrid& grid, uint32_t tile) {
+	if (grid.cost[tile] == impassableTileCost) return;
+	unsigned int x = tile % grid.width, y = tile / grid.width;
+	const uint32_t neighbours[4] = {
+		x > 0 ? tile - 1 : tile,
+		x + 1 < grid.width ? tile + 1 : tile,
+		y > 0 ? tile - grid.width : tile,
+		y + 1 < grid.height ? tile + grid.width : tile
+	};
+	// The tile may now be reached through any neighbour, and everything behind it through the tile
+	for (uint32_t neighbour : neighbours) {
+		if (neighbour == tile || _distance[neighbour] == unreachedDistance) continue;
+		if (static_cast<unsigned int>(_distance[neighbour]) + 1 < _distance[tile] && _distance[neighbour] < _maxDistance) {
+			_distance[tile] = _distance[neighbour] + 1;
+			_nearestSource[tile] = _nearestSource[neighbour];
+		}
+	}
+	if (_distance[tile] == unreachedDistance) return;
+	_queue.clear();
+	_queue.push_back(tile);
+	_propagate(grid);
+}
+
+void DistanceField::_propagate(const LogisticsGrid& grid) {
+	// Every step adds one, so a plain FIFO visits tiles in order of distance. Queue is consumed front to back without popping
+	for (size_t head = 0; head < _queue.size(); head++) {
+		uint32_t tile = _queue[head];
+		unsigned int next = _distance[tile] + 1u;
+		if (next > _maxDistance) continue;
+		unsigned int x = tile % grid.width, y = tile / grid.width;
+		const uint32_t neighbours[4] = {
+			x > 0 ? tile - 1 : tile,
+			x + 1 < grid.width ? tile + 1 : tile,
+			y > 0 ? tile - grid.width : tile,
+			y + 1 < grid.height ? tile + grid.width : tile
+		};
+		for (uint32_t neighbour : neighbours) {
+			if (neighbour == tile || grid.cost[neighbour] == impassableTileCost || _distance[neighbour] <= next) continue;
+			_distance[neighbour] = static_cast<uint16_t>(next);
+			_nearestSource[neighbour] = _nearestSource[tile];
+			_queue.push_back(neighbour);
+		}
+	}
+}
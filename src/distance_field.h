@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "hierarchical_pathfinder.h"
+
+namespace Archipelago {
+
+	const uint16_t unreachedDistance{ 0xFFFF };
+	const unsigned int defaultFieldDistance{ 64 }; /// fields are computed this many steps around sources, tiles further away stay unreached
+	const uint32_t noFieldSource{ ~0u };
+
+	/** Distance of every tile to the nearest of a set of source tiles, in steps over passable tiles.
+	* Made by multi-source breadth-first search and kept up to date incrementally: sources can only be added
+	* and tiles can only turn passable (roads), so distances only ever shrink and every update is a BFS
+	* from the changed tiles that stops wherever it doesn't improve anything.
+	* Distances and nearest sources are separate dense row-major arrays, so a lookup is one load
+	* and scans over many tiles (e.g. "how much forest is within radius") read contiguous uint16 rows.
+	* Sources themselves may be impassable, e.g. lake tiles for fresh water.
+	*/
+	class DistanceField {
+	public:
+		explicit DistanceField(unsigned int maxDistance = defaultFieldDistance) : _maxDistance(maxDistance) {};
+		/// Clears field to size of the grid, no tile is reached
+		void reset(const LogisticsGrid& grid);
+		/// Full rebuild from a set of sources, source ids are their positions in the vector
+		void build(const LogisticsGrid& grid, const std::vector<uint32_t>& sourceTiles);
+		/// Adds source tile with given id, e.g. a building index
+		void addSource(const LogisticsGrid& grid, uint32_t tile, uint32_t sourceId);
+		/// Call after a tile of the grid turned passable
+		void openTile(const LogisticsGrid& grid, uint32_t tile);
+		uint16_t getDistance(uint32_t tile) const { return _distance[tile]; };
+		/// Id of nearest source, noFieldSource if no source is within maxDistance
+		uint32_t getNearestSource(uint32_t tile) const { return _nearestSource[tile]; };
+		bool isEmpty() const { return _distance.empty(); };
+	private:
+		/// BFS from tiles in _queue, improving distances only
+		void _propagate(const LogisticsGrid& grid);
+
+		unsigned int _maxDistance;
+		std::vector<uint16_t> _distance;
+		std::vector<uint32_t> _nearestSource;
+		std::vector<uint32_t> _queue; // BFS frontier, reused
+	};
+
+} // namespace Archipelago
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <iterator>
+#include "economy.h"
+#include "economy_forecast.h"
+#include "job_system.h"
+
+namespace Archipelago {
+
+	const size_t economyBlockSize{ 1024 }; /// buildings per block, the unit of parallel work and of reduction
+
+}
+
+using namespace Archipelago;
+
+void Archipelago::consumeEconomyMonth(const int64_t (&needsMatrix)[economyNeedsRows][economyWaresCount], const int64_t (&workers)[economyNeedsRows],
+	const int64_t (&typeCounts)[economyNeedsRows], int64_t (&stock)[economyWaresCount], int64_t (&needsRemainder)[economyWaresCount],
+	unsigned int (&typeEfficiency)[economyNeedsRows]) {
+	const size_t peopleIndex = static_cast<size_t>(WaresTypeId::People) - static_cast<size_t>(WaresTypeId::_First);
+	int64_t available[economyWaresCount]; // wares in debt count as none
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		available[wareIndex] = std::max<int64_t>(stock[wareIndex], 0);
+	}
+	int64_t people = available[peopleIndex];
+	int64_t workersNeeded = 0;
+	for (size_t row = 1; row < economyNeedsRows; row++) {
+		workersNeeded += typeCounts[row] * workers[row];
+	}
+	int64_t staffing = workersNeeded > people ? people * fullBuildingEfficiency / workersNeeded : fullBuildingEfficiency;
+
+	// Working units in per mille: all people, and buildings as far as they are staffed. Those without workers always run
+	int64_t units[economyNeedsRows];
+	units[0] = people * fullBuildingEfficiency;
+	for (size_t row = 1; row < economyNeedsRows; row++) {
+		units[row] = typeCounts[row] * (workers[row] > 0 ? staffing : fullBuildingEfficiency);
+	}
+	// Needs of the month are units times the matrix. Plain loops over fixed size arrays, compilers vectorize the inner one
+	const int64_t needsScale = static_cast<int64_t>(consumedWaresScale) * fullBuildingEfficiency;
+	int64_t needs[economyWaresCount];
+	std::copy(std::begin(needsRemainder), std::end(needsRemainder), needs);
+	for (size_t row = 0; row < economyNeedsRows; row++) {
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+			needs[wareIndex] += units[row] * needsMatrix[row][wareIndex];
+		}
+	}
+	// Whole wares are taken from stockpile as far as there are any, fractions wait for next month. Unmet needs are not carried over
+	int64_t supply[economyWaresCount]; // per mille of needs met
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		int64_t whole = needs[wareIndex] / needsScale;
+		needsRemainder[wareIndex] = needs[wareIndex] - whole * needsScale;
+		int64_t taken = std::min(whole, available[wareIndex]);
+		supply[wareIndex] = whole > 0 ? taken * fullBuildingEfficiency / whole : fullBuildingEfficiency;
+		if (stock[wareIndex] > 0) {
+			stock[wareIndex] -= taken;
+		}
+	}
+
+	// A building type works as well as its staff and its worst supplied need allow. Hungry workers work worse, too
+	for (size_t row = 1; row < economyNeedsRows; row++) {
+		int64_t worstSupply = fullBuildingEfficiency;
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+			if (needsMatrix[row][wareIndex] > 0 || (workers[row] > 0 && needsMatrix[0][wareIndex] > 0)) {
+				worstSupply = std::min(worstSupply, supply[wareIndex]);
+			}
+		}
+		typeEfficiency[row] = static_cast<unsigned int>((workers[row] > 0 ? staffing : fullBuildingEfficiency) * worstSupply / fullBuildingEfficiency);
+	}
+}
+
+Economy::Economy(JobSystem* jobSystem) :
+	_jobSystem(jobSystem) {
+	reset();
+}
+
+void Economy::reset() {
+	_buildings.clear();
+	std::fill(&_deliveries[0][0], &_deliveries[0][0] + maxDeliveryMonths * economyWaresCount, 0);
+	std::fill(&_needs[0][0], &_needs[0][0] + economyNeedsRows * economyWaresCount, 0);
+	std::fill(std::begin(_workers), std::end(_workers), 0);
+	std::fill(std::begin(_typeCounts), std::end(_typeCounts), 0);
+	std::fill(&_typeProduction[0][0][0], &_typeProduction[0][0][0] + economyNeedsRows * maxDeliveryMonths * economyWaresCount, 0);
+	std::fill(std::begin(_needsRemainder), std::end(_needsRemainder), 0);
+	std::fill(std::begin(_productionRemainder), std::end(_productionRemainder), 0);
+	std::fill(std::begin(_typeEfficiency), std::end(_typeEfficiency), fullBuildingEfficiency);
+	_month = 0;
+	for (const WaresStack& need : personNeeds) {
+		_needs[0][static_cast<size_t>(need.type) - static_cast<size_t>(WaresTypeId::_First)] += need.amount;
+	}
+}
+
+void Economy::addBuilding(const BuildingSpecification* spec, unsigned int x, unsigned int y, unsigned int efficiency) {
+	_buildings.push_back({ spec, x, y, efficiency, 0 });
+	_addTypeProduction(_buildings.back(), 1);
+	size_t row = static_cast<size_t>(spec->id);
+	if (row == 0 || row >= economyNeedsRows) return;
+	// Every building of a type has the same specification, row is just refreshed
+	_fillNeedsRow(*spec);
+	++_typeCounts[row];
+}
+
+void Economy::refreshSpecifications() {
+	bool isFilled[economyNeedsRows]{};
+	std::fill(&_typeProduction[0][0][0], &_typeProduction[0][0][0] + economyNeedsRows * maxDeliveryMonths * economyWaresCount, 0);
+	for (const EconomyBuilding& building : _buildings) {
+		_addTypeProduction(building, 1);
+		size_t row = static_cast<size_t>(building.spec->id);
+		if (row == 0 || row >= economyNeedsRows || isFilled[row]) continue;
+		_fillNeedsRow(*building.spec);
+		isFilled[row] = true;
+	}
+}
+
+void Economy::setDeliveryMonths(size_t building, unsigned int months) {
+	_addTypeProduction(_buildings[building], -1);
+	_buildings[building].deliveryMonths = months;
+	_addTypeProduction(_buildings[building], 1);
+}
+
+void Economy::captureForecast(EconomyForecast& forecast) const {
+	std::copy(&_needs[0][0], &_needs[0][0] + economyNeedsRows * economyWaresCount, &forecast._needs[0][0]);
+	std::copy(std::begin(_workers), std::end(_workers), forecast._workers);
+	std::copy(std::begin(_typeCounts), std::end(_typeCounts), forecast._typeCounts);
+	std::copy(&_typeProduction[0][0][0], &_typeProduction[0][0][0] + economyNeedsRows * maxDeliveryMonths * economyWaresCount, &forecast._typeProduction[0][0][0]);
+	std::copy(std::begin(_needsRemainder), std::end(_needsRemainder), forecast._needsRemainder);
+	std::copy(std::begin(_productionRemainder), std::end(_productionRemainder), forecast._productionRemainder);
+	// Calendar is rotated so that next month's arrivals come first
+	for (unsigned int months = 0; months < maxDeliveryMonths; months++) {
+		const int64_t* arrival = _deliveries[(_month + months) % maxDeliveryMonths];
+		std::copy(arrival, arrival + economyWaresCount, forecast._deliveries[months]);
+	}
+}
+
+void Economy::_addTypeProduction(const EconomyBuilding& building, int64_t sign) {
+	if (building.deliveryMonths >= maxDeliveryMonths) return;
+	size_t row = static_cast<size_t>(building.spec->id);
+	if (row >= economyNeedsRows) row = 0;
+	for (const WaresStack& produced : building.spec->waresProduced) {
+		size_t wareIndex = static_cast<size_t>(produced.type) - static_cast<size_t>(WaresTypeId::_First);
+		if (wareIndex < economyWaresCount) {
+			_typeProduction[row][building.deliveryMonths][wareIndex] += sign * produced.amount * building.efficiency;
+		}
+	}
+}
+
+void Economy::_fillNeedsRow(const BuildingSpecification& spec) {
+	size_t row = static_cast<size_t>(spec.id);
+	std::fill(std::begin(_needs[row]), std::end(_needs[row]), 0);
+	for (const WaresStack& consumed : spec.waresConsumed) {
+		size_t wareIndex = static_cast<size_t>(consumed.type) - static_cast<size_t>(WaresTypeId::_First);
+		if (wareIndex < economyWaresCount) {
+			_needs[row][wareIndex] += consumed.amount;
+		}
+	}
+	_workers[row] = spec.workers;
+}
+
+void Economy::tick(std::vector<WaresStack>& stockpile) {
+	_consume(stockpile);
+	size_t blockCount = (_buildings.size() + economyBlockSize - 1) / economyBlockSize;
+	const size_t blockDeltaSize = maxDeliveryMonths * economyWaresCount;
+	_blockDeltas.assign(blockCount * blockDeltaSize, 0);
+
+	auto computeBlocks = [this](size_t begin, size_t end) {
+		for (size_t block = begin; block < end; block++) {
+			_computeBlock(block);
+		}
+	};
+	if (_jobSystem) {
+		// A few batches per thread balance the load, batching doesn't move block boundaries
+		_jobSystem->parallelFor(blockCount, blockCount / (_jobSystem->getThreadCount() * 4) + 1, computeBlocks);
+	}
+	else {
+		computeBlocks(0, blockCount);
+	}
+
+	// Deterministic reduction: always in block order
+	for (size_t block = 0; block < blockCount; block++) {
+		const int64_t* delta = &_blockDeltas[block * blockDeltaSize];
+		for (unsigned int months = 0; months < maxDeliveryMonths; months++) {
+			int64_t* arrival = _deliveries[(_month + months) % maxDeliveryMonths];
+			for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+				arrival[wareIndex] += delta[months * economyWaresCount + wareIndex];
+			}
+		}
+	}
+	// Wares travel in millionths, so that buildings working below full efficiency still add up to whole wares
+	const int64_t productionScale = static_cast<int64_t>(fullBuildingEfficiency) * fullBuildingEfficiency;
+	int64_t* arrived = _deliveries[_month % maxDeliveryMonths];
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		arrived[wareIndex] += _productionRemainder[wareIndex];
+		_productionRemainder[wareIndex] = arrived[wareIndex] % productionScale;
+	}
+	for (WaresStack& ware : stockpile) {
+		size_t wareIndex = static_cast<size_t>(ware.type) - static_cast<size_t>(WaresTypeId::_First);
+		if (wareIndex < economyWaresCount) {
+			ware.amount += static_cast<int>(arrived[wareIndex] / productionScale);
+		}
+	}
+	std::fill(arrived, arrived + economyWaresCount, 0);
+	++_month;
+}
+
+void Economy::_consume(std::vector<WaresStack>& stockpile) {
+	int64_t stock[economyWaresCount] = {};
+	for (const WaresStack& ware : stockpile) {
+		size_t wareIndex = static_cast<size_t>(ware.type) - static_cast<size_t>(WaresTypeId::_First);
+		if (wareIndex < economyWaresCount) {
+			stock[wareIndex] = ware.amount;
+		}
+	}
+	consumeEconomyMonth(_needs, _workers, _typeCounts, stock, _needsRemainder, _typeEfficiency);
+	for (WaresStack& ware : stockpile) {
+		size_t wareIndex = static_cast<size_t>(ware.type) - static_cast<size_t>(WaresTypeId::_First);
+		if (wareIndex < economyWaresCount) {
+			ware.amount = static_cast<int>(stock[wareIndex]);
+		}
+	}
+}
+
+void Economy::_computeBlock(size_t block) {
+	int64_t delta[maxDeliveryMonths][economyWaresCount] = {}; // accumulated locally, neighbouring blocks share cache lines
+	size_t end = std::min(_buildings.size(), (block + 1) * economyBlockSize);
+	for (size_t i = block * economyBlockSize; i < end; i++) {
+		const EconomyBuilding& building = _buildings[i];
+		if (building.deliveryMonths >= maxDeliveryMonths) continue; // without a route to storage nothing is produced
+		size_t row = static_cast<size_t>(building.spec->id);
+		int64_t efficiency = static_cast<int64_t>(building.efficiency) * (row < economyNeedsRows ? _typeEfficiency[row] : fullBuildingEfficiency);
+		for (const WaresStack& produced : building.spec->waresProduced) {
+			size_t wareIndex = static_cast<size_t>(produced.type) - static_cast<size_t>(WaresTypeId::_First);
+			if (wareIndex < economyWaresCount) {
+				delta[building.deliveryMonths][wareIndex] += static_cast<int64_t>(produced.amount) * efficiency;
+			}
+		}
+	}
+	std::copy(&delta[0][0], &delta[0][0] + maxDeliveryMonths * economyWaresCount, _blockDeltas.begin() + block * maxDeliveryMonths * economyWaresCount);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "building_specification.h"
+#include "wares_specification.h"
+
+namespace Archipelago {
+
+	const unsigned int fullBuildingEfficiency{ 1000 }; /// per mille
+	const size_t economyWaresCount{ waresTypeCount - 1 }; /// wares without Unknown
+	const unsigned int maxDeliveryMonths{ 12 }; /// wares of a building arrive at most this many months after production
+	const unsigned int noDelivery{ ~0u }; /// delivery time of a building whose wares can't reach any storage
+	const size_t economyNeedsRows{ buildingTypeCount }; /// population first, then building types by id
+	/// What every person needs each month, in 1/consumedWaresScale of a ware
+	const WaresStack personNeeds[]{ { WaresTypeId::FreshWater, 100 }, { WaresTypeId::Crops, 100 } };
+
+	/// Building as seen by the economy, kept in one contiguous array for the monthly tick
+	struct EconomyBuilding {
+		const BuildingSpecification* spec;
+		unsigned int x;
+		unsigned int y;
+		unsigned int efficiency; // per mille of specification output
+		unsigned int deliveryMonths; // travel time of produced wares to storage, noDelivery if there is no route
+	};
+
+	class JobSystem;
+	class EconomyForecast;
+
+	/** Takes needs of one month from stock, one amount per ware, and sets efficiency per building type from shortages.
+	* Shared by the economy tick and forecasts stepping its model, so that both consume alike.
+	*/
+	void consumeEconomyMonth(const int64_t (&needsMatrix)[economyNeedsRows][economyWaresCount], const int64_t (&workers)[economyNeedsRows],
+		const int64_t (&typeCounts)[economyNeedsRows], int64_t (&stock)[economyWaresCount], int64_t (&needsRemainder)[economyWaresCount],
+		unsigned int (&typeEfficiency)[economyNeedsRows]);
+
+	/** Monthly consumption and production of all settlement buildings.
+	* Consumption doesn't look at single buildings: needs of people and of every building type are rows of
+	* a fixed size matrix, filled from specifications, and monthly needs are the product of that matrix with
+	* the vector of population and building counts. Wares short of needs, and people short of workers,
+	* lower efficiency of the building types concerned for this month's production.
+	* For production, buildings are split into fixed size blocks which are computed in parallel on the job system,
+	* each into its own per-ware delta for every delivery time. Deltas are then added to the delivery
+	* calendar in block order on the calling thread, and wares arriving this month go to the stockpile.
+	* Block boundaries don't depend on thread count and all arithmetic is integer, so the result
+	* is bit-identical to single-threaded computation whatever the number of threads.
+	*/
+	class Economy {
+	public:
+		/// Without job system economy is computed on the calling thread
+		explicit Economy(JobSystem* jobSystem);
+		Economy(const Economy&) = delete;
+		/// Back to no buildings and nothing on the way, keeping allocated memory for the next run
+		void reset();
+		void addBuilding(const BuildingSpecification* spec, unsigned int x, unsigned int y, unsigned int efficiency = fullBuildingEfficiency);
+		/// Refills needs and workers of building types from specifications after they were replaced in place
+		void refreshSpecifications();
+		const std::vector<EconomyBuilding>& getBuildings() const { return _buildings; };
+		void setDeliveryMonths(size_t building, unsigned int months);
+		/// Advances economy by one game month. Stockpile holds one stack per ware type, WaresTypeId::_First first
+		void tick(std::vector<WaresStack>& stockpile);
+		/// Per mille of full output buildings of the type had last month
+		unsigned int getTypeEfficiency(BuildingTypeId type) const { return _typeEfficiency[static_cast<size_t>(type)]; };
+		/// Copies what forecasts need, a few kilobytes whatever the number of buildings
+		void captureForecast(EconomyForecast& forecast) const;
+	private:
+		/// Takes needs of the month from stockpile and sets _typeEfficiency from shortages
+		void _consume(std::vector<WaresStack>& stockpile);
+		void _computeBlock(size_t block);
+		void _fillNeedsRow(const BuildingSpecification& spec);
+		/// Adds sign times output of the building at its delivery time to _typeProduction
+		void _addTypeProduction(const EconomyBuilding& building, int64_t sign);
+
+		std::vector<EconomyBuilding> _buildings;
+		std::vector<int64_t> _blockDeltas; // [block][delivery month][ware]
+		int64_t _deliveries[maxDeliveryMonths][economyWaresCount]; // ring of wares on the way in millionths, indexed by arrival month
+		int64_t _productionRemainder[economyWaresCount]; // millionths of wares arrived but not yet whole
+		int64_t _needs[economyNeedsRows][economyWaresCount]; // per person or building, 1/consumedWaresScale of a ware a month
+		int64_t _workers[economyNeedsRows]; // per building, row 0 unused
+		int64_t _typeCounts[economyNeedsRows]; // buildings by type, row 0 unused
+		int64_t _typeProduction[economyNeedsRows][maxDeliveryMonths][economyWaresCount]; // output summed by type row and delivery time, per mille. Row 0 is buildings of unknown types
+		int64_t _needsRemainder[economyWaresCount]; // fractions of wares not yet taken from stockpile
+		unsigned int _typeEfficiency[economyNeedsRows]; // per mille, set by consumption for this month's production
+		unsigned int _month;
+		JobSystem* _jobSystem;
+	};
+
+} // namespace Archipelago
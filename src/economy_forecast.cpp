@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include "economy_forecast.h"
+
+namespace Archipelago {
+
+	const int64_t forecastProductionScale{ static_cast<int64_t>(fullBuildingEfficiency) * fullBuildingEfficiency }; /// wares travel in millionths
+	const int64_t forecastNeedsScale{ static_cast<int64_t>(consumedWaresScale) * fullBuildingEfficiency };
+
+	namespace {
+		size_t wareIndexOf(WaresTypeId type) {
+			return static_cast<size_t>(type) - static_cast<size_t>(WaresTypeId::_First);
+		}
+	}
+
+}
+
+using namespace Archipelago;
+
+EconomyForecast::EconomyForecast() :
+	_needs(),
+	_workers(),
+	_typeCounts(),
+	_typeProduction(),
+	_needsRemainder(),
+	_productionRemainder(),
+	_deliveries() {
+}
+
+void EconomyForecast::project(const std::vector<WaresStack>& stockpile, unsigned int months, std::vector<WaresStack>& out) const {
+	State state;
+	_initState(stockpile, state);
+	LinearRates rates;
+	bool isLinear = _getLinearRates(state.stock, rates) && months <= _getLinearMonths(state.stock, rates);
+	int64_t projected[economyWaresCount];
+	if (isLinear) {
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+			projected[wareIndex] = _linearStock(state.stock, rates, wareIndex, months);
+		}
+	}
+	else {
+		for (unsigned int month = 0; month < months; month++) {
+			_step(state);
+		}
+		std::copy(std::begin(state.stock), std::end(state.stock), projected);
+	}
+	out = stockpile;
+	for (WaresStack& ware : out) {
+		size_t wareIndex = wareIndexOf(ware.type);
+		if (wareIndex < economyWaresCount) {
+			ware.amount = static_cast<int>(projected[wareIndex]);
+		}
+	}
+}
+
+unsigned int EconomyForecast::monthsUntilAvailable(const std::vector<WaresStack>& stockpile, const std::vector<WaresStack>& required, unsigned int horizon) const {
+	int64_t needed[economyWaresCount] = {};
+	for (const WaresStack& ware : required) {
+		size_t wareIndex = wareIndexOf(ware.type);
+		if (wareIndex < economyWaresCount) {
+			needed[wareIndex] += ware.amount;
+		}
+	}
+	State state;
+	_initState(stockpile, state);
+	auto isAvailable = [&needed](const int64_t (&stock)[economyWaresCount]) {
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+			if (stock[wareIndex] < needed[wareIndex]) return false;
+		}
+		return true;
+	};
+	if (isAvailable(state.stock)) return 0;
+
+	LinearRates rates;
+	unsigned int linearHorizon = _getLinearRates(state.stock, rates) ? std::min(horizon, _getLinearMonths(state.stock, rates)) : 0;
+	if (linearHorizon > 0) {
+		// Every ware on its own: first month it's there, then the latest of these if all are there together
+		unsigned int months = 0;
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount && months != noForecast; wareIndex++) {
+			if (state.stock[wareIndex] >= needed[wareIndex]) continue;
+			unsigned int wareMonths = noForecast;
+			for (unsigned int month = 1; month <= std::min(linearHorizon, maxDeliveryMonths); month++) {
+				if (_linearStock(state.stock, rates, wareIndex, month) >= needed[wareIndex]) {
+					wareMonths = month;
+					break;
+				}
+			}
+			// After the delivery calendar has run through, stock changes by the same rate every month
+			double rate = static_cast<double>(rates.totalProduction[wareIndex]) / forecastProductionScale -
+				static_cast<double>(rates.needs[wareIndex]) / forecastNeedsScale;
+			if (wareMonths == noForecast && linearHorizon > maxDeliveryMonths && rate > 0) {
+				double deficit = static_cast<double>(needed[wareIndex] - _linearStock(state.stock, rates, wareIndex, maxDeliveryMonths));
+				double estimate = maxDeliveryMonths + std::ceil(deficit / rate);
+				if (estimate <= linearHorizon + 1.0) {
+					// Rounding of fractions moves the estimate by a month at most
+					unsigned int month = std::max(static_cast<unsigned int>(estimate), maxDeliveryMonths + 1);
+					while (month > maxDeliveryMonths + 1 && _linearStock(state.stock, rates, wareIndex, month - 1) >= needed[wareIndex]) --month;
+					while (month <= linearHorizon && _linearStock(state.stock, rates, wareIndex, month) < needed[wareIndex]) ++month;
+					if (month <= linearHorizon) wareMonths = month;
+				}
+			}
+			months = std::max(months, wareMonths);
+		}
+		if (months == noForecast && linearHorizon == horizon) return noForecast;
+		bool isAllAvailable = months != noForecast;
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount && isAllAvailable; wareIndex++) {
+			isAllAvailable = isAllAvailable && _linearStock(state.stock, rates, wareIndex, months) >= needed[wareIndex];
+		}
+		if (isAllAvailable) return months;
+		// Some ware was there earlier but is gone again by now, or closed form doesn't hold long enough.
+		// Only stepping tells when all are there at once
+	}
+	for (unsigned int month = 1; month <= horizon; month++) {
+		_step(state);
+		if (isAvailable(state.stock)) return month;
+	}
+	return noForecast;
+}
+
+bool EconomyForecast::isClosedForm(const std::vector<WaresStack>& stockpile, unsigned int months) const {
+	State state;
+	_initState(stockpile, state);
+	LinearRates rates;
+	return _getLinearRates(state.stock, rates) && months <= _getLinearMonths(state.stock, rates);
+}
+
+void EconomyForecast::_initState(const std::vector<WaresStack>& stockpile, State& state) const {
+	std::fill(std::begin(state.stock), std::end(state.stock), 0);
+	for (const WaresStack& ware : stockpile) {
+		size_t wareIndex = wareIndexOf(ware.type);
+		if (wareIndex < economyWaresCount) {
+			state.stock[wareIndex] = ware.amount;
+		}
+	}
+	std::copy(std::begin(_needsRemainder), std::end(_needsRemainder), state.needsRemainder);
+	std::copy(std::begin(_productionRemainder), std::end(_productionRemainder), state.productionRemainder);
+	std::copy(&_deliveries[0][0], &_deliveries[0][0] + maxDeliveryMonths * economyWaresCount, &state.deliveries[0][0]);
+	state.month = 0;
+}
+
+void EconomyForecast::_step(State& state) const {
+	unsigned int typeEfficiency[economyNeedsRows];
+	std::fill(std::begin(typeEfficiency), std::end(typeEfficiency), fullBuildingEfficiency);
+	consumeEconomyMonth(_needs, _workers, _typeCounts, state.stock, state.needsRemainder, typeEfficiency);
+	for (size_t row = 0; row < economyNeedsRows; row++) {
+		for (unsigned int months = 0; months < maxDeliveryMonths; months++) {
+			int64_t* arrival = state.deliveries[(state.month + months) % maxDeliveryMonths];
+			for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+				arrival[wareIndex] += _typeProduction[row][months][wareIndex] * typeEfficiency[row];
+			}
+		}
+	}
+	int64_t* arrived = state.deliveries[state.month % maxDeliveryMonths];
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		arrived[wareIndex] += state.productionRemainder[wareIndex];
+		state.productionRemainder[wareIndex] = arrived[wareIndex] % forecastProductionScale;
+		state.stock[wareIndex] += arrived[wareIndex] / forecastProductionScale;
+		arrived[wareIndex] = 0;
+	}
+	++state.month;
+}
+
+bool EconomyForecast::_getLinearRates(const int64_t (&stock)[economyWaresCount], LinearRates& rates) const {
+	const size_t peopleIndex = wareIndexOf(WaresTypeId::People);
+	int64_t people = std::max<int64_t>(stock[peopleIndex], 0);
+	int64_t workersNeeded = 0;
+	for (size_t row = 1; row < economyNeedsRows; row++) {
+		workersNeeded += _typeCounts[row] * _workers[row];
+	}
+	if (workersNeeded > people) return false;
+	std::fill(std::begin(rates.needs), std::end(rates.needs), 0);
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		rates.needs[wareIndex] += people * fullBuildingEfficiency * _needs[0][wareIndex];
+		for (size_t row = 1; row < economyNeedsRows; row++) {
+			rates.needs[wareIndex] += _typeCounts[row] * fullBuildingEfficiency * _needs[row][wareIndex];
+		}
+	}
+	std::fill(std::begin(rates.totalProduction), std::end(rates.totalProduction), 0);
+	for (unsigned int months = 0; months < maxDeliveryMonths; months++) {
+		for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+			int64_t production = 0;
+			for (size_t row = 0; row < economyNeedsRows; row++) {
+				production += _typeProduction[row][months][wareIndex] * fullBuildingEfficiency;
+			}
+			// Floors of running sums only match month by month rounding while nothing is negative
+			if (production < 0 || _deliveries[months][wareIndex] < 0) return false;
+			rates.production[months][wareIndex] = production;
+			rates.totalProduction[wareIndex] += production;
+		}
+	}
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		if (rates.needs[wareIndex] < 0 || _productionRemainder[wareIndex] < 0) return false;
+	}
+	// Needs scale with population, so it has to stay as it is
+	int64_t peopleOnTheWay = _productionRemainder[peopleIndex];
+	for (unsigned int months = 0; months < maxDeliveryMonths; months++) {
+		peopleOnTheWay += _deliveries[months][peopleIndex];
+	}
+	return rates.totalProduction[peopleIndex] == 0 && rates.needs[peopleIndex] == 0 && peopleOnTheWay < forecastProductionScale;
+}
+
+unsigned int EconomyForecast::_getLinearMonths(const int64_t (&stock)[economyWaresCount], const LinearRates& rates) const {
+	unsigned int linearMonths = noForecast;
+	for (size_t wareIndex = 0; wareIndex < economyWaresCount; wareIndex++) {
+		if (rates.needs[wareIndex] == 0) continue;
+		// Stock before consumption of a month has to cover its needs, i.e. stock after that month's consumption isn't negative
+		auto leftAfterNeeds = [&](unsigned int month) {
+			int64_t takenUntilNext = (_needsRemainder[wareIndex] + (month + 1) * rates.needs[wareIndex]) / forecastNeedsScale;
+			int64_t takenUntilNow = (_needsRemainder[wareIndex] + month * rates.needs[wareIndex]) / forecastNeedsScale;
+			return _linearStock(stock, rates, wareIndex, month) - (takenUntilNext - takenUntilNow);
+		};
+		for (unsigned int month = 0; month <= maxDeliveryMonths && month < linearMonths; month++) {
+			if (leftAfterNeeds(month) < 0) linearMonths = month;
+		}
+		if (linearMonths <= maxDeliveryMonths + 1) continue;
+		// Once the delivery calendar has run through, what is left after needs is a line minus rounding. It's more than
+		// that line minus one ware, so the month is covered while the line stays at minus one or above
+		unsigned int month = maxDeliveryMonths;
+		int64_t arrivedUntilNow = _productionRemainder[wareIndex];
+		for (unsigned int delivery = 0; delivery < maxDeliveryMonths; delivery++) {
+			arrivedUntilNow += _deliveries[delivery][wareIndex] + rates.production[delivery][wareIndex] * (month - delivery);
+		}
+		double line = static_cast<double>(stock[wareIndex]) + static_cast<double>(arrivedUntilNow) / forecastProductionScale -
+			static_cast<double>(_needsRemainder[wareIndex] + (month + 1) * rates.needs[wareIndex]) / forecastNeedsScale;
+		double slope = static_cast<double>(rates.totalProduction[wareIndex]) / forecastProductionScale -
+			static_cast<double>(rates.needs[wareIndex]) / forecastNeedsScale;
+		const double margin = 1e-3; // for rounding of doubles
+		double coveredMonths = line + 1.0 - margin < 0 ? 0.0 : slope >= 0 ? static_cast<double>(noForecast) : (line + 1.0 - margin) / -slope;
+		linearMonths = std::min(linearMonths, static_cast<unsigned int>(std::min(maxDeliveryMonths + 1 + std::floor(coveredMonths), static_cast<double>(noForecast))));
+	}
+	return linearMonths;
+}
+
+int64_t EconomyForecast::_linearStock(const int64_t (&stock)[economyWaresCount], const LinearRates& rates, size_t wareIndex, unsigned int months) const {
+	int64_t arriving = _productionRemainder[wareIndex];
+	for (unsigned int month = 0; month < maxDeliveryMonths; month++) {
+		if (month < months) {
+			arriving += _deliveries[month][wareIndex];
+			// Output of a month with this delivery time arrives in every month from then on
+			arriving += rates.production[month][wareIndex] * (months - month);
+		}
+	}
+	int64_t taken = (_needsRemainder[wareIndex] + months * rates.needs[wareIndex]) / forecastNeedsScale;
+	return stock[wareIndex] + arriving / forecastProductionScale - taken;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "economy.h"
+
+namespace Archipelago {
+
+	const unsigned int noForecast{ ~0u }; /// months until something that doesn't happen within the forecast horizon
+	const unsigned int forecastHorizonDefault{ 240 }; /// months, 20 game years
+
+	/** Model of one settlement's economy for looking ahead without running the simulation.
+	* Captured by Economy::captureForecast() with building output summed by type and delivery time, so it is small,
+	* cheap to copy into simulation snapshots, and its cost doesn't grow with the number of buildings.
+	* While population stays the same and no need goes short, every month takes the same needs and yields
+	* the same output, and stockpiles follow in closed form from these net rates and the wares already on the way.
+	* When that doesn't hold, e.g. population grows or a ware runs out and buildings slow down, the model is
+	* stepped month by month with the economy's own consumption rules instead.
+	* Either way stockpiles come out exactly as the economy would tick them, as long as no buildings or routes change.
+	*/
+	class EconomyForecast {
+	public:
+		EconomyForecast();
+		/// Stockpile after given months. Stockpile holds one stack per ware type, WaresTypeId::_First first
+		void project(const std::vector<WaresStack>& stockpile, unsigned int months, std::vector<WaresStack>& out) const;
+		/// Months until stockpile holds required wares, 0 if it does now, noForecast if not within horizon
+		unsigned int monthsUntilAvailable(const std::vector<WaresStack>& stockpile, const std::vector<WaresStack>& required, unsigned int horizon = forecastHorizonDefault) const;
+		/// True if the given months can be projected in closed form, for tests and statistics
+		bool isClosedForm(const std::vector<WaresStack>& stockpile, unsigned int months) const;
+	private:
+		friend class Economy;
+		/// Net rates of a month in which nothing goes short
+		struct LinearRates {
+			int64_t needs[economyWaresCount]; // whole settlement, 1/(consumedWaresScale * fullBuildingEfficiency) of a ware
+			int64_t production[maxDeliveryMonths][economyWaresCount]; // by delivery time, millionths of a ware
+			int64_t totalProduction[economyWaresCount]; // millionths of a ware
+		};
+		/// Model state which changes month by month
+		struct State {
+			int64_t stock[economyWaresCount];
+			int64_t needsRemainder[economyWaresCount];
+			int64_t productionRemainder[economyWaresCount];
+			int64_t deliveries[maxDeliveryMonths][economyWaresCount]; // ring indexed by arrival month
+			unsigned int month;
+		};
+		void _initState(const std::vector<WaresStack>& stockpile, State& state) const;
+		/// Same as Economy::tick(), with output of building types instead of single buildings
+		void _step(State& state) const;
+		/// False if population would change or buildings lack workers, then rates change from month to month
+		bool _getLinearRates(const int64_t (&stock)[economyWaresCount], LinearRates& rates) const;
+		/// Months no need goes short within, so that closed form holds for them. noForecast if there is no end to it
+		unsigned int _getLinearMonths(const int64_t (&stock)[economyWaresCount], const LinearRates& rates) const;
+		/// Closed form stock of a ware after given months
+		int64_t _linearStock(const int64_t (&stock)[economyWaresCount], const LinearRates& rates, size_t wareIndex, unsigned int months) const;
+
+		int64_t _needs[economyNeedsRows][economyWaresCount];
+		int64_t _workers[economyNeedsRows];
+		int64_t _typeCounts[economyNeedsRows];
+		int64_t _typeProduction[economyNeedsRows][maxDeliveryMonths][economyWaresCount];
+		int64_t _needsRemainder[economyWaresCount];
+		int64_t _productionRemainder[economyWaresCount];
+		int64_t _deliveries[maxDeliveryMonths][economyWaresCount]; // next month's arrivals first
+	};
+
+} // namespace Archipelago
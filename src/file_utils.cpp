@@ -0,0 +1,74 @@
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "file_utils.h"
+
+namespace Archipelago {
+
+	const uint64_t fnvOffsetBasis{ 14695981039346656037ull };
+	const uint64_t fnvPrime{ 1099511628211ull };
+
+}
+
+using namespace Archipelago;
+
+bool FileUtils::readFile(const std::string& filename, std::vector<char>& data) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (file.fail()) {
+		return false;
+	}
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	data.resize(static_cast<size_t>(size));
+	if (size > 0 && !file.read(data.data(), size)) {
+		return false;
+	}
+	return true;
+}
+
+bool FileUtils::writeFileAtomically(const std::string& filename, const char* data, size_t size) {
+	std::string tmpFilename = filename + ".tmp";
+	{
+		std::ofstream file(tmpFilename, std::ios::binary | std::ios::trunc);
+		if (file.fail()) {
+			return false;
+		}
+		file.write(data, size);
+		file.flush();
+		if (file.fail()) {
+			return false;
+		}
+	}
+#ifdef _WIN32
+	return MoveFileExA(tmpFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(tmpFilename.c_str(), filename.c_str()) == 0;
+#endif
+}
+
+bool FileUtils::getModificationTime(const std::string& filename, int64_t& time) {
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(filename.c_str(), &info) != 0) {
+		return false;
+	}
+#else
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return false;
+	}
+#endif
+	time = static_cast<int64_t>(info.st_mtime);
+	return true;
+}
+
+uint64_t FileUtils::hashData(const char* data, size_t size) {
+	uint64_t hash = fnvOffsetBasis;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * fnvPrime;
+	}
+	return hash;
+}
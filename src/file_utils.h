@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Archipelago {
+
+	namespace FileUtils {
+		/// Reads whole file into memory. Returns false if file can't be opened.
+		bool readFile(const std::string& filename, std::vector<char>& data);
+		/** Writes data to 'filename.tmp' and then replaces 'filename' with it,
+		* so readers never observe a partially written file.
+		*/
+		bool writeFileAtomically(const std::string& filename, const char* data, size_t size);
+		/// Last modification time of file in seconds since epoch. Returns false if file doesn't exist.
+		bool getModificationTime(const std::string& filename, int64_t& time);
+		/// 64-bit FNV-1a of data, for telling whether a file changed
+		uint64_t hashData(const char* data, size_t size);
+	}
+
+} // namespace Archipelago
@@ -0,0 +1,48 @@
+#include "file_watcher.h"
+#include "file_utils.h"
+
+using namespace Archipelago;
+
+void FileWatcher::watch(const std::string& fileName, std::function<void(const std::string& fileName)> onChange) {
+	WatchedFile file{ fileName, std::move(onChange), 0, false };
+	FileUtils::getModificationTime(fileName, file.modificationTime);
+	_files.push_back(std::move(file));
+}
+
+void FileWatcher::start() {
+	if (isRunning()) return;
+	_stopRequested = false;
+	_thread = std::thread(&FileWatcher::_threadLoop, this);
+}
+
+void FileWatcher::stop() {
+	if (!isRunning()) return;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopRequested = true;
+	}
+	_wakeUp.notify_one();
+	_thread.join();
+}
+
+void FileWatcher::_threadLoop() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_wakeUp.wait_for(lock, _interval, [this] { return _stopRequested; })) {
+		lock.unlock();
+		for (WatchedFile& file : _files) {
+			int64_t modificationTime = 0;
+			FileUtils::getModificationTime(file.fileName, modificationTime);
+			if (modificationTime != file.modificationTime) {
+				file.modificationTime = modificationTime;
+				file.isChanging = true;
+			}
+			else if (file.isChanging) {
+				file.isChanging = false;
+				if (modificationTime != 0) { // deleted files are reported when they come back
+					file.onChange(file.fileName);
+				}
+			}
+		}
+		lock.lock();
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Archipelago {
+
+	const std::chrono::milliseconds fileWatchInterval{ 500 }; /// realtime between two looks at watched files
+
+	/** Watches files for changes by polling their modification time on its own thread.
+	* Polling instead of OS change notifications works the same everywhere and a few stat() calls
+	* twice a second cost nothing. A change is reported only once modification time stays the same
+	* for one whole interval, so a file which is still being written by an editor isn't read half done.
+	* Callbacks run on the watcher thread, one after another.
+	*/
+	class FileWatcher {
+	public:
+		explicit FileWatcher(std::chrono::milliseconds interval = fileWatchInterval) : _interval(interval), _stopRequested(false) {};
+		FileWatcher(const FileWatcher&) = delete;
+		~FileWatcher() { stop(); };
+		/// Before start() only. Files which don't exist yet are reported once they appear
+		void watch(const std::string& fileName, std::function<void(const std::string& fileName)> onChange);
+		void start();
+		void stop();
+		bool isRunning() const { return _thread.joinable(); };
+	private:
+		struct WatchedFile {
+			std::string fileName;
+			std::function<void(const std::string&)> onChange;
+			int64_t modificationTime; // last seen, 0 if file didn't exist
+			bool isChanging; // modification time moved on last poll, reported on the next one if it stays
+		};
+
+		void _threadLoop();
+
+		std::chrono::milliseconds _interval;
+		std::vector<WatchedFile> _files;
+		std::thread _thread;
+		std::mutex _mutex;
+		std::condition_variable _wakeUp;
+		bool _stopRequested; // guarded by _mutex
+	};
+
+} // namespace Archipelago
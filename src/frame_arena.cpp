@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <cstdint>
+#include "frame_arena.h"
+
+using namespace Archipelago;
+
+FrameArena::FrameArena(size_t capacity) :
+	_buffer(new char[capacity]),
+	_capacity(capacity),
+	_offset(0),
+	_highWaterMark(0),
+	_overflowCount(0) {
+}
+
+FrameArena::~FrameArena() {
+	reset();
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+	uintptr_t base = reinterpret_cast<uintptr_t>(_buffer.get());
+	uintptr_t aligned = (base + _offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+	size_t newOffset = static_cast<size_t>(aligned - base) + size;
+	if (newOffset <= _capacity) {
+		_offset = newOffset;
+		_highWaterMark = std::max(_highWaterMark, _offset);
+		return reinterpret_cast<void*>(aligned);
+	}
+	++_overflowCount;
+	void* block = ::operator new(size);
+	_overflowBlocks.push_back(block);
+	return block;
+}
+
+void FrameArena::reset() {
+	for (void* block : _overflowBlocks) {
+		::operator delete(block);
+	}
+	_overflowBlocks.clear();
+	_offset = 0;
+}
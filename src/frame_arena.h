@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Archipelago {
+
+	/** Bump allocator for data living no longer than one frame.
+	* Allocation is a pointer increment, deallocation is a no-op, and the whole arena is reset
+	* at the end of every iteration of the game loop. If a frame needs more than the arena capacity,
+	* the excess is served from the heap and counted as overflow, so capacity can be tuned.
+	*/
+	class FrameArena {
+	public:
+		explicit FrameArena(size_t capacity);
+		FrameArena(const FrameArena&) = delete;
+		~FrameArena();
+		void* allocate(size_t size, size_t alignment);
+		void reset();
+		size_t getCapacity() const { return _capacity; };
+		size_t getHighWaterMark() const { return _highWaterMark; };
+		size_t getOverflowCount() const { return _overflowCount; };
+	private:
+		std::unique_ptr<char[]> _buffer;
+		size_t _capacity;
+		size_t _offset;
+		size_t _highWaterMark;
+		size_t _overflowCount;
+		std::vector<void*> _overflowBlocks;
+	};
+
+	/// STL allocator drawing from FrameArena
+	template<typename T>
+	class FrameAllocator {
+	public:
+		typedef T value_type;
+		explicit FrameAllocator(FrameArena& arena) : _arena(&arena) {};
+		template<typename U>
+		FrameAllocator(const FrameAllocator<U>& other) : _arena(other.getArena()) {};
+		T* allocate(size_t n) { return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T))); };
+		void deallocate(T*, size_t) {};
+		FrameArena* getArena() const { return _arena; };
+	private:
+		FrameArena* _arena;
+	};
+
+	template<typename T, typename U>
+	bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.getArena() == b.getArena(); }
+	template<typename T, typename U>
+	bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.getArena() != b.getArena(); }
+
+	template<typename T>
+	using FrameVector = std::vector<T, FrameAllocator<T>>;
+	typedef std::basic_string<char, std::char_traits<char>, FrameAllocator<char>> FrameString;
+
+} // namespace Archipelago
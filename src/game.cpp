@@ -1,25 +1,57 @@
+#include <algorithm>
 #include <fstream>
 #include <thread>
 #include <SFML/Window.hpp>
 #include <cmath>
+#include <cstdio>
 #include <json.hpp>
 #include "game.h"
 #include "asset_registry.h"
 #include "map_system.h"
-#include "building_component.h"
+#include "settlement_builder.h"
 #include "ui_terrain_info_window.h"
+#include "profiler.h"
 
 namespace Archipelago {
 
 	// General game constants
 	const std::string& gameName{ "Archipelago" };
 	extern const std::string& loggerName{ gameName + "_logger" };
-	const std::string& mapFileName{ "assets/maps/default_map.json" };
+	const std::string& defaultMapFileName{ "assets/maps/default_map.json" };
 	const size_t stringReservationSize{ 100 };
 	// Time constants
 	const unsigned int gameMonthDurationNormal{ 30 };
 	const unsigned int gameMonthDurationFast{ 10 };
 	const unsigned int gameMonthDurationSuperFast{ 1 };
+	// Autosave constants
+	const unsigned int autosaveIntervalDefault{ 12 }; /// months between autosaves
+	const std::string& autosaveFileNameDefault{ "autosave.sav" };
+	const sf::Int64 autosaveCaptureWarningThreshold{ 2000 }; /// simulation thread time in microseconds, autosave captures taking longer are logged as warnings
+	// Profiler constants
+	const float countersLogIntervalDefault{ 10 }; /// seconds
+	// Map streaming constants
+	const unsigned int mapResidentChunkBudgetDefault{ 128 }; /// chunks of streamed map kept in memory
+	// Allocation tracking constants
+	const size_t frameArenaCapacity{ 256 * 1024 }; /// bytes
+	const uint64_t allocationWarmupFrames{ 300 }; /// frames before game loop is considered to be in steady state
+	const float allocationReportInterval{ 10 }; /// seconds between steady state allocation warnings
+#ifdef NDEBUG
+	const bool flagSteadyStateAllocationsDefault{ false };
+#else
+	const bool flagSteadyStateAllocationsDefault{ true };
+#endif
+	// Development constants
+#ifdef NDEBUG
+	const bool hotReloadEnabledDefault{ false };
+#else
+	const bool hotReloadEnabledDefault{ true };
+#endif
+	// AI constants
+	const unsigned int aiSettlementsDefault{ 0 };
+	const uint32_t aiSeedDefault{ 1 };
+	const std::string& profilerFontFileName{ "assets/fonts/tahoma.ttf" };
+	const std::string& profileCSVFileName{ "profile.csv" };
+	const std::string& profileTraceFileName{ "profile_trace.json" };
 	// Camera keyboard control constants
 	const int cameraMoveInterval{ 1 }; /// minimal interval between move steps in milliseconds
 	const float cameraMoveStep{ 15 }; /// move step in pixels
@@ -30,15 +62,105 @@ using namespace Archipelago;
 using namespace spdlog;
 using namespace ECS;
 
-Game::Game(): _isFullscreen(true), _windowWidth(800), _windowHeight(600), _curCameraZoom(1.0f) {}
+Game::Game(): _world(nullptr), _mapFileName(defaultMapFileName), _mapResidentChunkBudget(mapResidentChunkBudgetDefault), _textureBudget(textureBudgetDefault), _isFullscreen(true),
+	_autosaveEnabled(true), _autosaveInterval(autosaveIntervalDefault), _countersLogInterval(countersLogIntervalDefault), _flagSteadyStateAllocations(flagSteadyStateAllocationsDefault),
+	_hotReloadEnabled(hotReloadEnabledDefault), _aiSettlementCount(aiSettlementsDefault), _aiSeed(aiSeedDefault), _autosaveFileName(autosaveFileNameDefault), _windowWidth(800), _windowHeight(600), _frameArena(frameArenaCapacity), _curCameraZoom(1.0f) {}
 Game::~Game() {}
 
 void Game::init() {
+	_loadConfig();
+	if (_autosaveEnabled) {
+		_autosaveScheduler = std::make_unique<Archipelago::AutosaveScheduler>(_autosaveFileName, _autosaveInterval);
+		_logger->trace("Autosave every {} months to '{}'", _autosaveInterval, _autosaveFileName);
+	}
+
+	// Init game variables
+	_statusString.reserve(stringReservationSize);
+	_cameraMoveIntervalCooldown = cameraMoveInterval;
+	_mouseState = MouseState::Normal;
+
+	// Init game subsystems
+	_initRenderSystem();
+	_initWorld();
+	_setMouseCursorNormal();
+	_emit<MoveCameraToMapCenterEvent>({ true });
+
+	// Build menu and stock panel show every building and ware icon, load them in one parallel batch
+	std::vector<TextureHandle> uiIcons;
+	for (BuildingTypeId buildingType : buildingTypeIds) {
+		uiIcons.push_back(_assetRegistry->getBuildingSpecification(buildingType).icon);
+	}
+	for (WaresTypeId waresType : waresTypeIds) {
+		uiIcons.push_back(_assetRegistry->getWaresSpecification(waresType).icon);
+	}
+	_assetRegistry->loadTextures(uiIcons);
+	_ui = std::make_unique<Archipelago::Ui>(this);
+	_ui->updateSettlementWares();
+	_ui->updateGameTimeString();
+
+	_profilerOverlay = std::make_unique<Archipelago::ProfilerOverlay>();
+	if (!_profilerOverlay->loadFont(profilerFontFileName)) {
+		_logger->error("Error loading profiler overlay font '{}'", profilerFontFileName);
+	}
+
+	if (_hotReloadEnabled) {
+		_hotReload = std::make_unique<Archipelago::HotReload>();
+		_hotReload->start(_mapFileName);
+	}
+	addAiSettlements(_aiSettlementCount, _aiSeed); // interactive game only, replays don't record AI steps
+}
+
+void Game::initReplay(const std::string& recordingFileName) {
+	_loadConfig();
+	_recording = std::make_unique<Archipelago::CommandRecording>();
+	if (!loadCommandRecording(recordingFileName, *_recording)) {
+		_logger->error("Game::initReplay failed. Can't read command recording '{}'", recordingFileName);
+		exit(-1);
+	}
+	_logger->info("Replaying {} commands from '{}' on map '{}'", _recording->commands.size(), recordingFileName, _recording->mapFileName);
+	initHeadless(_recording->mapFileName);
+}
+
+void Game::initHeadless(const std::string& mapFileName) {
+	if (!_logger) {
+		_loadConfig();
+	}
+	_mapFileName = mapFileName;
+	_mouseState = MouseState::Normal;
+	_initWorld(); // no render window, UI and autosave in headless mode
+	_emit<MoveCameraToMapCenterEvent>({ true });
+}
+
+bool Game::loadMap(const MapData& map) {
+	if (_buildingIndex.getCount() > 0) {
+		_logger->warn("[Game::loadMap] Can't replace map while buildings stand on it");
+		return false;
+	}
+	_emit<LoadMapDataEvent>({ map });
+	_buildingIndex.reset(map.mapWidth, map.mapHeight);
+	_emit<MoveCameraToMapCenterEvent>({ true });
+	if (!_simulation->isRunning()) { // grid can't be swapped under a running simulation
+		LogisticsGrid logisticsGrid;
+		buildLogisticsGrid(map, logisticsGrid);
+		_initReachFields(logisticsGrid, map.resourcesLayer);
+		_simulation->setLogisticsGrid(std::move(logisticsGrid));
+	}
+	return true;
+}
+
+void Game::_loadConfig() {
 	// Init logger
-	_logger = basic_logger_mt(loggerName, "archipelago.log");
+	_logger = get(loggerName); // may already exist when running benchmarks
+	if (!_logger) {
+		_logger = basic_logger_mt(loggerName, "archipelago.log");
+	}
 	_logger->set_level(level::trace);
 	_logger->info("** {} starting **", gameName);
 
+	// Determine some hardware facts
+	_numThreads = std::thread::hardware_concurrency();
+	_logger->info("Host has {} cores", _numThreads);
+
 	// Load, parse and apply configuration settings
 	std::fstream configFile;
 	std::string configString;
@@ -80,44 +202,135 @@ void Game::init() {
 		exit(-1);
 	}
 
-	// Determine some hardware facts
-	_numThreads = std::thread::hardware_concurrency();
-	_logger->info("Host has {} cores", _numThreads);
+	_autosaveEnabled = true;
+	_autosaveInterval = autosaveIntervalDefault;
+	_autosaveFileName = autosaveFileNameDefault;
+	try {
+		_autosaveEnabled = configJSON.at("autosave").at("enabled");
+		_autosaveInterval = configJSON.at("autosave").at("intervalMonths");
+		_autosaveFileName = configJSON.at("autosave").at("fileName").get<std::string>();
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No complete 'autosave' configuration object found, using defaults. Error: {}", e.what());
+	}
 
-	// Init game variables
-	_statusString.reserve(stringReservationSize);
-	_cameraMoveIntervalCooldown = cameraMoveInterval;
-	_mouseState = MouseState::Normal;
+	_countersLogInterval = countersLogIntervalDefault;
+	try {
+		_countersLogInterval = configJSON.at("profiling").at("countersLogInterval");
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No 'profiling'.'countersLogInterval' option found in configuration file, default is {} s. Error: {}", countersLogIntervalDefault, e.what());
+	}
+	_flagSteadyStateAllocations = flagSteadyStateAllocationsDefault;
+	try {
+		_flagSteadyStateAllocations = configJSON.at("profiling").at("flagSteadyStateAllocations");
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No 'profiling'.'flagSteadyStateAllocations' option found in configuration file, default is {}. Error: {}", flagSteadyStateAllocationsDefault, e.what());
+	}
+	if (_flagSteadyStateAllocations && !PerfCounters::isCountingAllocations()) {
+		_logger->warn("'profiling'.'flagSteadyStateAllocations' is ignored, this build doesn't count allocations (see ARCHIPELAGO_ALLOCATION_COUNTING)");
+		_flagSteadyStateAllocations = false;
+	}
 
-	// Init game subsystems
-	_initRenderSystem();
-	_assetRegistry = std::make_unique<Archipelago::AssetRegistry>();
+	_hotReloadEnabled = hotReloadEnabledDefault;
+	try {
+		_hotReloadEnabled = configJSON.at("development").at("hotReload");
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No 'development'.'hotReload' option found in configuration file, default is {}. Error: {}", hotReloadEnabledDefault, e.what());
+	}
+
+	_textureBudget = textureBudgetDefault;
+	try {
+		_textureBudget = configJSON.at("video").at("textureBudgetMB").get<size_t>() * 1024 * 1024;
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No 'video'.'textureBudgetMB' option found in configuration file, default is {} MB. Error: {}", textureBudgetDefault / (1024 * 1024), e.what());
+	}
+
+	_aiSettlementCount = aiSettlementsDefault;
+	_aiSeed = aiSeedDefault;
+	try {
+		_aiSettlementCount = configJSON.at("ai").at("settlements");
+		_aiSeed = configJSON.at("ai").at("seed");
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No 'ai'.'settlements' or 'ai'.'seed' option found in configuration file, default is {} settlements. Error: {}", aiSettlementsDefault, e.what());
+	}
+
+	_mapResidentChunkBudget = mapResidentChunkBudgetDefault;
+	try {
+		_mapResidentChunkBudget = configJSON.at("map").at("residentChunkBudget");
+	}
+	catch (const std::out_of_range& e) {
+		_logger->trace("No 'map'.'residentChunkBudget' option found in configuration file, default is {} chunks. Error: {}", mapResidentChunkBudgetDefault, e.what());
+	}
+}
+
+void Game::_initWorld() {
+	// Main thread takes part in all parallel work, so one worker less than cores
+	_jobSystem = std::make_unique<Archipelago::JobSystem>(std::max(_numThreads, 1u) - 1);
+	_logger->info("Job system started with {} worker threads", _jobSystem->getWorkerCount());
+	_assetRegistry = std::make_unique<Archipelago::AssetRegistry>(_jobSystem.get());
+	_assetRegistry->setTextureBudget(_textureBudget);
 	_assetRegistry->prepareWaresAtlas();
 	_assetRegistry->prepareNaturalResourcesAtlas();
 	_assetRegistry->prepareBuildingAtlas();
-	_assetRegistry->loadTexture("mouse_cursor_normal", "assets/textures/mouse_cursor_normal.png");
-	_assetRegistry->loadTexture("triangle_atention", "assets/textures/triangle_atention.png");
-	_assetRegistry->loadTexture("dark_deep_space", "assets/textures/dark_deep_space.png");
-	_setMouseCursorNormal();
+	_assetRegistry->registerTexture("triangle_atention", "assets/textures/triangle_atention.png");
+	_assetRegistry->loadTextures({
+		{ "mouse_cursor_normal", "assets/textures/mouse_cursor_normal.png" },
+		{ "dark_deep_space", "assets/textures/dark_deep_space.png" }
+	});
+	_backgroundTexture = _assetRegistry->getTexture("dark_deep_space");
+	if (_backgroundTexture) {
+		_backgroundSprite.setTexture(*_backgroundTexture, true);
+	}
 	_world = World::createWorld();
 	_world->registerSystem(new Archipelago::MapSystem(*this));
-	_world->emit<LoadMapEvent>({ mapFileName });
-	_world->emit<MoveCameraToMapCenterEvent>({ true });
-	_initSettlementGoods();
-
-	_ui = std::make_unique<Archipelago::Ui>(this);
-	_ui->updateSettlementWares();
+	_emit<LoadMapEvent>({ _mapFileName });
+	_initSettlements();
 
 	// Game time variables
 	_gameTime = 0;
 	_currentGameMonthDuration = gameMonthDurationNormal;
-	_ui->updateGameTimeString();
+	_monthProgress = 0;
+	_simulation = std::make_unique<Archipelago::Simulation>(_jobSystem.get(), _settlements.front().getWares(), _currentGameMonthDuration);
+	_simulation->setMonthCallback([this](unsigned int gameTime) { _autosave(gameTime); });
+	_initLogistics();
+}
+
+void Game::_initLogistics() {
+	LogisticsGrid logisticsGrid;
+	std::vector<uint32_t> resources;
+	if (loadLogisticsGrid(_mapFileName, logisticsGrid, &resources)) {
+		_buildingIndex.reset(logisticsGrid.width, logisticsGrid.height);
+		_initReachFields(logisticsGrid, resources);
+		_simulation->setLogisticsGrid(std::move(logisticsGrid));
+	}
+	else {
+		_logger->error("Game failed to read terrain of map '{}' for logistics, wares will reach storage instantly", _mapFileName);
+	}
 }
 
 void Game::shutdown() {
+	if (_aiJob) {
+		_jobSystem->wait(_aiJob); // planning reads the game, plan is dropped
+	}
+	_hotReload.reset(); // watcher thread parses into registry types, stop it first
+	_simulation->stop(); // month callback uses autosave scheduler
 	_ui.release(); // UI must be destroyed before world, because it need world to unsubscribe from its events
 	_world->destroyWorld();
 	_assetRegistry.release();
+	_autosaveScheduler.reset(); // waits for pending autosave to be written
+	if (_recording && !_recordingFileName.empty()) {
+		if (saveCommandRecording(*_recording, _recordingFileName)) {
+			_logger->info("Saved {} recorded commands to '{}'", _recording->commands.size(), _recordingFileName);
+		}
+		else {
+			_logger->error("Failed to save command recording to '{}'", _recordingFileName);
+		}
+	}
 	_logger->info("** Archipelago finishing **");
 	_logger->flush();
 }
@@ -126,49 +339,153 @@ void Game::run() {
 	sf::Event event;
 	sf::Time frameTime;
 
+	_simulation->start();
 	while (_window->isOpen()) {
-		// Events & input processing
-		while (_window->pollEvent(event)) {
-			_ui->handleEvent(event);
-			_processEvents(event);
-		}
-		_processInput(frameTime);
-		
-		// Turn over everything
-		_update(frameTime);
-		_draw();
+		{
+			ProfileZone frameZone(ProfileZoneId::Frame);
+			_finishAiBuilders(); // before input and update change what builders read
+			// Events & input processing
+			{
+				ProfileZone zone(ProfileZoneId::ProcessEvents);
+				while (_window->pollEvent(event)) {
+					_ui->handleEvent(event);
+					_processEvents(event);
+				}
+			}
+			{
+				ProfileZone zone(ProfileZoneId::ProcessInput);
+				_processInput(frameTime);
+			}
+
+			// Turn over everything
+			{
+				ProfileZone zone(ProfileZoneId::Update);
+				_update(frameTime);
+			}
+			_draw();
+		}
+		Profiler::instance().endFrame();
+		PerfCounters::instance().endFrame();
+		_checkSteadyStateAllocations(frameTime.asSeconds());
+		_frameArena.reset();
+		_assetRegistry->endFrame();
+		if (_hotReload) {
+			_applyHotReload();
+		}
 		frameTime = _clock.restart();
 	}
 }
 
-std::string Game::composeGameTimeString() {
-	std::string timeString;
+void Game::_applyHotReload() {
+	HotReloadBatch batch;
+	if (!_hotReload->takePending(batch)) return;
+	_finishAiBuilders(); // builders read specifications and map layers
+	// Simulation thread reads specifications every month, it must not see them half replaced
+	bool wasRunning = _simulation->isRunning();
+	_simulation->stop();
+	if (batch.wares) {
+		_assetRegistry->replaceSpecifications(*batch.wares, batch.waresIcons);
+	}
+	if (batch.natres) {
+		_assetRegistry->replaceSpecifications(*batch.natres, batch.natresIcons);
+	}
+	if (batch.buildings) {
+		_assetRegistry->replaceSpecifications(*batch.buildings, batch.buildingIcons);
+	}
+	if (batch.wares || batch.natres || batch.buildings) {
+		_simulation->refreshSpecifications();
+		_emit<SpecificationsReloadedEvent>({ true });
+	}
+	if (batch.isMapChanged && _buildingIndex.getCount() > 0) {
+		_logger->warn("Map '{}' changed, but it isn't reloaded while buildings stand on it, restart the game to use it", _mapFileName);
+	}
+	else if (batch.isMapChanged) {
+		if (batch.map) {
+			loadMap(*batch.map);
+		}
+		else {
+			// Chunked map is streamed from its file again, logistics terrain is read the same way as at start
+			_emit<LoadMapEvent>({ _mapFileName });
+			_initLogistics();
+		}
+		_logger->info("Map '{}' reloaded", _mapFileName);
+	}
+	if (wasRunning) {
+		_simulation->start();
+	}
+}
+
+void Game::runReplay() {
+	const std::vector<Command>& commands = _recording->commands;
+	sf::Clock replayClock;
+	size_t nextCommand = 0;
+	while (nextCommand < commands.size()) {
+		// Commands are stored in issue order, so all commands of current month are contiguous
+		while (nextCommand < commands.size() && commands[nextCommand].gameTime <= _gameTime) {
+			_executeCommand(commands[nextCommand]);
+			++nextCommand;
+		}
+		{
+			ProfileZone zone(ProfileZoneId::WorldTick);
+			_world->tick(0);
+		}
+		if (nextCommand < commands.size()) {
+			ProfileZone zone(ProfileZoneId::Update);
+			_advanceGameMonth();
+		}
+		Profiler::instance().endFrame();
+		PerfCounters::instance().endFrame();
+		_frameArena.reset();
+	}
+	sf::Time elapsed = replayClock.getElapsedTime();
+	_logger->info("Replay finished: {} commands, {} game months in {} ms ({:.1f} months/s)",
+		commands.size(), _gameTime, elapsed.asMilliseconds(), elapsed.asSeconds() > 0 ? _gameTime / elapsed.asSeconds() : 0.0f);
+	ProfileZoneStats updateStats = Profiler::instance().getZoneStats(ProfileZoneId::Update);
+	_logger->info("Replay month update time: p50 {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms", updateStats.p50, updateStats.p99, updateStats.max);
+	PerfCounters::instance().formatTotals(_countersLogString);
+	_logger->info("Replay counters: {}", _countersLogString);
+	_exportProfile();
+}
+
+void Game::startRecording(const std::string& recordingFileName) {
+	_recording = std::make_unique<Archipelago::CommandRecording>();
+	_recording->mapFileName = _mapFileName;
+	_recordingFileName = recordingFileName;
+	_logger->info("Recording player commands to '{}'", recordingFileName);
+}
+
+void Game::setView(const sf::View& view) {
+	if (_window) {
+		_window->setView(view);
+	}
+	else {
+		_headlessView = view;
+	}
+}
+
+FrameString Game::composeGameTimeString() {
 	unsigned int year = _gameTime / 12;
 	unsigned int month = _gameTime - (year * 12) + 1;
-	timeString = "Year ";
-	timeString += std::to_string(year);
-	timeString += ", Month ";
-	timeString += std::to_string(month);
+	const char* speed = "";
 	switch (_currentGameMonthDuration) {
 	case gameMonthDurationNormal:
-		timeString += " (going normal)";
+		speed = " (going normal)";
 		break;
 	case gameMonthDurationFast:
-		timeString += " (going fast)";
+		speed = " (going fast)";
 		break;
 	case gameMonthDurationSuperFast:
-		timeString += " (going superfast)";
+		speed = " (going superfast)";
 		break;
 	}
-	return timeString;
+	char timeString[64];
+	std::snprintf(timeString, sizeof(timeString), "Year %u, Month %u%s", year, month, speed);
+	return FrameString(timeString, FrameAllocator<char>(_frameArena));
 }
 
 void Game::onUISelectBuilding(BuildingTypeId buildingID) {
 	_logger->trace("Game::onUISelectBuilding called with id {}", std::underlying_type<WaresTypeId>::type(buildingID));
-	BuildingSpecification bs = _assetRegistry->getBuildingSpecification(buildingID);
-	_mouseState = MouseState::BuildingPlacement;
-	_selectedForBuilding = buildingID;
-	_mouseSprite.setTexture(*bs.icon, true);
+	_issueCommand(Command::selectBuilding(buildingID));
 }
 
 void Game::_initRenderSystem() {
@@ -190,13 +507,62 @@ void Game::_initRenderSystem() {
 	_isMovingCamera = false;
 }
 
-void Game::_initSettlementGoods() {
-	for (WaresTypeId gti = WaresTypeId::_First; gti <= WaresTypeId::_Last; gti = static_cast<WaresTypeId>(std::underlying_type<WaresTypeId>::type(gti) + 1)) {
-		WaresStack stack;
-		stack.type = gti;
-		stack.amount = 0;
-		_settlementWares.push_back(std::move(stack));
+void Game::_initSettlements() {
+	_settlements.clear();
+	_settlements.emplace_back(playerSettlementId);
+}
+
+SettlementId Game::addSettlement() {
+	SettlementId id = static_cast<SettlementId>(_settlements.size());
+	_settlements.emplace_back(id);
+	_pushSimulationCommand(SimulationCommand::addSettlement());
+	return id;
+}
+
+void Game::addAiSettlements(unsigned int count, uint32_t seed) {
+	for (unsigned int i = 0; i < count; i++) {
+		SettlementId id = addSettlement();
+		_aiBuilders.push_back(std::make_unique<SettlementBuilder>(_aiPlan, id, seed + id));
+	}
+	if (count > 0) {
+		_logger->info("Added {} AI settlements with seed {}", count, seed);
+	}
+}
+
+size_t Game::runAiBuilders() {
+	_aiPlan.begin(_settlements.size());
+	for (auto& builder : _aiBuilders) {
+		builder->run(aiStepsPerMonth);
+	}
+	return _placeAiPlan();
+}
+
+void Game::_scheduleAiBuilders() {
+	if (_aiBuilders.empty()) return;
+	_aiPlan.begin(_settlements.size());
+	// Without worker threads the plan is made when the next frame waits for it
+	_aiJob = _jobSystem->schedule([this]() {
+		for (auto& builder : _aiBuilders) {
+			builder->run(aiStepsPerMonth);
+		}
+	});
+}
+
+void Game::_finishAiBuilders() {
+	if (!_aiJob) return;
+	_jobSystem->wait(_aiJob);
+	_aiJob.reset();
+	_placeAiPlan();
+}
+
+size_t Game::_placeAiPlan() {
+	size_t placed = 0;
+	for (const PlannedBuilding& planned : _aiPlan.getPlacements()) {
+		if (_placeBuilding(planned.settlement, planned.type, planned.x, planned.y)) {
+			++placed;
+		}
 	}
+	return placed;
 }
 
 void Game::_processEvents(sf::Event event) {
@@ -212,31 +578,23 @@ void Game::_processEvents(sf::Event event) {
 		}
 		break;
 		case sf::Keyboard::Add: {
-			switch (_currentGameMonthDuration) {
-			case gameMonthDurationNormal:
-				_currentGameMonthDuration = gameMonthDurationFast;
-				break;
-			case gameMonthDurationFast:
-				_currentGameMonthDuration = gameMonthDurationSuperFast;
-				break;
-			}
-			_ui->updateGameTimeString();
+			_issueCommand(Command::changeSpeed(1));
 		}
 		break;
 		case sf::Keyboard::Subtract: {
-			switch (_currentGameMonthDuration) {
-			case gameMonthDurationSuperFast:
-				_currentGameMonthDuration = gameMonthDurationFast;
-				break;
-			case gameMonthDurationFast:
-				_currentGameMonthDuration = gameMonthDurationNormal;
-				break;
-			}
-			_ui->updateGameTimeString();
+			_issueCommand(Command::changeSpeed(-1));
 		}
 		break;
 		case sf::Keyboard::Space: {
-			_world->emit<ShowNaturalResourcesEvent>({ true });
+			_emit<ShowNaturalResourcesEvent>({ true });
+		}
+		break;
+		case sf::Keyboard::F3: {
+			_profilerOverlay->toggle();
+		}
+		break;
+		case sf::Keyboard::F4: {
+			_exportProfile();
 		}
 		break;
 		}
@@ -245,7 +603,7 @@ void Game::_processEvents(sf::Event event) {
 	case sf::Event::KeyReleased: {
 		switch (event.key.code) {
 		case sf::Keyboard::Space:
-			_world->emit<ShowNaturalResourcesEvent>({ false });
+			_emit<ShowNaturalResourcesEvent>({ false });
 		break;
 		}
 	}
@@ -257,11 +615,11 @@ void Game::_processEvents(sf::Event event) {
 	break;
 	case sf::Event::MouseWheelMoved: {
 		if (event.mouseWheel.delta < 0) {
-			_zoomCamera(1.5f);
+			_issueCommand(Command::zoomCamera(1.5f));
 		}
 		else
 		{
-			_zoomCamera(0.5f);
+			_issueCommand(Command::zoomCamera(0.5f));
 			
 		}
 	}
@@ -280,7 +638,7 @@ void Game::_processEvents(sf::Event event) {
 	case sf::Event::MouseButtonReleased: {
 		if (event.mouseButton.button == sf::Mouse::Left) {
 			if (_mouseState == MouseState::BuildingPlacement) {
-				_placeBuilding();
+				_placeSelectedBuildingUnderCursor();
 			};
 			if (_mouseState == MouseState::Normal) {
 				_showTerrainInfoWindow();
@@ -307,41 +665,46 @@ void Game::_processInput(const sf::Time& frameTime) {
 	}
 	if (canMoveCamera) {
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) {
-			_world->emit<MoveCameraEvent>({ -cameraMoveStep, 0.0f });
+			_issueCommand(Command::moveCamera(-cameraMoveStep, 0.0f));
 		}
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) {
-			_world->emit<MoveCameraEvent>({ cameraMoveStep, 0.0f });
+			_issueCommand(Command::moveCamera(cameraMoveStep, 0.0f));
 		}
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) {
-			_world->emit<MoveCameraEvent>({ 0.0f, -cameraMoveStep });
+			_issueCommand(Command::moveCamera(0.0f, -cameraMoveStep));
 		}
 		if (sf::Keyboard::isKeyPressed(sf::Keyboard::S)) {
-			_world->emit<MoveCameraEvent>({ 0.0f, cameraMoveStep });
+			_issueCommand(Command::moveCamera(0.0f, cameraMoveStep));
 		}
 		_processMouseMovement();
 	}
 }
 
 void Game::_update(const sf::Time& frameTime) {
-	// Update status string
-	_fps = static_cast<int>(1.0f / frameTime.asSeconds());
-	_statusString = " FPS: ";
-	_statusString += std::to_string(_fps);
-
-	// Update game time
-	_accumulatedTime += frameTime;
-	if (_accumulatedTime.asSeconds() >= _currentGameMonthDuration) {
-		_gameTime++;
-		_accumulatedTime = sf::Time::Zero;
-		_updateSettlement();
-		_ui->updateGameTimeString();
+	// Update status string, FPS is averaged over profiler history to be readable
+	float averageFrameTime = Profiler::instance().getAverageFrameTime();
+	_fps = averageFrameTime > 0 ? static_cast<int>(1000.0f / averageFrameTime) : 0;
+	char statusString[stringReservationSize];
+	std::snprintf(statusString, sizeof(statusString), " FPS: %u", _fps);
+	_statusString.assign(statusString); // fits reserved capacity, no allocation
+
+	// Game time runs on simulation thread, frame only picks up its latest state
+	_applySimulationSnapshot();
+	if (_gameTime != _aiGameTime) {
+		_aiGameTime = _gameTime;
+		_scheduleAiBuilders(); // planned while this frame renders, placed at the start of the next one
 	}
 
 	// Update world
-	_world->tick(0);
+	{
+		ProfileZone zone(ProfileZoneId::WorldTick);
+		_world->tick(0);
+	}
 
 	// Update UI
 	_ui->update(frameTime.asSeconds());
+	_profilerOverlay->update(frameTime.asSeconds());
+	_logPerfCounters(frameTime.asSeconds());
 }
 
 void Game::_draw() {
@@ -349,25 +712,39 @@ void Game::_draw() {
 	// Render background
 	_drawBackgroundImage();
 	// Render map
-	_world->emit<RenderMapEvent>({ true });
+	{
+		ProfileZone zone(ProfileZoneId::RenderMap);
+		_emit<RenderMapEvent>({ true });
+	}
 	// Render UI
-	_ui->render();
+	{
+		ProfileZone zone(ProfileZoneId::RenderUi);
+		_ui->render();
+		_profilerOverlay->render(*_window);
+	}
 	// Render mouse cursor
 	if (_mouseState == MouseState::BuildingPlacement) {
 		auto ent = _world->getById(_getEntityIDUnderCursor());
-		if (ent &&
-			_settlementHasWaresForBuilding(_assetRegistry->getBuildingSpecification(_selectedForBuilding)) &&
-			!_settlementExceededAllowedBuildingAmount(_assetRegistry->getBuildingSpecification(_selectedForBuilding)) &&
-			_requiredNatresPresentOnTile(ent, _selectedForBuilding) &&
-			ent->get<BuildingComponent>() == ComponentHandle<BuildingComponent>(nullptr)) {
+		auto tile = ent ? ent->get<TileComponent>() : ComponentHandle<TileComponent>(nullptr);
+		const Settlement& player = _settlements.front();
+		const BuildingSpecification& selected = _assetRegistry->getBuildingSpecification(player.getSelectedForBuilding());
+		if (tile &&
+			player.hasWaresForBuilding(selected) &&
+			!player.exceededAllowedBuildingAmount(selected) &&
+			isBuildingSite(selected, tile->x, tile->y)) {
 			_mouseSprite.setColor(sf::Color(255, 255, 255, 127));
 		}
 		else {
 			_mouseSprite.setColor(sf::Color(255, 0, 0, 127));
 		}
 	}
+	if (_mouseState == MouseState::BuildingPlacement) {
+		_assetRegistry->useTexture(_assetRegistry->getBuildingSpecification(_settlements.front().getSelectedForBuilding()).icon); // keeps cursor icon resident
+	}
 	_window->draw(_mouseSprite);
+	PerfCounters::instance().countDraw(_mouseSprite.getTexture(), 4);
 	// Show everything on screen
+	ProfileZone zone(ProfileZoneId::Display);
 	_window->display();
 }
 
@@ -375,20 +752,20 @@ void Game::_drawBackgroundImage() {
 	constexpr float PARALLAX_MULTIPLIER{ 50.f };
 	constexpr float BKG_PARALLAX_COMPENSATION_SCALE{ 1.1f };
 
-	sf::Texture* bkgTex{ _assetRegistry->getTexture("dark_deep_space") };
-	sf::Sprite bkgSpr{ *bkgTex };
-	sf::View v = getRenderWindow().getView();
+	if (!_backgroundTexture) return;
+	const sf::View& v = getRenderWindow().getView();
 
 	sf::Vector2f viewCenter{ v.getCenter() };
 	sf::Vector2f viewSize{ v.getSize() };
-	sf::Vector2f texSize{ bkgTex->getSize() };
+	sf::Vector2f texSize{ _backgroundTexture->getSize() };
 	sf::Vector2f sprBaseScale{ viewSize.x / texSize.x, viewSize.y / texSize.y };
 	sf::Vector2f parallaxOffset{ viewCenter / PARALLAX_MULTIPLIER };
 
-	bkgSpr.setScale(sprBaseScale * BKG_PARALLAX_COMPENSATION_SCALE);
-	bkgSpr.setOrigin(texSize / 2.0f); // Set origin to center of texture
-	bkgSpr.setPosition(viewCenter - parallaxOffset);
-	getRenderWindow().draw(bkgSpr);
+	_backgroundSprite.setScale(sprBaseScale * BKG_PARALLAX_COMPENSATION_SCALE);
+	_backgroundSprite.setOrigin(texSize / 2.0f); // Set origin to center of texture
+	_backgroundSprite.setPosition(viewCenter - parallaxOffset);
+	getRenderWindow().draw(_backgroundSprite);
+	PerfCounters::instance().countDraw(_backgroundTexture, 4);
 }
 
 void Game::_setMouseCursorNormal() {
@@ -411,13 +788,14 @@ void Game::_processMouseMovement() {
 			(int)(sf::Mouse::getPosition(*_window).y + cursorOffsetY)
 		)
 	));
-	_world->emit<MouseMovedEvent>({ true });
+	_emit<MouseMovedEvent>({ true });
 	if (_isMovingCamera) {
-		_world->emit<MoveCameraEvent>({
-			static_cast<float>((_prevMouseCoords - sf::Mouse::getPosition(*_window)).x),
-			static_cast<float>((_prevMouseCoords - sf::Mouse::getPosition(*_window)).y)
-		});
-		_prevMouseCoords = sf::Mouse::getPosition(*_window);
+		sf::Vector2i mouseCoords = sf::Mouse::getPosition(*_window);
+		sf::Vector2i offset = _prevMouseCoords - mouseCoords;
+		if (offset.x != 0 || offset.y != 0) { // a held still mouse would record a no-op command every frame
+			_issueCommand(Command::moveCamera(static_cast<float>(offset.x), static_cast<float>(offset.y)));
+			_prevMouseCoords = mouseCoords;
+		}
 	}
 }
 
@@ -425,128 +803,204 @@ void Game::_zoomCamera(float zoomFactor) {
 	if (_curCameraZoom * zoomFactor > maxCameraZoom || _curCameraZoom * zoomFactor < minCameraZoom) {
 		return;
 	}
-	sf::View v = _window->getView();
+	sf::View v = getView();
 	v.zoom(zoomFactor);
-	_window->setView(v);
+	setView(v);
 	_curCameraZoom *= zoomFactor;
 	_mouseSprite.scale(sf::Vector2f(zoomFactor, zoomFactor));
 }
 
-void Game::_updateSettlement() {
-	_world->each<BuildingComponent>([&](Entity* ent, ComponentHandle<BuildingComponent> bc) {
-		const BuildingSpecification& bs{ *bc->spec };
-		for (WaresStack waresStack : bs.waresProduced) {
-			WaresTypeId type{ waresStack.type };
-			int amount{ waresStack.amount };
-			for (auto& settWare : _settlementWares) {
-				if (settWare.type == type) {
-					settWare.amount += amount;
-				}
+void Game::_advanceGameMonth() {
+	_simulation->advanceMonth();
+	_applySimulationSnapshot();
+}
+
+void Game::_applySimulationSnapshot() {
+	const SimulationSnapshot& snapshot = _simulation->getSnapshot();
+	// Until simulation has applied all our commands, the mirror is more recent than the snapshot
+	if (snapshot.commandsApplied != _simulationCommandsIssued) return;
+	_monthProgress = snapshot.monthProgress;
+	if (snapshot.gameTime != _gameTime || snapshot.gameMonthDuration != _currentGameMonthDuration) {
+		_gameTime = snapshot.gameTime;
+		_currentGameMonthDuration = snapshot.gameMonthDuration;
+		if (_ui) {
+			_ui->updateGameTimeString();
+		}
+	}
+	if (snapshot.forecastVersion != _forecastVersion) {
+		_forecast = snapshot.forecast;
+		_forecastVersion = snapshot.forecastVersion;
+	}
+	bool waresChanged = false;
+	for (size_t settlement = 0; settlement < _settlements.size() && settlement < snapshot.settlementWares.size(); settlement++) {
+		const std::vector<WaresStack>& wares = snapshot.settlementWares[settlement];
+		for (size_t i = 0; i < wares.size(); i++) {
+			if (_settlements[settlement].syncWare(i, wares[i].amount) && settlement == playerSettlementId) {
+				waresChanged = true;
 			}
 		}
+	}
+	if (waresChanged && _ui) {
 		_ui->updateSettlementWares();
-	});
+	}
 }
 
-bool Game::_settlementHasWaresForBuilding(const BuildingSpecification& bs) {
-	for (auto& settWare : _settlementWares) {
-		for (auto& requiredWare : bs.waresRequired) {
-			if (settWare.type == requiredWare.type) {
-				if (settWare.amount < requiredWare.amount) return false;
-			}
-		}
+void Game::_pushSimulationCommand(const SimulationCommand& command) {
+	_simulation->push(command);
+	++_simulationCommandsIssued;
+}
+
+void Game::_issueCommand(Command command) {
+	command.gameTime = _gameTime;
+	command.monthProgress = _monthProgress;
+	if (_recording) {
+		_recording->commands.push_back(command);
 	}
-	return true;
+	_executeCommand(command);
 }
 
-bool Game::settlementHasWareForBuilding(const BuildingSpecification& bs, WaresTypeId ware) {
-	int amountNeeded{ 0 };
-	for (auto& requiredWare : bs.waresRequired) {
-		if (requiredWare.type == ware) {
-			amountNeeded = requiredWare.amount;
+void Game::_executeCommand(const Command& command) {
+	switch (command.type) {
+	case CommandType::SelectBuilding: {
+		_mouseState = MouseState::BuildingPlacement;
+		_settlements.front().setSelectedForBuilding(command.building);
+		if (!isHeadless()) {
+			_mouseSprite.setTexture(*_assetRegistry->getTexture(_assetRegistry->getBuildingSpecification(command.building).icon), true);
+		}
+	}
+	break;
+	case CommandType::PlaceBuilding: {
+		if (_placeBuilding(playerSettlementId, command.building, command.tileX, command.tileY) && !isHeadless()) {
+			_setMouseCursorNormal();
 		}
 	}
-	for (auto& settWare : _settlementWares) {
-		if (settWare.type == ware && settWare.amount >= amountNeeded)
-			return true;
+	break;
+	case CommandType::ChangeSpeed: {
+		_changeGameSpeed(command.speedStep);
+	}
+	break;
+	case CommandType::MoveCamera: {
+		_emit<MoveCameraEvent>({ command.offsetX, command.offsetY });
+	}
+	break;
+	case CommandType::ZoomCamera: {
+		_zoomCamera(command.zoomFactor);
+	}
+	break;
 	}
-	return false;
 }
 
-bool Game::_settlementExceededAllowedBuildingAmount(const BuildingSpecification& bs) {
-	if (bs.maxAllowedOnMap == 0) {
-		return false;
+void Game::_changeGameSpeed(int speedStep) {
+	if (speedStep > 0) {
+		switch (_currentGameMonthDuration) {
+		case gameMonthDurationNormal:
+			_currentGameMonthDuration = gameMonthDurationFast;
+			break;
+		case gameMonthDurationFast:
+			_currentGameMonthDuration = gameMonthDurationSuperFast;
+			break;
+		}
 	}
-	unsigned int buildingsCount{ 0 };
-	_world->each<BuildingComponent>([&](Entity* ent, ComponentHandle<BuildingComponent> bc) {
-		const BuildingSpecification& this_bs{ *bc->spec };
-		if (this_bs.id == bs.id) {
-			++buildingsCount;
+	else {
+		switch (_currentGameMonthDuration) {
+		case gameMonthDurationSuperFast:
+			_currentGameMonthDuration = gameMonthDurationFast;
+			break;
+		case gameMonthDurationFast:
+			_currentGameMonthDuration = gameMonthDurationNormal;
+			break;
 		}
-	});
-	if (buildingsCount >= bs.maxAllowedOnMap) {
-		return true;
 	}
-	return false;
+	_pushSimulationCommand(SimulationCommand::setMonthDuration(_currentGameMonthDuration));
+	if (_ui) {
+		_ui->updateGameTimeString();
+	}
 }
 
-bool Game::_requiredNatresPresentOnTile(ECS::Entity* ent, BuildingTypeId buildingID) {
-	auto natres = ent->get<NaturalResourceComponent>();
-	uint32_t resourseSet = 0;
-	if (natres) {
-		resourseSet = natres->resourceSet;
+bool Game::_requiredNatresInReach(uint32_t resourceSet, unsigned int tileX, unsigned int tileY, const BuildingSpecification& bs) const {
+	if (resourceSet == 0) return false;
+	if (bs.natresRequired == NaturalResourceTypeId::Unknown) return true;
+	const DistanceField& field = _natresFields[static_cast<size_t>(bs.natresRequired)];
+	if (bs.natresRadius == 0 || field.isEmpty() || tileX >= _reachGrid.width || tileY >= _reachGrid.height) {
+		return NaturalResourceTypeId(resourceSet & 0x000000FF) == bs.natresRequired;
 	}
-	if (resourseSet == 0) return false;
-	NaturalResourceTypeId natresRequired = _assetRegistry->getBuildingSpecification(buildingID).natresRequired;
-	if (natresRequired == NaturalResourceTypeId::Unknown) return true;
-	if (NaturalResourceTypeId(resourseSet & 0x000000FF) != natresRequired) return false;
-	return true;
+	return field.getDistance(tileY * _reachGrid.width + tileX) <= bs.natresRadius;
 }
 
-void Game::_placeBuilding() {
-	if (_mouseState != MouseState::BuildingPlacement) return;
-	const BuildingSpecification& bs = _assetRegistry->getBuildingSpecification(_selectedForBuilding);
-	if (!_settlementHasWaresForBuilding(bs) || _settlementExceededAllowedBuildingAmount(bs)) return;
-	if (_getEntityIDUnderCursor() == 0) return;
-	auto ent = _world->getById(_getEntityIDUnderCursor());
-	if (!ent) return;
-	if (!_requiredNatresPresentOnTile(ent, _selectedForBuilding)) return;
-	ComponentHandle<TileComponent> tile = ent->get<TileComponent>();
-	if (tile == ComponentHandle<TileComponent>(nullptr)) {
-		_logger->warn("[Game::_placeBuilding] Tile component not found on world entity!");
-		return;
-	}
-	ComponentHandle<BuildingComponent> building = ent->get<BuildingComponent>();
-	if (building == ComponentHandle<BuildingComponent>(nullptr)) {
-		ent->assign<BuildingComponent>(&bs);
-		building = ent->get<BuildingComponent>();
+bool Game::isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const {
+	if (tileX >= _reachGrid.width || tileY >= _reachGrid.height) return false;
+	if (!_requiredNatresInReach(getTileResources(tileX, tileY), tileX, tileY, bs)) return false;
+	return _buildingIndex.find(tileX, tileY) == nullptr;
+}
+
+uint32_t Game::getTileResources(unsigned int tileX, unsigned int tileY) const {
+	if (_natresLayer.empty() || tileX >= _reachGrid.width || tileY >= _reachGrid.height) return 0;
+	return _natresLayer[tileY * _reachGrid.width + tileX];
+}
+
+void Game::_initReachFields(const LogisticsGrid& grid, const std::vector<uint32_t>& resources) {
+	_reachGrid = grid;
+	if (resources.size() == grid.cost.size()) {
+		_natresLayer = resources;
 	}
-	else { // Tile is occupied with another building
-		return;
+	else {
+		_natresLayer.clear();
 	}
-	building->sprite.setTexture(*(bs.icon), true);
-	sf::Vector2f pos = tile->sprite.getPosition();
-	pos.y += (float)tile->rising - (float)bs.tileRising;
-	building->sprite.setPosition(pos);
-	for (auto& settWare : _settlementWares) {
-		for (auto& requiredWare : bs.waresRequired) {
-			if (settWare.type == requiredWare.type) {
-				settWare.amount -= requiredWare.amount;
-			}
+	// Natural resources never change, fields are made once and only for resources some building looks for around itself
+	for (NaturalResourceTypeId natresId : naturalResourceTypeIds) {
+		size_t type = static_cast<size_t>(natresId);
+		unsigned int radius = 0;
+		for (BuildingTypeId bldId : buildingTypeIds) {
+			const BuildingSpecification& bs = _assetRegistry->getBuildingSpecification(bldId);
+			if (static_cast<size_t>(bs.natresRequired) == type) radius = std::max(radius, bs.natresRadius);
 		}
-		for (auto& providedInstantWare : bs.providedInstantWares) {
-			if (settWare.type == providedInstantWare.type) {
-				settWare.amount += providedInstantWare.amount;
+		_natresFields[type] = DistanceField(radius);
+		if (radius == 0 || resources.size() != grid.cost.size()) continue;
+		std::vector<uint32_t> sources;
+		for (uint32_t tile = 0; tile < resources.size(); tile++) {
+			for (uint32_t resourceSet = resources[tile]; resourceSet; resourceSet >>= 8) {
+				if ((resourceSet & 0xFF) == type) {
+					sources.push_back(tile);
+					break;
+				}
 			}
 		}
+		_natresFields[type].build(grid, sources);
 	}
-	_ui->updateSettlementWares();
-	_setMouseCursorNormal();
+}
+
+bool Game::_placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) {
+	if (settlementId >= _settlements.size()) return false;
+	Settlement& settlement = _settlements[settlementId];
+	const BuildingSpecification& bs = _assetRegistry->getBuildingSpecification(buildingID);
+	if (!settlement.hasWaresForBuilding(bs) || settlement.exceededAllowedBuildingAmount(bs)) return false;
+	// Rules are checked on map layers and the index only, so the tile's chunk doesn't have to be resident
+	if (!isBuildingSite(bs, tileX, tileY)) return false;
+	_buildingIndex.insert({ tileX, tileY, buildingID, settlementId });
+	_emit<BuildingPlacedEvent>({ tileX, tileY });
+	_pushSimulationCommand(SimulationCommand::addBuilding(settlementId, &bs, tileX, tileY));
+	settlement.addBuilding(bs, [this, settlementId](WaresTypeId ware, int amount) {
+		_pushSimulationCommand(SimulationCommand::changeWare(settlementId, ware, amount));
+	});
+	if (_ui && settlementId == playerSettlementId) {
+		_ui->updateSettlementWares();
+	}
+	return true;
+}
+
+void Game::_placeSelectedBuildingUnderCursor() {
+	if (_mouseState != MouseState::BuildingPlacement) return;
+	size_t entityID = _getEntityIDUnderCursor();
+	if (entityID == 0) return;
+	auto ent = _world->getById(entityID);
+	if (!ent || !ent->has<TileComponent>()) return;
+	ComponentHandle<TileComponent> tile = ent->get<TileComponent>();
+	_issueCommand(Command::placeBuilding(_settlements.front().getSelectedForBuilding(), tile->x, tile->y));
 }
 
 size_t Game::_getEntityIDUnderCursor() {
 	size_t entityID;
-	_world->emit<RequestHighlightedEntityEvent>({ entityID });
+	_emit<RequestHighlightedEntityEvent>({ entityID });
 	return entityID;
 }
 
@@ -557,25 +1011,83 @@ void Game::_showTerrainInfoWindow() {
 	TerrainInfoWindowDataUpdateEvent tiwData;
 	tiwData.show = true;
 	tiwData.position = sf::Vector2f(sf::Mouse::getPosition(*_window)) + sf::Vector2f((float)_mouseSprite.getTextureRect().width, 0.0f);
-	if (_world->getById(entId)->has<BuildingComponent>()) {
-		auto building = _world->getById(entId)->get<BuildingComponent>().get();
+	auto tile = _world->getById(entId)->get<TileComponent>().get();
+	const IndexedBuilding* building = _buildingIndex.find(tile.x, tile.y);
+	if (building) {
+		const BuildingSpecification& bs = _assetRegistry->getBuildingSpecification(building->type);
 		tiwData.tileType = TileType::BUILDING;
-		tiwData.tileSprite = &building.sprite;
-		tiwData.name = building.spec->name;
-		tiwData.buildingDescription = building.spec->description;
-		tiwData.production = &building.spec->waresProduced;
+		tiwData.tileTexture = _assetRegistry->getTexture(bs.icon);
+		tiwData.name = bs.name;
+		tiwData.buildingDescription = bs.description;
+		tiwData.production = &bs.waresProduced;
 	}
 	else {
-		auto tile = _world->getById(entId)->get<TileComponent>().get();
 		auto res = _world->getById(entId)->get<NaturalResourceComponent>().get();
 		tiwData.tileType = TileType::TERRAIN;
-		tiwData.tileSprite = &(tile.sprite);
+		tiwData.tileTexture = _assetRegistry->getTexture(tile.name);
 		tiwData.name = tile.name;
 		tiwData.resourceSet = res.resourceSet;
 	}
-	_world->emit<TerrainInfoWindowDataUpdateEvent>(tiwData);
+	_emit<TerrainInfoWindowDataUpdateEvent>(tiwData);
 }
 
 void Game::_hideTerrainInfoWindow() {
 	_ui->hideTerrainInfoWindow();
 }
+
+void Game::_logPerfCounters(float seconds) {
+	if (_countersLogInterval <= 0) return;
+	_timeSinceCountersLog += seconds;
+	if (_timeSinceCountersLog < _countersLogInterval) return;
+	_timeSinceCountersLog = 0;
+	PerfCounters::instance().formatLastFrame(_countersLogString);
+	_logger->info("Perf counters (last frame): {}", _countersLogString);
+}
+
+void Game::_checkSteadyStateAllocations(float seconds) {
+	if (!_flagSteadyStateAllocations || PerfCounters::instance().getFrameCount() < allocationWarmupFrames) return;
+	if (PerfCounters::instance().getLastFrameValue(PerfCounterId::Allocations) > 0) {
+		++_allocatingFrames;
+	}
+	_timeSinceAllocationReport += seconds;
+	if (_timeSinceAllocationReport < allocationReportInterval) return;
+	if (_allocatingFrames > 0) {
+		_logger->warn("{} steady state frames allocated on heap during last {:.0f} s (last frame: {} allocations). Frame arena high water mark {} of {} bytes, {} overflows",
+			_allocatingFrames, _timeSinceAllocationReport, PerfCounters::instance().getLastFrameValue(PerfCounterId::Allocations),
+			_frameArena.getHighWaterMark(), _frameArena.getCapacity(), _frameArena.getOverflowCount());
+	}
+	_allocatingFrames = 0;
+	_timeSinceAllocationReport = 0;
+}
+
+void Game::_exportProfile() {
+	Profiler& profiler = Profiler::instance();
+	if (profiler.exportCSV(profileCSVFileName) && profiler.exportChromeTrace(profileTraceFileName)) {
+		_logger->info("Profile exported to '{}' and '{}'", profileCSVFileName, profileTraceFileName);
+	}
+	else {
+		_logger->error("Failed to export profile to '{}' and '{}'", profileCSVFileName, profileTraceFileName);
+	}
+}
+
+std::shared_ptr<const SaveGameSnapshot> Game::_captureSaveGameSnapshot() {
+	auto snapshot = std::make_shared<SaveGameSnapshot>();
+	snapshot->mapFileName = _mapFileName;
+	_simulation->captureSaveGame(*snapshot);
+	return snapshot;
+}
+
+// Runs on simulation thread in interactive game
+void Game::_autosave(unsigned int gameTime) {
+	if (!_autosaveScheduler || !_autosaveScheduler->isDue(gameTime)) return;
+	sf::Clock captureClock;
+	_autosaveScheduler->schedule(_captureSaveGameSnapshot());
+	sf::Int64 captureTime = captureClock.getElapsedTime().asMicroseconds();
+	// Capture isn't cut short: a save must be complete, so its cost is only measured and reported
+	if (captureTime > autosaveCaptureWarningThreshold) {
+		_logger->warn("Autosave snapshot took {} us of simulation time, over warning threshold of {} us", captureTime, autosaveCaptureWarningThreshold);
+	}
+	else {
+		_logger->trace("Autosave snapshot took {} us of simulation time", captureTime);
+	}
+}
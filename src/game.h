@@ -1,10 +1,25 @@
 #pragma once
 
 #include <spdlog/spdlog.h>
+#include <deque>
 #include <memory>
 #include <SFML/Graphics.hpp>
 #include <ECS.h>
 #include "asset_registry.h"
+#include "autosave_scheduler.h"
+#include "building_index.h"
+#include "command.h"
+#include "distance_field.h"
+#include "economy_forecast.h"
+#include "profiler_overlay.h"
+#include "perf_counters.h"
+#include "frame_arena.h"
+#include "hot_reload.h"
+#include "job_system.h"
+#include "map_data.h"
+#include "settlement.h"
+#include "settlement_builder.h"
+#include "simulation.h"
 #include "ui.h"
 
 namespace Archipelago {
@@ -18,31 +33,74 @@ namespace Archipelago {
 	/** Main game class, entry point.
 	* Loads, configures and initialises all the components
 	*/
-	class Game {
+	class Game : public SettlementWorld {
 	public:
 		Game();
 		Game(const Game&) = delete;
 		~Game();
 		void init();
+		void initReplay(const std::string& recordingFileName);
+		void initHeadless(const std::string& mapFileName);
 		void run();
+		void runReplay();
 		void shutdown();
+		void startRecording(const std::string& recordingFileName);
+		/** Replaces the map. Refused once any building is placed, because settlements, simulation and logistics
+		* would keep buildings of the old map. Returns false if refused
+		*/
+		bool loadMap(const MapData& map);
 
 		sf::RenderWindow& getRenderWindow() const { return *_window; };
 		Archipelago::AssetRegistry& getAssetRegistry() const { return *_assetRegistry; }
+		Archipelago::JobSystem& getJobSystem() const { return *_jobSystem; };
 		ECS::World* getWorld() const { return _world; };
+		const sf::View& getView() const { return _window ? _window->getView() : _headlessView; };
+		void setView(const sf::View& view);
+		bool isHeadless() const { return !_window; };
+		unsigned int getMapResidentChunkBudget() const { return _mapResidentChunkBudget; };
 		const float getRenderWindowWidth() const { return _windowWidth; };
 		const float getRenderWindowHeight() const { return _windowHeight; };
-		std::string composeGameTimeString(void);
+		FrameString composeGameTimeString(void);
+		FrameArena& getFrameArena() { return _frameArena; };
 		const std::string& getStatusString() const { return _statusString; };
-		const size_t getSettlementWaresNumber() const { return _settlementWares.size(); };
-		bool settlementHasWareForBuilding(const BuildingSpecification& bs, WaresTypeId ware);
-		const sf::Image getWareIcon(unsigned int idx) const { return _assetRegistry->getWaresSpecification(_settlementWares[idx].type).icon->copyToImage(); };
+		/// Adds an empty settlement, e.g. for an AI agent. Game must be initialised
+		SettlementId addSettlement();
+		/// Adds settlements expanded by AI builders, which act once every game month. Seed makes their choices repeatable
+		void addAiSettlements(unsigned int count, uint32_t seed);
+		/// Lets every AI builder place up to aiStepsPerMonth buildings on the calling thread, returns number placed
+		size_t runAiBuilders();
+		/// Headless only. Applies pending commands and advances game time to the next month
+		void advanceMonth() { _advanceGameMonth(); };
+		/// Placement rules of the tile, checked on map layers without touching the ECS, e.g. by AI builders scanning many tiles
+		virtual bool isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const override;
+		/// For AI settlements, player buildings are placed through commands. Returns false if rules don't allow it
+		virtual bool placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) override { return _placeBuilding(settlementId, buildingID, tileX, tileY); };
+		/// Terrain costs of the map, empty if map terrain couldn't be read
+		virtual const LogisticsGrid& getReachGrid() const override { return _reachGrid; };
+		/// Natural resources of the tile, one type id per byte as in map files
+		virtual uint32_t getTileResources(unsigned int tileX, unsigned int tileY) const override;
+		virtual bool anyBuildingInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const override { return _buildingIndex.anyInRect(x0, y0, x1, y1); };
+		virtual const Settlement& getSettlement(SettlementId id) const override { return _settlements[id]; };
+		virtual const BuildingSpecification& getBuildingSpecification(BuildingTypeId type) const override { return _assetRegistry->getBuildingSpecification(type); };
+		size_t getSettlementCount() const { return _settlements.size(); };
+		const size_t getSettlementWaresNumber() const { return _settlements.front().getWares().size(); };
+		const sf::Image getWareIcon(unsigned int idx) const { return _assetRegistry->getTexture(_assetRegistry->getWaresSpecification(_settlements.front().getWares()[idx].type).icon)->copyToImage(); };
 		const sf::Sprite getMouseSprite() { return _mouseSprite; };
-		const int getWareAmount(unsigned int idx) const { return _settlementWares[idx].amount; };
+		const int getWareAmount(unsigned int idx) const { return _settlements.front().getWares()[idx].amount; };
+		/// Forecast of the player economy as of the latest simulation snapshot
+		const EconomyForecast& getForecast() const { return _forecast; };
+		/// Game months until the player settlement can afford the building at current production, noForecast if not within forecastHorizonDefault
+		unsigned int forecastMonthsUntilAffordable(const BuildingSpecification& bs) const { return _forecast.monthsUntilAvailable(_settlements.front().getWares(), bs.waresRequired); };
 		void onUISelectBuilding(BuildingTypeId buildingID);
+		const BuildingIndex& getBuildingIndex() const { return _buildingIndex; };
 	private:
+		void _loadConfig();
+		void _initWorld();
+		/// Reads terrain of map file for logistics and reach fields. Owner only, simulation not running
+		void _initLogistics();
 		void _initRenderSystem();
-		void _initSettlementGoods();
+		void _initSettlements();
+		void _initReachFields(const LogisticsGrid& grid, const std::vector<uint32_t>& resources);
 		void _processEvents(sf::Event event);
 		void _processInput(const sf::Time& frameTime);
 		void _update(const sf::Time& frameTime);
@@ -51,38 +109,98 @@ namespace Archipelago {
 		void _setMouseCursorNormal();
 		void _processMouseMovement();
 		void _zoomCamera(float zoomFactor);
-		void _updateSettlement(void);
-		bool _requiredNatresPresentOnTile(ECS::Entity* ent, BuildingTypeId buildingID);
-		bool _settlementHasWaresForBuilding(const BuildingSpecification& bs);
-		bool _settlementExceededAllowedBuildingAmount(const BuildingSpecification& bs);
-		void _placeBuilding();
+		void _advanceGameMonth();
+		void _applySimulationSnapshot();
+		void _pushSimulationCommand(const SimulationCommand& command);
+		void _issueCommand(Command command);
+		void _executeCommand(const Command& command);
+		void _changeGameSpeed(int speedStep);
+		bool _requiredNatresInReach(uint32_t resourceSet, unsigned int tileX, unsigned int tileY, const BuildingSpecification& bs) const;
+		bool _placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY);
+		void _placeSelectedBuildingUnderCursor();
 		size_t _getEntityIDUnderCursor();
 		void _showTerrainInfoWindow();
 		void _hideTerrainInfoWindow();
+		void _exportProfile();
+		void _logPerfCounters(float seconds);
+		void _checkSteadyStateAllocations(float seconds);
+		template<typename Event>
+		void _emit(const Event& event) {
+			PerfCounters::instance().add(eventCounterIndex<Event>());
+			_world->emit<Event>(event);
+		}
+		std::shared_ptr<const SaveGameSnapshot> _captureSaveGameSnapshot();
+		void _autosave(unsigned int gameTime);
+		/// Swaps in files hot reload parsed since last frame. Runs between frames with simulation stopped
+		void _applyHotReload();
+		/// Starts AI builders planning on the job system, so that their map scans don't take frame time
+		void _scheduleAiBuilders();
+		/// Waits for planning AI builders, if any, and places what they planned. Must run before the game changes anything they read
+		void _finishAiBuilders();
+		/// Places buildings of the AI plan for real, returns number placed
+		size_t _placeAiPlan();
 
 		// game posessions
 		std::shared_ptr<spdlog::logger> _logger;
+		std::unique_ptr<Archipelago::JobSystem> _jobSystem; // declared first, users of jobs must be destroyed before it
+		std::unique_ptr<Archipelago::Simulation> _simulation; // economies, game time and stockpiles
 		std::unique_ptr<Archipelago::AssetRegistry> _assetRegistry;
 		std::unique_ptr<sf::RenderWindow> _window;
 		std::unique_ptr<Archipelago::Ui> _ui;
+		std::unique_ptr<Archipelago::AutosaveScheduler> _autosaveScheduler;
+		std::unique_ptr<Archipelago::ProfilerOverlay> _profilerOverlay;
+		std::unique_ptr<Archipelago::HotReload> _hotReload; // null unless enabled, interactive game only
 		ECS::World* _world;
+		std::unique_ptr<Archipelago::CommandRecording> _recording; // session being recorded or replayed
+		std::string _recordingFileName;
 
 		// game options (see config.json)
+		std::string _mapFileName;
+		unsigned int _mapResidentChunkBudget; // chunks, streamed maps only
+		size_t _textureBudget; // bytes of evictable textures
 		bool _isFullscreen;
 		bool _enable_vsync;
+		bool _autosaveEnabled;
+		unsigned int _autosaveInterval; // months
+		float _countersLogInterval; // seconds, 0 = don't log
+		bool _flagSteadyStateAllocations;
+		bool _hotReloadEnabled;
+		unsigned int _aiSettlementCount;
+		uint32_t _aiSeed;
+		std::string _autosaveFileName;
 		float _windowWidth, _windowHeight;
 		MouseState _mouseState;
 		sf::Sprite _mouseSprite;
+		sf::View _headlessView; // camera used when there is no render window
+		sf::Texture* _backgroundTexture;
+		sf::Sprite _backgroundSprite;
 
-		// game mechanic stuff
+		// game mechanic stuff, mirrored from simulation snapshots
 		unsigned int _gameTime; // Months since game start
 		unsigned int _currentGameMonthDuration; // Game month duration in realtime seconds
-		std::vector<WaresStack> _settlementWares; // Current stock of settlement wares
-		BuildingTypeId _selectedForBuilding;
+		unsigned int _monthProgress; // Realtime milliseconds elapsed within current month
+		std::deque<Settlement> _settlements; // by settlement id, the player's first
+		PlannedSettlementWorld _aiPlan{ *this }; // what AI builders see and place into
+		std::vector<std::unique_ptr<SettlementBuilder>> _aiBuilders;
+		JobHandle _aiJob; // AI builders planning, null while they don't
+		unsigned int _aiGameTime{ 0 }; // game month AI builders last acted in
+		uint64_t _simulationCommandsIssued{ 0 };
+		EconomyForecast _forecast; // player economy, copied from snapshots when it changes
+		uint64_t _forecastVersion{ 0 };
+
+		// distance fields over the map, for placement rules
+		LogisticsGrid _reachGrid;
+		std::vector<uint32_t> _natresLayer; // resource set by tile, empty if map resources couldn't be read
+		DistanceField _natresFields[naturalResourceTypeCount]; // only resources required within a radius are filled
+		BuildingIndex _buildingIndex; // placed buildings by position, for visibility, placement limits and area queries
 		
 		// auxilary vars
 		std::string _statusString;
-		sf::Time _accumulatedTime{ sf::Time::Zero };
+		float _timeSinceCountersLog{ 0 }; // seconds
+		std::string _countersLogString;
+		FrameArena _frameArena; // transient per-frame data, reset at the end of every game loop iteration
+		float _timeSinceAllocationReport{ 0 }; // seconds
+		unsigned int _allocatingFrames{ 0 }; // steady state frames with heap allocations since last report
 		int _cameraMoveIntervalCooldown; // milliseconds
 		unsigned int _numThreads;
 		unsigned int _fps;
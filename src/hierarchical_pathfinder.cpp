@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include "hierarchical_pathfinder.h"
+
+namespace Archipelago {
+
+	const unsigned int longBorderSegment{ 6 }; /// passable border stretches this long get a portal at both ends instead of one in the middle
+	const uint32_t noTile{ ~0u }; /// no target of local search, unused portal slot
+	const uint16_t noLocalTile{ 0xFFFF };
+
+}
+
+using namespace Archipelago;
+
+void HierarchicalPathfinder::build(LogisticsGrid grid) {
+	_grid = std::move(grid);
+	_clustersX = (_grid.width + pathClusterSize - 1) / pathClusterSize;
+	_clustersY = (_grid.height + pathClusterSize - 1) / pathClusterSize;
+	_clusters.assign(static_cast<size_t>(_clustersX) * _clustersY, Cluster());
+	for (unsigned int clusterY = 0; clusterY < _clustersY; clusterY++) {
+		for (unsigned int clusterX = 0; clusterX < _clustersX; clusterX++) {
+			_buildCluster(clusterX, clusterY);
+		}
+	}
+	// Every portal plus start and goal of a query
+	size_t nodeCount = _clusters.size() * portalsPerCluster + 2;
+	_nodeCost.assign(nodeCount, noPath);
+	_nodeParent.assign(nodeCount, 0);
+	_nodeStamp.assign(nodeCount, 0);
+	_stamp = 0;
+}
+
+void HierarchicalPathfinder::setTileCost(unsigned int x, unsigned int y, uint8_t cost) {
+	if (x >= _grid.width || y >= _grid.height) return;
+	uint8_t& tileCost = _grid.cost[static_cast<size_t>(y) * _grid.width + x];
+	if (tileCost == cost) return;
+	tileCost = cost;
+	unsigned int clusterX = x / pathClusterSize, clusterY = y / pathClusterSize;
+	_buildCluster(clusterX, clusterY);
+	// Border tiles also change portals of the cluster across
+	if (x % pathClusterSize == 0 && clusterX > 0) _buildCluster(clusterX - 1, clusterY);
+	if ((x + 1) % pathClusterSize == 0 && clusterX + 1 < _clustersX) _buildCluster(clusterX + 1, clusterY);
+	if (y % pathClusterSize == 0 && clusterY > 0) _buildCluster(clusterX, clusterY - 1);
+	if ((y + 1) % pathClusterSize == 0 && clusterY + 1 < _clustersY) _buildCluster(clusterX, clusterY + 1);
+}
+
+unsigned int HierarchicalPathfinder::findPath(uint32_t from, uint32_t to, unsigned int maxCost, std::vector<uint32_t>* tiles) {
+	if (tiles) tiles->clear();
+	if (_grid.cost.empty()) return noPath;
+	if (from == to) {
+		if (tiles) tiles->push_back(from);
+		return 0;
+	}
+	size_t fromCluster = _clusterOf(from), toCluster = _clusterOf(to);
+	Rect fromRect = _clusterRect(fromCluster), toRect = _clusterRect(toCluster);
+	// Close tiles are searched directly within their clusters, portals would make short paths detour
+	if (std::abs(static_cast<int>(fromRect.x0) - static_cast<int>(toRect.x0)) <= static_cast<int>(pathClusterSize) &&
+		std::abs(static_cast<int>(fromRect.y0) - static_cast<int>(toRect.y0)) <= static_cast<int>(pathClusterSize)) {
+		Rect nearRect = { std::min(fromRect.x0, toRect.x0), std::min(fromRect.y0, toRect.y0), std::max(fromRect.x1, toRect.x1), std::max(fromRect.y1, toRect.y1) };
+		_searchLocal(from, nearRect, false, to);
+		unsigned int cost = _localCostAt(to, nearRect);
+		if (cost != noPath) { // detours through other clusters are not looked for
+			if (cost > maxCost) return noPath;
+			if (tiles) {
+				tiles->push_back(from);
+				_appendLocalPath(to, nearRect, *tiles);
+			}
+			return cost;
+		}
+	}
+
+	// Start and goal join the portal graph through their clusters
+	const uint32_t startNode = static_cast<uint32_t>(_clusters.size() * portalsPerCluster), goalNode = startNode + 1;
+	_searchFrom = from;
+	_searchTo = to;
+	const Cluster& startCluster = _clusters[fromCluster];
+	_searchLocal(from, fromRect, false, noTile);
+	_startEdges.clear();
+	for (unsigned int slot = 0; slot < portalsPerCluster; slot++) {
+		if (startCluster.portalTiles[slot] == noTile) continue;
+		unsigned int cost = _localCostAt(startCluster.portalTiles[slot], fromRect);
+		if (cost != noPath) _startEdges.push_back({ static_cast<uint32_t>(fromCluster * portalsPerCluster + slot), cost });
+	}
+	const Cluster& goalCluster = _clusters[toCluster];
+	_searchLocal(to, toRect, true, to);
+	bool goalReachable = false;
+	for (unsigned int slot = 0; slot < portalsPerCluster; slot++) {
+		_goalCost[slot] = goalCluster.portalTiles[slot] != noTile ? _localCostAt(goalCluster.portalTiles[slot], toRect) : noPath;
+		goalReachable = goalReachable || _goalCost[slot] != noPath;
+	}
+	if (_startEdges.empty() || !goalReachable) return noPath;
+
+	if (++_stamp == 0) { // wrapped around, forget stamps of old searches
+		std::fill(_nodeStamp.begin(), _nodeStamp.end(), 0);
+		_stamp = 1;
+	}
+	_openSet.clear();
+	_nodeStamp[startNode] = _stamp;
+	_nodeCost[startNode] = 0;
+	_nodeParent[startNode] = startNode;
+	_openSet.push_back({ _heuristic(from, to), startNode });
+	std::greater<std::pair<unsigned int, uint32_t>> lowestFirst;
+	bool found = false;
+	while (!_openSet.empty()) {
+		std::pop_heap(_openSet.begin(), _openSet.end(), lowestFirst);
+		uint32_t node = _openSet.back().second;
+		unsigned int estimate = _openSet.back().first;
+		_openSet.pop_back();
+		unsigned int cost = _nodeCost[node];
+		if (estimate > cost + _heuristic(_nodeTile(node), to)) continue; // node was reached cheaper after this entry was queued
+		if (node == goalNode) {
+			found = true;
+			break;
+		}
+		auto relax = [&](uint32_t next, unsigned int stepCost) {
+			unsigned int nextCost = cost + stepCost;
+			unsigned int nextEstimate = nextCost + _heuristic(_nodeTile(next), to);
+			if (nextEstimate > maxCost) return;
+			if (_nodeStamp[next] == _stamp && _nodeCost[next] <= nextCost) return;
+			_nodeStamp[next] = _stamp;
+			_nodeCost[next] = nextCost;
+			_nodeParent[next] = node;
+			_openSet.push_back({ nextEstimate, next });
+			std::push_heap(_openSet.begin(), _openSet.end(), lowestFirst);
+		};
+		if (node == startNode) {
+			for (const Edge& edge : _startEdges) relax(edge.node, edge.cost);
+			continue;
+		}
+		size_t cluster = node / portalsPerCluster;
+		unsigned int slot = node % portalsPerCluster;
+		const Cluster& nodeCluster = _clusters[cluster];
+		for (uint16_t edge = nodeCluster.edgeBegin[slot]; edge < nodeCluster.edgeBegin[slot + 1]; edge++) {
+			relax(nodeCluster.edges[edge].node, nodeCluster.edges[edge].cost);
+		}
+		if (cluster == toCluster && _goalCost[slot] != noPath) relax(goalNode, _goalCost[slot]);
+	}
+	if (!found) return noPath;
+
+	if (tiles) {
+		_abstractPath.clear();
+		for (uint32_t node = goalNode; node != startNode; node = _nodeParent[node]) {
+			_abstractPath.push_back(_nodeTile(node));
+		}
+		_abstractPath.push_back(from);
+		std::reverse(_abstractPath.begin(), _abstractPath.end());
+		tiles->push_back(from);
+		for (size_t i = 1; i < _abstractPath.size(); i++) {
+			uint32_t a = _abstractPath[i - 1], b = _abstractPath[i];
+			if (a == b) continue; // portals of two borders on a corner tile
+			size_t cluster = _clusterOf(a);
+			if (cluster != _clusterOf(b)) { // across the border, tiles are neighbours
+				tiles->push_back(b);
+			}
+			else {
+				Rect rect = _clusterRect(cluster);
+				_searchLocal(a, rect, false, b);
+				_appendLocalPath(b, rect, *tiles);
+			}
+		}
+	}
+	return _nodeCost[goalNode];
+}
+
+size_t HierarchicalPathfinder::getPortalCount() const {
+	size_t count = 0;
+	for (const Cluster& cluster : _clusters) {
+		count += std::count_if(std::begin(cluster.portalTiles), std::end(cluster.portalTiles), [](uint32_t tile) { return tile != noTile; });
+	}
+	return count;
+}
+
+void HierarchicalPathfinder::_buildCluster(unsigned int clusterX, unsigned int clusterY) {
+	size_t index = static_cast<size_t>(clusterY) * _clustersX + clusterX;
+	Rect rect = _clusterRect(index);
+	Cluster& cluster = _clusters[index];
+	const int tileAcross[4] = { -1, 1, -static_cast<int>(_grid.width), static_cast<int>(_grid.width) };
+	const int clusterAcross[4] = { -1, 1, -static_cast<int>(_clustersX), static_cast<int>(_clustersX) };
+	Edge borderEdges[portalsPerCluster];
+	std::fill(std::begin(cluster.portalTiles), std::end(cluster.portalTiles), noTile);
+	for (unsigned int border = Left; border <= Bottom; border++) {
+		_borderPortals(rect, static_cast<Border>(border), _borderTiles);
+		// Slots on the other side are numbered the same, only from the opposite border
+		uint32_t acrossBase = static_cast<uint32_t>((index + clusterAcross[border]) * portalsPerCluster + (border ^ 1) * portalsPerBorder);
+		for (unsigned int i = 0; i < _borderTiles.size(); i++) {
+			unsigned int slot = border * portalsPerBorder + i;
+			cluster.portalTiles[slot] = _borderTiles[i];
+			borderEdges[slot] = { acrossBase + i, _grid.cost[_borderTiles[i] + tileAcross[border]] };
+		}
+	}
+	cluster.edges.clear();
+	for (unsigned int slot = 0; slot < portalsPerCluster; slot++) {
+		cluster.edgeBegin[slot] = static_cast<uint16_t>(cluster.edges.size());
+		if (cluster.portalTiles[slot] == noTile) continue;
+		cluster.edges.push_back(borderEdges[slot]);
+		_searchLocal(cluster.portalTiles[slot], rect, false, noTile);
+		for (unsigned int other = 0; other < portalsPerCluster; other++) {
+			if (other == slot || cluster.portalTiles[other] == noTile) continue;
+			unsigned int cost = _localCostAt(cluster.portalTiles[other], rect);
+			if (cost != noPath) cluster.edges.push_back({ static_cast<uint32_t>(index * portalsPerCluster + other), cost });
+		}
+	}
+	cluster.edgeBegin[portalsPerCluster] = static_cast<uint16_t>(cluster.edges.size());
+}
+
+void HierarchicalPathfinder::_borderPortals(const Rect& rect, Border border, std::vector<uint32_t>& tiles) const {
+	tiles.clear();
+	unsigned int x, y, length;
+	if (border == Left || border == Right) {
+		if ((border == Left && rect.x0 == 0) || (border == Right && rect.x1 == _grid.width)) return;
+		x = border == Left ? rect.x0 : rect.x1 - 1;
+		y = rect.y0;
+		length = rect.y1 - rect.y0;
+	}
+	else {
+		if ((border == Top && rect.y0 == 0) || (border == Bottom && rect.y1 == _grid.height)) return;
+		x = rect.x0;
+		y = border == Top ? rect.y0 : rect.y1 - 1;
+		length = rect.x1 - rect.x0;
+	}
+	bool vertical = border == Left || border == Right;
+	auto tileAt = [&](unsigned int i) { return vertical ? (y + i) * _grid.width + x : y * _grid.width + x + i; };
+	int across = border == Left ? -1 : border == Right ? 1 : border == Top ? -static_cast<int>(_grid.width) : static_cast<int>(_grid.width);
+	unsigned int segmentStart = 0;
+	for (unsigned int i = 0; i <= length; i++) {
+		bool passable = i < length && _grid.cost[tileAt(i)] != impassableTileCost && _grid.cost[tileAt(i) + across] != impassableTileCost;
+		if (passable) continue;
+		unsigned int segmentLength = i - segmentStart;
+		if (segmentLength >= longBorderSegment) {
+			tiles.push_back(tileAt(segmentStart));
+			tiles.push_back(tileAt(i - 1));
+		}
+		else if (segmentLength > 0) {
+			tiles.push_back(tileAt(segmentStart + (segmentLength - 1) / 2));
+		}
+		segmentStart = i + 1;
+	}
+}
+
+void HierarchicalPathfinder::_searchLocal(uint32_t source, const Rect& rect, bool reverse, uint32_t target) {
+	// Runs on a copy of cluster costs in cluster coordinates, this is the inner loop of building clusters
+	unsigned int width = rect.x1 - rect.x0, height = rect.y1 - rect.y0;
+	_localTileCost.resize(static_cast<size_t>(width) * height);
+	for (unsigned int y = 0; y < height; y++) {
+		const uint8_t* row = &_grid.cost[static_cast<size_t>(rect.y0 + y) * _grid.width + rect.x0];
+		std::copy(row, row + width, _localTileCost.begin() + y * width);
+	}
+	uint16_t localTarget = noLocalTile;
+	if (target != noTile && target % _grid.width - rect.x0 < width && target / _grid.width - rect.y0 < height) {
+		localTarget = static_cast<uint16_t>(_localIndex(target, rect));
+		if (_localTileCost[localTarget] == impassableTileCost) _localTileCost[localTarget] = roadTileCost;
+	}
+	uint16_t localSource = static_cast<uint16_t>(_localIndex(source, rect));
+	_localCost.assign(_localTileCost.size(), noPath);
+	_localParent.resize(_localTileCost.size());
+	_localHeap.clear();
+	_localCost[localSource] = 0;
+	_localParent[localSource] = localSource;
+	_localHeap.push_back({ 0, localSource });
+	std::greater<std::pair<unsigned int, uint16_t>> lowestFirst;
+	while (!_localHeap.empty()) {
+		std::pop_heap(_localHeap.begin(), _localHeap.end(), lowestFirst);
+		unsigned int cost = _localHeap.back().first;
+		uint16_t tile = _localHeap.back().second;
+		_localHeap.pop_back();
+		if (cost > _localCost[tile]) continue;
+		if (!reverse && tile == localTarget) break;
+		// Backwards, every step from a neighbour enters this tile
+		unsigned int reverseStep = _localTileCost[tile];
+		if (reverse && reverseStep == impassableTileCost) continue;
+		unsigned int x = tile % width, y = tile / width;
+		const uint16_t neighbours[4] = {
+			static_cast<uint16_t>(x > 0 ? tile - 1 : tile),
+			static_cast<uint16_t>(x + 1 < width ? tile + 1 : tile),
+			static_cast<uint16_t>(y > 0 ? tile - width : tile),
+			static_cast<uint16_t>(y + 1 < height ? tile + width : tile)
+		};
+		for (uint16_t next : neighbours) {
+			if (next == tile) continue;
+			unsigned int step = reverse ? reverseStep : _localTileCost[next];
+			if (step == impassableTileCost || cost + step >= _localCost[next]) continue;
+			_localCost[next] = cost + step;
+			_localParent[next] = tile;
+			_localHeap.push_back({ cost + step, next });
+			std::push_heap(_localHeap.begin(), _localHeap.end(), lowestFirst);
+		}
+	}
+}
+
+unsigned int HierarchicalPathfinder::_localCostAt(uint32_t tile, const Rect& rect) const {
+	return _localCost[_localIndex(tile, rect)];
+}
+
+void HierarchicalPathfinder::_appendLocalPath(uint32_t tile, const Rect& rect, std::vector<uint32_t>& tiles) const {
+	unsigned int width = rect.x1 - rect.x0;
+	size_t begin = tiles.size();
+	for (size_t step = _localIndex(tile, rect); _localParent[step] != step; step = _localParent[step]) {
+		tiles.push_back(static_cast<uint32_t>((rect.y0 + step / width) * _grid.width + rect.x0 + step % width));
+	}
+	std::reverse(tiles.begin() + begin, tiles.end());
+}
+
+size_t HierarchicalPathfinder::_localIndex(uint32_t tile, const Rect& rect) const {
+	return (tile / _grid.width - rect.y0) * (rect.x1 - rect.x0) + tile % _grid.width - rect.x0;
+}
+
+size_t HierarchicalPathfinder::_clusterOf(uint32_t tile) const {
+	return static_cast<size_t>(tile / _grid.width / pathClusterSize) * _clustersX + tile % _grid.width / pathClusterSize;
+}
+
+HierarchicalPathfinder::Rect HierarchicalPathfinder::_clusterRect(size_t cluster) const {
+	unsigned int x0 = static_cast<unsigned int>(cluster % _clustersX) * pathClusterSize;
+	unsigned int y0 = static_cast<unsigned int>(cluster / _clustersX) * pathClusterSize;
+	return { x0, y0, std::min(x0 + pathClusterSize, _grid.width), std::min(y0 + pathClusterSize, _grid.height) };
+}
+
+uint32_t HierarchicalPathfinder::_nodeTile(uint32_t node) const {
+	size_t cluster = node / portalsPerCluster;
+	if (cluster == _clusters.size()) return node % portalsPerCluster == 0 ? _searchFrom : _searchTo;
+	return _clusters[cluster].portalTiles[node % portalsPerCluster];
+}
+
+unsigned int HierarchicalPathfinder::_heuristic(uint32_t from, uint32_t to) const {
+	int dx = static_cast<int>(from % _grid.width) - static_cast<int>(to % _grid.width);
+	int dy = static_cast<int>(from / _grid.width) - static_cast<int>(to / _grid.width);
+	return static_cast<unsigned int>(std::abs(dx) + std::abs(dy)) * roadTileCost;
+}
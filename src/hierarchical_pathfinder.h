@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Archipelago {
+
+	const uint8_t impassableTileCost{ 0 };
+	const uint8_t roadTileCost{ 1 }; /// cheapest tile, lower bounds of path costs rely on it
+	const unsigned int pathClusterSize{ 16 }; /// cluster side in tiles
+	const unsigned int portalsPerBorder{ pathClusterSize / 2 }; /// enough for a border of alternating passable and blocked tiles
+	const unsigned int portalsPerCluster{ 4 * portalsPerBorder };
+	const unsigned int noPath{ ~0u };
+
+	/// Cost of entering each tile of the map, row-major. impassableTileCost marks tiles that can't be crossed
+	struct LogisticsGrid {
+		unsigned int width{ 0 };
+		unsigned int height{ 0 };
+		std::vector<uint8_t> cost;
+	};
+
+	/** Hierarchical A* (HPA*) over a tile cost grid.
+	* The map is cut into square clusters. Every passable stretch of a border between two clusters
+	* gets one or two portals, and within each cluster portals are joined by precomputed cheapest costs.
+	* Queries search this small portal graph instead of the tiles, and only refine the abstract path
+	* into tiles inside the clusters it passes. Paths are near-optimal: within a few percent of flat A*.
+	* Tiles in the same or neighbouring clusters are searched directly on tiles of those clusters.
+	* Changing a tile rebuilds its cluster and, for border tiles, the neighbouring one.
+	* Every border has fixed portal slots, so portal graph nodes are plain indices (cluster * portalsPerCluster + slot)
+	* which stay valid when a neighbouring cluster is rebuilt, and search state lives in flat arrays.
+	* The goal tile of a query may be impassable itself (e.g. a storage on the shore) as long as it's entered from its own cluster.
+	*/
+	class HierarchicalPathfinder {
+	public:
+		/// Precomputes every cluster of the grid
+		void build(LogisticsGrid grid);
+		const LogisticsGrid& getGrid() const { return _grid; };
+		/// Changes cost of one tile and rebuilds only the clusters it affects
+		void setTileCost(unsigned int x, unsigned int y, uint8_t cost);
+		/** Cost of a path between two tiles, or noPath if there is none within maxCost.
+		* If tiles is given it receives the path, from and to included.
+		*/
+		unsigned int findPath(uint32_t from, uint32_t to, unsigned int maxCost, std::vector<uint32_t>* tiles);
+		size_t getClusterCount() const { return _clusters.size(); };
+		size_t getPortalCount() const;
+	private:
+		struct Edge {
+			uint32_t node;
+			unsigned int cost;
+		};
+		struct Cluster {
+			uint32_t portalTiles[portalsPerCluster]; // ~0u for unused slots
+			uint16_t edgeBegin[portalsPerCluster + 1]; // edges of slot i are edges[edgeBegin[i]] up to edges[edgeBegin[i + 1]]
+			std::vector<Edge> edges; // to portals of the same cluster and across the border
+		};
+		enum Border : unsigned int { Left, Right, Top, Bottom };
+		struct Rect {
+			unsigned int x0, y0, x1, y1; // x1, y1 exclusive
+		};
+		void _buildCluster(unsigned int clusterX, unsigned int clusterY);
+		/// Portal tiles of one border of a cluster, in the same order when seen from either side
+		void _borderPortals(const Rect& rect, Border border, std::vector<uint32_t>& tiles) const;
+		/** Dijkstra within rect of at most 2x2 clusters, costs go to _localCost. Reverse search gives costs of reaching source instead.
+		* Target may be entered even if impassable, forward search stops there.
+		*/
+		void _searchLocal(uint32_t source, const Rect& rect, bool reverse, uint32_t target);
+		unsigned int _localCostAt(uint32_t tile, const Rect& rect) const;
+		/// Appends local path ending at tile, start excluded, from last forward _searchLocal
+		void _appendLocalPath(uint32_t tile, const Rect& rect, std::vector<uint32_t>& tiles) const;
+		size_t _localIndex(uint32_t tile, const Rect& rect) const;
+		size_t _clusterOf(uint32_t tile) const;
+		Rect _clusterRect(size_t cluster) const;
+		uint32_t _nodeTile(uint32_t node) const;
+		unsigned int _heuristic(uint32_t from, uint32_t to) const;
+
+		LogisticsGrid _grid;
+		unsigned int _clustersX{ 0 };
+		unsigned int _clustersY{ 0 };
+		std::vector<Cluster> _clusters;
+		// search buffers, reused
+		std::vector<uint8_t> _localTileCost; // by tile within rect
+		std::vector<unsigned int> _localCost;
+		std::vector<uint16_t> _localParent;
+		std::vector<std::pair<unsigned int, uint16_t>> _localHeap;
+		std::vector<uint32_t> _borderTiles;
+		std::vector<Edge> _startEdges;
+		unsigned int _goalCost[portalsPerCluster]; // cost of reaching goal from portals of its cluster
+		uint32_t _searchFrom{ 0 }; // tiles of start and goal nodes
+		uint32_t _searchTo{ 0 };
+		std::vector<unsigned int> _nodeCost; // by node, valid if _nodeStamp matches _stamp
+		std::vector<uint32_t> _nodeParent;
+		std::vector<uint32_t> _nodeStamp;
+		uint32_t _stamp{ 0 };
+		std::vector<std::pair<unsigned int, uint32_t>> _openSet; // (estimated total cost, node), min-heap
+		std::vector<uint32_t> _abstractPath;
+	};
+
+} // namespace Archipelago
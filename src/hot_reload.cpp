@@ -0,0 +1,83 @@
+#include <spdlog/spdlog.h>
+#include "hot_reload.h"
+
+namespace Archipelago {
+
+	extern const std::string& loggerName;
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	/// Parses specification file into a fresh atlas, null if the file isn't usable right now
+	template<typename Atlas>
+	std::unique_ptr<Atlas> parseChangedSpecifications(const std::string& fileName, texture_list_t& icons) {
+		auto atlas = std::make_unique<Atlas>();
+		if (!AssetRegistry::parseSpecificationFile(fileName, *atlas, icons)) {
+			spdlog::get(loggerName)->error("HotReload: '{}' changed but can't be loaded, keeping current specifications", fileName);
+			return nullptr;
+		}
+		return atlas;
+	}
+
+}
+
+void HotReload::start(const std::string& mapFileName) {
+	_watcher.watch(waresSpecificationFileName, [this](const std::string& fileName) {
+		texture_list_t icons;
+		auto atlas = parseChangedSpecifications<wares_atlas_t>(fileName, icons);
+		if (!atlas) return;
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending.wares = std::move(atlas);
+		_pending.waresIcons = std::move(icons);
+		_hasPending = true;
+	});
+	_watcher.watch(naturalResourcesSpecificationFileName, [this](const std::string& fileName) {
+		texture_list_t icons;
+		auto atlas = parseChangedSpecifications<natres_atlas_t>(fileName, icons);
+		if (!atlas) return;
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending.natres = std::move(atlas);
+		_pending.natresIcons = std::move(icons);
+		_hasPending = true;
+	});
+	_watcher.watch(buildingsSpecificationFileName, [this](const std::string& fileName) {
+		texture_list_t icons;
+		auto atlas = parseChangedSpecifications<buildings_atlas_t>(fileName, icons);
+		if (!atlas) return;
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending.buildings = std::move(atlas);
+		_pending.buildingIcons = std::move(icons);
+		_hasPending = true;
+	});
+	_watcher.watch(mapFileName, [this](const std::string& fileName) { _reloadMap(fileName); });
+	_watcher.start();
+	spdlog::get(loggerName)->info("HotReload: watching specification files and map '{}'", mapFileName);
+}
+
+bool HotReload::takePending(HotReloadBatch& batch) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_hasPending) return false;
+	batch = std::move(_pending);
+	_pending = HotReloadBatch();
+	_hasPending = false;
+	return true;
+}
+
+void HotReload::_reloadMap(const std::string& fileName) {
+	std::unique_ptr<MapData> map;
+	ChunkedMapReader reader;
+	if (!reader.open(fileName)) { // chunked maps are only checked, streaming reads them again
+		map = std::make_unique<MapData>();
+		if (!loadMapFile(fileName, *map)) {
+			spdlog::get(loggerName)->error("HotReload: map '{}' changed but can't be loaded, keeping current map", fileName);
+			return;
+		}
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pending.isMapChanged = true;
+	_pending.map = std::move(map);
+	_hasPending = true;
+}
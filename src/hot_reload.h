@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include "asset_registry.h"
+#include "file_watcher.h"
+#include "map_data.h"
+
+namespace Archipelago {
+
+	/// Files parsed by hot reload since the last frame boundary, null members didn't change
+	struct HotReloadBatch {
+		std::unique_ptr<wares_atlas_t> wares;
+		texture_list_t waresIcons;
+		std::unique_ptr<natres_atlas_t> natres;
+		texture_list_t natresIcons;
+		std::unique_ptr<buildings_atlas_t> buildings;
+		texture_list_t buildingIcons;
+		bool isMapChanged{ false };
+		std::unique_ptr<MapData> map; // null for a changed chunked map, which is streamed from its file again
+	};
+
+	/** Reloads specification and map files when they change on disk, for tuning the game while it runs.
+	* Changed files are parsed on the file watcher thread into separate atlases, so a frame never waits for
+	* JSON parsing, and a file which doesn't parse is logged and skipped: the game keeps what it has.
+	* The game takes parsed files at a frame boundary and swaps them in itself, see Game::_applyHotReload().
+	*/
+	class HotReload {
+	public:
+		HotReload() {};
+		HotReload(const HotReload&) = delete;
+		~HotReload() { stop(); };
+		/// Starts watching specification files and the map file
+		void start(const std::string& mapFileName);
+		void stop() { _watcher.stop(); };
+		/// Game thread. Moves out everything parsed since last call, returns false if nothing was
+		bool takePending(HotReloadBatch& batch);
+	private:
+		void _reloadMap(const std::string& fileName);
+
+		std::mutex _mutex;
+		HotReloadBatch _pending; // guarded by _mutex
+		bool _hasPending{ false }; // guarded by _mutex
+		FileWatcher _watcher; // last, so its thread stops before the state it writes goes away
+	};
+
+} // namespace Archipelago
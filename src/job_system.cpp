@@ -0,0 +1,155 @@
+#include <chrono>
+#include "job_system.h"
+#include "perf_counters.h"
+#include "profiler.h"
+
+namespace Archipelago {
+
+	const std::chrono::milliseconds workerIdleWakeup{ 10 }; /// idle workers wake up this often, so idle time is reported frame by frame
+
+	namespace {
+		// Queue of current thread, set for worker threads of one job system only
+		thread_local const JobSystem* currentJobSystem{ nullptr };
+		thread_local size_t currentQueueIndex{ 0 };
+	}
+
+}
+
+using namespace Archipelago;
+
+JobSystem::JobSystem(unsigned int workerCount) :
+	_queuedJobs(0),
+	_stopRequested(false) {
+	for (unsigned int i = 0; i <= workerCount; i++) {
+		_queues.push_back(std::make_unique<JobQueue>());
+	}
+	for (unsigned int i = 0; i < workerCount; i++) {
+		_workers.emplace_back(&JobSystem::_workerLoop, this, static_cast<size_t>(i + 1));
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_stopRequested = true;
+	}
+	_wakeUp.notify_all();
+	for (std::thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+JobHandle JobSystem::schedule(std::function<void()> function) {
+	JobHandle job = std::make_shared<Job>();
+	job->_function = std::move(function);
+	_push(job);
+	return job;
+}
+
+JobHandle JobSystem::schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies) {
+	JobHandle job = std::make_shared<Job>();
+	job->_function = std::move(function);
+	// Extra count held while registering, so dependencies finishing meanwhile can't queue the job early
+	job->_pendingDependencies.store(1, std::memory_order_relaxed);
+	for (const JobHandle& dependency : dependencies) {
+		std::lock_guard<std::mutex> lock(dependency->_continuationsMutex);
+		if (!dependency->isDone()) {
+			job->_pendingDependencies.fetch_add(1, std::memory_order_relaxed);
+			dependency->_continuations.push_back(job);
+		}
+	}
+	if (job->_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		_push(job);
+	}
+	return job;
+}
+
+void JobSystem::wait(const JobHandle& job) {
+	size_t queueIndex = _currentQueueIndex();
+	while (!job->isDone()) {
+		if (!_runOne(queueIndex)) {
+			std::this_thread::yield(); // awaited job is running elsewhere or waits for its dependencies
+		}
+	}
+}
+
+void JobSystem::_push(JobHandle job) {
+	JobQueue& queue = *_queues[_currentQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	{
+		std::lock_guard<std::mutex> lock(_sleepMutex);
+		_queuedJobs.fetch_add(1, std::memory_order_relaxed);
+	}
+	_wakeUp.notify_one();
+}
+
+bool JobSystem::_runOne(size_t queueIndex) {
+	JobHandle job;
+	{
+		JobQueue& own = *_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+		}
+	}
+	for (size_t i = 1; !job && i < _queues.size(); i++) {
+		JobQueue& victim = *_queues[(queueIndex + i) % _queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			PerfCounters::instance().add(PerfCounterId::JobsStolen);
+		}
+	}
+	if (!job) return false;
+	_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	_execute(job);
+	return true;
+}
+
+void JobSystem::_execute(const JobHandle& job) {
+	Profiler& profiler = Profiler::instance();
+	int64_t startUs = profiler.now();
+	job->_function();
+	job->_function = nullptr; // release captures now, handle may live much longer
+	int64_t durationUs = profiler.now() - startUs;
+	profiler.record(ProfileZoneId::Job, startUs, durationUs);
+	PerfCounters& counters = PerfCounters::instance();
+	counters.add(PerfCounterId::JobsRun);
+	counters.add(PerfCounterId::JobBusyMicroseconds, static_cast<uint64_t>(durationUs));
+
+	std::vector<JobHandle> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->_continuationsMutex);
+		job->_done.store(true, std::memory_order_release);
+		continuations.swap(job->_continuations);
+	}
+	for (JobHandle& continuation : continuations) {
+		if (continuation->_pendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			_push(std::move(continuation));
+		}
+	}
+}
+
+void JobSystem::_workerLoop(size_t queueIndex) {
+	currentJobSystem = this;
+	currentQueueIndex = queueIndex;
+	Profiler& profiler = Profiler::instance();
+	while (!_stopRequested.load(std::memory_order_relaxed)) {
+		if (_runOne(queueIndex)) continue;
+		int64_t idleStartUs = profiler.now();
+		{
+			std::unique_lock<std::mutex> lock(_sleepMutex);
+			_wakeUp.wait_for(lock, workerIdleWakeup, [this] { return _stopRequested.load(std::memory_order_relaxed) || _queuedJobs.load(std::memory_order_relaxed) > 0; });
+		}
+		PerfCounters::instance().add(PerfCounterId::WorkerIdleMicroseconds, static_cast<uint64_t>(profiler.now() - idleStartUs));
+	}
+}
+
+size_t JobSystem::_currentQueueIndex() const {
+	return currentJobSystem == this ? currentQueueIndex : 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Archipelago {
+
+	class JobSystem;
+
+	/// Scheduled piece of work. Handles are shared: job system, waiters and dependent jobs all hold one
+	class Job {
+	public:
+		bool isDone() const { return _done.load(std::memory_order_acquire); };
+	private:
+		friend class JobSystem;
+		std::function<void()> _function;
+		std::atomic<int> _pendingDependencies{ 0 };
+		std::atomic<bool> _done{ false };
+		std::mutex _continuationsMutex;
+		std::vector<std::shared_ptr<Job>> _continuations; // jobs waiting for this one
+	};
+	typedef std::shared_ptr<Job> JobHandle;
+
+	/** Work-stealing job scheduler.
+	* Every worker thread owns a deque: it pushes and pops its own jobs at the back, newest first,
+	* while idle workers steal from the front of other deques, oldest first. Threads which are not
+	* workers (main thread, loaders) share one extra deque. Waiting is never passive: wait() and
+	* parallelFor() run queued jobs on the calling thread until the awaited work is done, so a job
+	* system without workers still works, single-threaded.
+	* Every job is recorded as ProfileZoneId::Job, busy and idle time of workers go to PerfCounters.
+	*/
+	class JobSystem {
+	public:
+		explicit JobSystem(unsigned int workerCount);
+		JobSystem(const JobSystem&) = delete;
+		~JobSystem();
+		unsigned int getWorkerCount() const { return static_cast<unsigned int>(_workers.size()); };
+		/// Workers plus the calling thread, which helps while waiting
+		unsigned int getThreadCount() const { return getWorkerCount() + 1; };
+		JobHandle schedule(std::function<void()> function);
+		/// Job is queued only after all of its dependencies are done
+		JobHandle schedule(std::function<void()> function, const std::vector<JobHandle>& dependencies);
+		void wait(const JobHandle& job);
+		/// Calls fn(begin, end) for consecutive ranges of at most grain indices and returns when all of them are done
+		template<typename Fn>
+		void parallelFor(size_t count, size_t grain, const Fn& fn) {
+			grain = std::max<size_t>(grain, 1);
+			size_t batches = (count + grain - 1) / grain;
+			if (batches <= 1 || _workers.empty()) {
+				if (count > 0) fn(0, count);
+				return;
+			}
+			std::vector<JobHandle> jobs;
+			jobs.reserve(batches - 1);
+			for (size_t batch = 1; batch < batches; batch++) {
+				jobs.push_back(schedule([&fn, batch, grain, count]() {
+					fn(batch * grain, std::min(count, (batch + 1) * grain));
+				}));
+			}
+			fn(0, grain);
+			for (const JobHandle& job : jobs) {
+				wait(job);
+			}
+		}
+	private:
+		struct JobQueue {
+			std::mutex mutex;
+			std::deque<JobHandle> jobs;
+		};
+		void _push(JobHandle job);
+		bool _runOne(size_t queueIndex);
+		void _execute(const JobHandle& job);
+		void _workerLoop(size_t queueIndex);
+		size_t _currentQueueIndex() const;
+
+		std::vector<std::unique_ptr<JobQueue>> _queues; // [0] is shared by non-worker threads, [i] belongs to worker i-1
+		std::vector<std::thread> _workers;
+		std::atomic<size_t> _queuedJobs;
+		std::atomic<bool> _stopRequested;
+		std::mutex _sleepMutex;
+		std::condition_variable _wakeUp;
+	};
+
+} // namespace Archipelago
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <unordered_map>
+#include "logistics.h"
+#include "perf_counters.h"
+
+namespace Archipelago {
+
+	const uint8_t plainsTileCost{ 2 };
+	const uint8_t roughTileCost{ 3 }; /// hills, forests
+	const uint8_t mountainTileCost{ 6 };
+
+	namespace {
+		bool nameContains(const std::string& name, const char* word) {
+			std::string lower(name);
+			std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			return lower.find(word) != std::string::npos;
+		}
+
+		/// Tile costs of tileset by tileset id
+		std::unordered_map<unsigned int, uint8_t> tilesetCosts(const std::vector<MapTileType>& tileset) {
+			std::unordered_map<unsigned int, uint8_t> costs;
+			for (const MapTileType& tileType : tileset) {
+				costs[tileType.id] = terrainMoveCost(tileType.name);
+			}
+			return costs;
+		}
+
+		size_t pathsComputedCounter() {
+			static const size_t index = PerfCounters::instance().registerCounter("Paths computed");
+			return index;
+		}
+	}
+
+}
+
+using namespace Archipelago;
+
+uint8_t Archipelago::terrainMoveCost(const std::string& tileName) {
+	if (nameContains(tileName, "road")) return roadTileCost;
+	if (nameContains(tileName, "ocean") || nameContains(tileName, "lake") || nameContains(tileName, "water")) return impassableTileCost;
+	if (nameContains(tileName, "mountain")) return mountainTileCost;
+	if (nameContains(tileName, "hill") || nameContains(tileName, "forest")) return roughTileCost;
+	return plainsTileCost;
+}
+
+void Archipelago::buildLogisticsGrid(const MapData& map, LogisticsGrid& grid) {
+	std::unordered_map<unsigned int, uint8_t> costs = tilesetCosts(map.tileset);
+	grid.width = map.mapWidth;
+	grid.height = map.mapHeight;
+	grid.cost.resize(map.terrainLayer.size());
+	for (size_t i = 0; i < map.terrainLayer.size(); i++) {
+		auto it = costs.find(map.terrainLayer[i]);
+		grid.cost[i] = it != costs.end() ? it->second : plainsTileCost;
+	}
+}
+
+bool Archipelago::loadLogisticsGrid(const std::string& mapFileName, LogisticsGrid& grid, std::vector<uint32_t>* resources) {
+	ChunkedMapReader reader;
+	if (!reader.open(mapFileName)) {
+		MapData map;
+		if (!loadMapFile(mapFileName, map)) return false;
+		buildLogisticsGrid(map, grid);
+		if (resources) resources->swap(map.resourcesLayer);
+		return true;
+	}
+	const MapData& header = reader.getHeader();
+	std::unordered_map<unsigned int, uint8_t> costs = tilesetCosts(header.tileset);
+	grid.width = header.mapWidth;
+	grid.height = header.mapHeight;
+	grid.cost.assign(static_cast<size_t>(grid.width) * grid.height, plainsTileCost);
+	if (resources) resources->assign(grid.cost.size(), 0);
+	std::vector<unsigned int> terrain;
+	std::vector<uint32_t> chunkResources;
+	unsigned int chunkSize = reader.getChunkSize();
+	for (size_t chunkIndex = 0; chunkIndex < static_cast<size_t>(reader.getChunksX()) * reader.getChunksY(); chunkIndex++) {
+		if (!reader.readChunk(chunkIndex, terrain, chunkResources)) return false;
+		unsigned int x0 = static_cast<unsigned int>(chunkIndex % reader.getChunksX()) * chunkSize;
+		unsigned int y0 = static_cast<unsigned int>(chunkIndex / reader.getChunksX()) * chunkSize;
+		unsigned int w = std::min(chunkSize, grid.width - x0);
+		for (size_t i = 0; i < terrain.size(); i++) {
+			auto it = costs.find(terrain[i]);
+			size_t tile = static_cast<size_t>(y0 + i / w) * grid.width + x0 + i % w;
+			grid.cost[tile] = it != costs.end() ? it->second : plainsTileCost;
+			if (resources && i < chunkResources.size()) (*resources)[tile] = chunkResources[i];
+		}
+	}
+	return true;
+}
+
+void Logistics::setGrid(LogisticsGrid grid) {
+	_pathfinder.build(std::move(grid));
+	for (size_t building = 0; building < _buildings.size(); building++) {
+		Building& b = _buildings[building];
+		b.tile = _buildingTile(b.x, b.y);
+		_routes[building].tiles.clear(); // tile indices of the old map
+		_markDirty(building, false);
+	}
+}
+
+size_t Logistics::addBuilding(unsigned int x, unsigned int y, bool isStorage, uint32_t owner) {
+	size_t building = _buildings.size();
+	uint32_t tile = _buildingTile(x, y);
+	_buildings.push_back({ x, y, tile, owner, isStorage, false });
+	_routes.push_back({ noRouteStorage, 0, {} });
+	if (isStorage) {
+		_storages.push_back(building);
+		// Only routes longer than the straight way to the new storage can get cheaper
+		for (size_t other = 0; other < building; other++) {
+			const LogisticsRoute& route = _routes[other];
+			if (!_buildings[other].isStorage && _buildings[other].owner == owner && (route.storage == noRouteStorage || _distanceBound(_buildings[other].tile, tile) < route.cost)) {
+				_markDirty(other, false);
+			}
+		}
+	}
+	else {
+		_markDirty(building, true);
+	}
+	return building;
+}
+
+void Logistics::addRoad(unsigned int x, unsigned int y) {
+	const LogisticsGrid& grid = _pathfinder.getGrid();
+	if (!hasGrid() || x >= grid.width || y >= grid.height) return;
+	uint32_t tile = _tileAt(x, y);
+	if (grid.cost[tile] == roadTileCost) return;
+	_pathfinder.setTileCost(x, y, roadTileCost); // roads bridge water too
+	unsigned int viaRoadBound = _storageBound(tile); // over storages of every owner, still a lower bound for each
+	for (size_t building = 0; building < _buildings.size(); building++) {
+		if (_buildings[building].isStorage || _buildings[building].dirty) continue;
+		LogisticsRoute& route = _routes[building];
+		auto onRoute = std::find(route.tiles.begin(), route.tiles.end(), tile);
+		if (onRoute != route.tiles.end()) {
+			// Route got cheaper in place, it may still not be the best one but it stays valid
+			route.cost = 0;
+			for (size_t i = 1; i < route.tiles.size(); i++) {
+				route.cost += std::max(grid.cost[route.tiles[i]], roadTileCost);
+			}
+			_changed.push_back(building);
+		}
+		else if (route.storage == noRouteStorage || _distanceBound(_buildings[building].tile, tile) + viaRoadBound < route.cost) {
+			_markDirty(building, false);
+		}
+	}
+}
+
+size_t Logistics::update(size_t pathBudget) {
+	size_t searches = 0;
+	while (searches < pathBudget && !_dirtyRoutes.empty()) {
+		size_t building = _dirtyRoutes.front();
+		_dirtyRoutes.pop_front();
+		_buildings[building].dirty = false;
+		_findRoute(building, _routes[building]);
+		_changed.push_back(building);
+		++searches;
+	}
+	PerfCounters::instance().add(pathsComputedCounter(), searches);
+	return searches;
+}
+
+unsigned int Logistics::getDeliveryMonths(size_t building) const {
+	if (!hasGrid() || _buildings[building].isStorage) return 0;
+	const LogisticsRoute& route = _routes[building];
+	if (route.storage == noRouteStorage) return noDelivery;
+	return route.cost / logisticsCostPerMonth;
+}
+
+void Logistics::_findRoute(size_t building, LogisticsRoute& route) {
+	route.storage = noRouteStorage;
+	route.cost = 0;
+	route.tiles.clear();
+	if (!hasGrid() || _storages.empty()) return;
+	uint32_t start = _buildings[building].tile;
+	_storageOrder.clear();
+	for (size_t storage : _storages) {
+		if (_buildings[storage].owner != _buildings[building].owner) continue;
+		_storageOrder.push_back({ _distanceBound(start, _buildings[storage].tile), storage });
+	}
+	std::sort(_storageOrder.begin(), _storageOrder.end());
+	unsigned int bestCost = maxRouteCost + 1;
+	for (const auto& storage : _storageOrder) {
+		if (storage.first >= bestCost) break; // no remaining storage can be reached cheaper
+		unsigned int cost = _pathfinder.findPath(start, _buildings[storage.second].tile, bestCost - 1, &_pathTiles);
+		if (cost == noPath) continue;
+		bestCost = cost;
+		route.storage = storage.second;
+		route.cost = cost;
+		route.tiles.swap(_pathTiles);
+	}
+}
+
+void Logistics::_markDirty(size_t building, bool urgent) {
+	if (_buildings[building].dirty) return;
+	_buildings[building].dirty = true;
+	if (urgent) {
+		_dirtyRoutes.push_front(building);
+	}
+	else {
+		_dirtyRoutes.push_back(building);
+	}
+}
+
+uint32_t Logistics::_buildingTile(unsigned int x, unsigned int y) const {
+	if (!hasGrid()) return 0;
+	const LogisticsGrid& grid = _pathfinder.getGrid();
+	return _tileAt(std::min(x, grid.width - 1), std::min(y, grid.height - 1));
+}
+
+unsigned int Logistics::_distanceBound(uint32_t from, uint32_t to) const {
+	unsigned int width = _pathfinder.getGrid().width;
+	int dx = static_cast<int>(from % width) - static_cast<int>(to % width);
+	int dy = static_cast<int>(from / width) - static_cast<int>(to / width);
+	return static_cast<unsigned int>(std::abs(dx) + std::abs(dy)) * roadTileCost;
+}
+
+unsigned int Logistics::_storageBound(uint32_t tile) const {
+	unsigned int bound = ~0u;
+	for (size_t storage : _storages) {
+		bound = std::min(bound, _distanceBound(tile, _buildings[storage].tile));
+	}
+	return bound;
+}
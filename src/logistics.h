@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+#include "economy.h"
+#include "hierarchical_pathfinder.h"
+#include "map_data.h"
+
+namespace Archipelago {
+
+	const unsigned int logisticsCostPerMonth{ 32 }; /// route cost wares travel in one month, e.g. 16 plains tiles or 32 road tiles
+	const unsigned int maxRouteCost{ maxDeliveryMonths * logisticsCostPerMonth - 1 }; /// longer routes are not searched for
+
+	/// Cost of entering a tile of given terrain, by tileset name
+	uint8_t terrainMoveCost(const std::string& tileName);
+	void buildLogisticsGrid(const MapData& map, LogisticsGrid& grid);
+	/** Reads terrain of any map format, chunked maps chunk by chunk so that whole map is never in memory.
+	* Natural resources layer is read too if resources is given.
+	*/
+	bool loadLogisticsGrid(const std::string& mapFileName, LogisticsGrid& grid, std::vector<uint32_t>* resources = nullptr);
+
+	/// Cheapest known way from a building to storage
+	struct LogisticsRoute {
+		size_t storage; // building index, noRouteStorage if storage is out of reach
+		unsigned int cost;
+		std::vector<uint32_t> tiles; // from building to storage, both included
+	};
+	const size_t noRouteStorage{ ~static_cast<size_t>(0) };
+
+	/** Transport of wares from buildings to storages over the map.
+	* Every building keeps a cached route to its nearest storage, whose cost gives delivery time.
+	* Routes are searched on the hierarchical pathfinder, nearest storages first.
+	* Tile costs only ever go down (roads), so cached routes stay valid and only need to be improved:
+	* placing a storage or a road marks only those routes dirty which could get cheaper, judging by
+	* a lower bound of the new way, and dirty routes are repathed a few at a time by update().
+	* Buildings deliver only to storages of their own settlement.
+	* Building indices are in placement order over all settlements.
+	*/
+	class Logistics {
+	public:
+		/// Resets map, every existing route becomes dirty and building tiles are recomputed for the new map width
+		void setGrid(LogisticsGrid grid);
+		bool hasGrid() const { return !_pathfinder.getGrid().cost.empty(); };
+		/// Owner is the settlement id, routes only lead to storages of the same owner
+		size_t addBuilding(unsigned int x, unsigned int y, bool isStorage, uint32_t owner = 0);
+		void addRoad(unsigned int x, unsigned int y);
+		/// Repaths at most pathBudget dirty routes, new buildings first. Returns number of searches
+		size_t update(size_t pathBudget);
+		/// Buildings whose delivery time may have changed since last clearChangedBuildings()
+		const std::vector<size_t>& getChangedBuildings() const { return _changed; };
+		void clearChangedBuildings() { _changed.clear(); };
+		/// 0 for storages and maps without grid, noDelivery if storage is out of reach
+		unsigned int getDeliveryMonths(size_t building) const;
+		const LogisticsRoute& getRoute(size_t building) const { return _routes[building]; };
+		size_t getDirtyRouteCount() const { return _dirtyRoutes.size(); };
+	private:
+		struct Building {
+			unsigned int x;
+			unsigned int y;
+			uint32_t tile; // of x, y clamped to the grid
+			uint32_t owner;
+			bool isStorage;
+			bool dirty;
+		};
+		void _findRoute(size_t building, LogisticsRoute& route);
+		void _markDirty(size_t building, bool urgent);
+		unsigned int _distanceBound(uint32_t from, uint32_t to) const;
+		unsigned int _storageBound(uint32_t tile) const;
+		uint32_t _tileAt(unsigned int x, unsigned int y) const { return y * _pathfinder.getGrid().width + x; };
+		uint32_t _buildingTile(unsigned int x, unsigned int y) const;
+
+		HierarchicalPathfinder _pathfinder;
+		std::vector<Building> _buildings;
+		std::vector<LogisticsRoute> _routes;
+		std::vector<size_t> _storages;
+		std::deque<size_t> _dirtyRoutes;
+		std::vector<size_t> _changed;
+		// search buffers, reused
+		std::vector<std::pair<unsigned int, size_t>> _storageOrder; // (cost lower bound, storage)
+		std::vector<uint32_t> _pathTiles;
+	};
+
+} // namespace Archipelago
@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <cstring>
+#include "lz_codec.h"
+
+namespace Archipelago {
+
+	// Block format constants (identical to LZ4 so existing tools can inspect the data)
+	const size_t lzMinMatch{ 4 };
+	const size_t lzLastLiterals{ 5 }; /// last bytes of input are always literals
+	const size_t lzMatchFindLimit{ 12 }; /// no match may start closer than this to the end
+	const size_t lzMaxOffset{ 65535 };
+	const unsigned int lzHashLog{ 12 };
+
+	namespace {
+		inline uint32_t read32(const unsigned char* p) {
+			uint32_t v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline uint32_t hash32(uint32_t v) {
+			return (v * 2654435761u) >> (32 - lzHashLog);
+		}
+
+		void writeLength(std::vector<char>& dst, size_t length) {
+			while (length >= 255) {
+				dst.push_back(static_cast<char>(255));
+				length -= 255;
+			}
+			dst.push_back(static_cast<char>(length));
+		}
+
+		void emitSequence(std::vector<char>& dst, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength) {
+			size_t matchCode = matchLength - lzMinMatch;
+			unsigned char token = static_cast<unsigned char>(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+			dst.push_back(static_cast<char>(token));
+			if (literalLength >= 15) writeLength(dst, literalLength - 15);
+			dst.insert(dst.end(), literals, literals + literalLength);
+			dst.push_back(static_cast<char>(offset & 0xFF));
+			dst.push_back(static_cast<char>((offset >> 8) & 0xFF));
+			if (matchCode >= 15) writeLength(dst, matchCode - 15);
+		}
+
+		void emitLastLiterals(std::vector<char>& dst, const unsigned char* literals, size_t literalLength) {
+			dst.push_back(static_cast<char>((literalLength < 15 ? literalLength : 15) << 4));
+			if (literalLength >= 15) writeLength(dst, literalLength - 15);
+			dst.insert(dst.end(), literals, literals + literalLength);
+		}
+	}
+
+}
+
+using namespace Archipelago;
+
+void LzCodec::compress(const char* src, size_t srcSize, std::vector<char>& dst) {
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+	dst.clear();
+	dst.reserve(srcSize + srcSize / 255 + 16);
+	if (srcSize < lzMatchFindLimit + 1) {
+		emitLastLiterals(dst, in, srcSize);
+		return;
+	}
+	uint32_t table[1 << lzHashLog] = {};
+	const size_t matchLimit = srcSize - lzLastLiterals;
+	const size_t findLimit = srcSize - lzMatchFindLimit;
+	size_t anchor = 0;
+	size_t ip = 0;
+	while (ip < findLimit) {
+		uint32_t sequence = read32(in + ip);
+		uint32_t h = hash32(sequence);
+		size_t ref = table[h];
+		table[h] = static_cast<uint32_t>(ip);
+		if (ref < ip && ip - ref <= lzMaxOffset && read32(in + ref) == sequence) {
+			size_t matchLength = lzMinMatch;
+			while (ip + matchLength < matchLimit && in[ref + matchLength] == in[ip + matchLength]) {
+				++matchLength;
+			}
+			emitSequence(dst, in + anchor, ip - anchor, ip - ref, matchLength);
+			ip += matchLength;
+			anchor = ip;
+		}
+		else {
+			++ip;
+		}
+	}
+	emitLastLiterals(dst, in + anchor, srcSize - anchor);
+}
+
+bool LzCodec::decompress(const char* src, size_t srcSize, char* dst, size_t dstSize) {
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+	unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+	size_t ip = 0;
+	size_t op = 0;
+	while (ip < srcSize) {
+		unsigned char token = in[ip++];
+		size_t literalLength = token >> 4;
+		if (literalLength == 15) {
+			unsigned char b;
+			do {
+				if (ip >= srcSize) return false;
+				b = in[ip++];
+				literalLength += b;
+			} while (b == 255);
+		}
+		if (literalLength > srcSize - ip || literalLength > dstSize - op) return false;
+		std::memcpy(out + op, in + ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+		if (ip == srcSize) break; // last literals run has no match part
+		if (srcSize - ip < 2) return false;
+		size_t offset = in[ip] | (in[ip + 1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > op) return false;
+		size_t matchLength = token & 0x0F;
+		if (matchLength == 15) {
+			unsigned char b;
+			do {
+				if (ip >= srcSize) return false;
+				b = in[ip++];
+				matchLength += b;
+			} while (b == 255);
+		}
+		matchLength += lzMinMatch;
+		if (matchLength > dstSize - op) return false;
+		// Byte-wise copy, because source and destination overlap for repeating runs
+		const unsigned char* match = out + op - offset;
+		for (size_t i = 0; i < matchLength; i++) {
+			out[op + i] = match[i];
+		}
+		op += matchLength;
+	}
+	return op == dstSize;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Archipelago {
+
+	/** Fast byte-oriented LZ77 codec using the LZ4 block layout.
+	* Decoding is a plain copy loop, so it suits save games and asset caches,
+	* where load speed matters much more than compression ratio.
+	*/
+	namespace LzCodec {
+		void compress(const char* src, size_t srcSize, std::vector<char>& dst);
+		bool decompress(const char* src, size_t srcSize, char* dst, size_t dstSize);
+	}
+
+} // namespace Archipelago
@@ -1,12 +1,103 @@
+#ifdef _WIN32
 #include <windows.h>
+#include <stdlib.h>
+#endif
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include "game.h"
+#include "balance_sweep.h"
+#include "benchmarks.h"
+#include "spec_ids_generator.h"
 
-//int main() {
-INT WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR strCmdLine, INT) {
-	Archipelago::Game game;
+namespace {
+
+	/** Parses command line and runs the game.
+	* --record <file>  record player commands of this session to file
+	* --replay <file>  replay recorded commands headlessly at maximum speed
+	* --benchmark <name>  run named benchmark headlessly
+	* --generate-map <file>  generate procedural map and exit
+	* --generate-spec-ids  regenerate src/spec_ids.h from specification files and exit
+	* --balance-sweep <file>  run building specification variants of the sweep file headlessly and exit
+	* --csv <file>  results of the balance sweep
+	* --map-size <n>, --seed <n>  options of benchmarks, balance sweeps and map generation
+	*/
+	int runGame(int argc, char** argv) {
+		std::string recordFileName;
+		std::string replayFileName;
+		std::string benchmarkName;
+		std::string generatedMapFileName;
+		std::string sweepFileName;
+		std::string csvFileName(Archipelago::balanceSweepDefaultCSVFileName);
+		bool generateIds = false;
+		Archipelago::BenchmarkOptions benchmarkOptions;
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+				recordFileName = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+				replayFileName = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+				benchmarkName = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--generate-map") == 0 && i + 1 < argc) {
+				generatedMapFileName = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--balance-sweep") == 0 && i + 1 < argc) {
+				sweepFileName = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+				csvFileName = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--generate-spec-ids") == 0) {
+				generateIds = true;
+			}
+			else if (std::strcmp(argv[i], "--map-size") == 0 && i + 1 < argc) {
+				benchmarkOptions.mapSize = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+				benchmarkOptions.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+		}
+
+		if (generateIds) {
+			return Archipelago::generateSpecIds(Archipelago::defaultSpecIdsFileName);
+		}
+		if (!generatedMapFileName.empty()) {
+			return Archipelago::generateMapFile(generatedMapFileName, benchmarkOptions);
+		}
+		if (!benchmarkName.empty()) {
+			return Archipelago::runBenchmark(benchmarkName, benchmarkOptions);
+		}
+		if (!sweepFileName.empty()) {
+			return Archipelago::runBalanceSweep(sweepFileName, csvFileName, benchmarkOptions);
+		}
 
-	game.init();
-	game.run();
-	game.shutdown();
-	return 0;
-}
\ No newline at end of file
+		Archipelago::Game game;
+		if (!replayFileName.empty()) {
+			game.initReplay(replayFileName);
+			game.runReplay();
+		}
+		else {
+			game.init();
+			if (!recordFileName.empty()) {
+				game.startRecording(recordFileName);
+			}
+			game.run();
+		}
+		game.shutdown();
+		return 0;
+	}
+
+}
+
+#ifdef _WIN32
+INT WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR strCmdLine, INT) {
+	return runGame(__argc, __argv);
+}
+#else
+int main(int argc, char** argv) {
+	return runGame(argc, argv);
+}
+#endif
@@ -0,0 +1,62 @@
+#include "map_chunk_streamer.h"
+
+using namespace Archipelago;
+
+MapChunkStreamer::MapChunkStreamer(std::unique_ptr<ChunkedMapReader> reader) :
+	_reader(std::move(reader)),
+	_stopRequested(false) {
+	_worker = std::thread(&MapChunkStreamer::_workerLoop, this);
+}
+
+MapChunkStreamer::~MapChunkStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopRequested = true;
+	}
+	_wakeUp.notify_one();
+	_worker.join();
+}
+
+void MapChunkStreamer::request(size_t chunkIndex) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_requests.push_back(chunkIndex);
+	}
+	_wakeUp.notify_one();
+}
+
+void MapChunkStreamer::cancelPending(std::vector<size_t>& cancelled) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	cancelled.assign(_requests.begin(), _requests.end());
+	_requests.clear();
+}
+
+bool MapChunkStreamer::poll(StreamedMapChunk& chunk) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_completed.empty()) return false;
+	chunk = std::move(_completed.front());
+	_completed.pop_front();
+	return true;
+}
+
+void MapChunkStreamer::_workerLoop() {
+	while (true) {
+		size_t chunkIndex;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wakeUp.wait(lock, [this] { return _stopRequested || !_requests.empty(); });
+			if (_stopRequested) {
+				return;
+			}
+			chunkIndex = _requests.back();
+			_requests.pop_back();
+		}
+		StreamedMapChunk chunk;
+		chunk.chunkIndex = chunkIndex;
+		chunk.loaded = _reader->readChunk(chunkIndex, chunk.terrain, chunk.resources);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_completed.push_back(std::move(chunk));
+		}
+	}
+}
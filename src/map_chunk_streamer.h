@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "map_data.h"
+
+namespace Archipelago {
+
+	/// Layers of one chunk read from disk, row-major within the chunk
+	struct StreamedMapChunk {
+		size_t chunkIndex;
+		bool loaded; // false if chunk could not be read
+		std::vector<unsigned int> terrain;
+		std::vector<uint32_t> resources;
+	};
+
+	/** Pages chunks of a chunked map file in on a background thread.
+	* Main thread requests chunks and polls for completed ones once per frame, so it never
+	* waits for disk. Pending requests are served newest first: chunks requested for the
+	* current camera position come before leftovers of a view the camera has already left.
+	*/
+	class MapChunkStreamer {
+	public:
+		explicit MapChunkStreamer(std::unique_ptr<ChunkedMapReader> reader);
+		MapChunkStreamer(const MapChunkStreamer&) = delete;
+		~MapChunkStreamer();
+		const ChunkedMapReader& getReader() const { return *_reader; };
+		void request(size_t chunkIndex);
+		/// Drops requests worker has not started yet, returns their chunk indices
+		void cancelPending(std::vector<size_t>& cancelled);
+		/// Takes one completed chunk, returns false if there is none
+		bool poll(StreamedMapChunk& chunk);
+	private:
+		void _workerLoop();
+
+		std::unique_ptr<ChunkedMapReader> _reader; // chunks are read on worker thread only
+		std::thread _worker;
+		std::mutex _mutex;
+		std::condition_variable _wakeUp;
+		std::deque<size_t> _requests;
+		std::deque<StreamedMapChunk> _completed;
+		bool _stopRequested;
+	};
+
+} // namespace Archipelago
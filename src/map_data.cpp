@@ -0,0 +1,385 @@
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <json.hpp>
+#include "map_data.h"
+#include "binary_stream.h"
+#include "file_utils.h"
+#include "lz_codec.h"
+#include "map_generator.h"
+
+namespace Archipelago {
+
+	extern const std::string& loggerName;
+
+	const uint32_t binaryMapMagic{ 0x50414D41 }; // "AMAP"
+	const uint32_t binaryMapVersion{ 1 };
+	const std::string& binaryMapExtension{ ".amap" };
+	const uint32_t chunkedMapMagic{ 0x48434D41 }; // "AMCH"
+	const uint32_t chunkedMapVersion{ 1 };
+	const std::string& chunkedMapExtension{ ".amapc" };
+	// Sizes read from map files are checked against these before anything is allocated, so a corrupt file fails to load
+	const uint32_t maxMapHeaderSize{ 1024 * 1024 }; /// bytes of map header, i.e. mostly tileset
+	const uint64_t maxMapPayloadSize{ static_cast<uint64_t>(maxGeneratedMapSize) * maxGeneratedMapSize * (sizeof(uint16_t) + sizeof(uint32_t)) + maxMapHeaderSize };
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	bool hasExtension(const std::string& fileName, const std::string& extension) {
+		return fileName.size() >= extension.size() &&
+			fileName.compare(fileName.size() - extension.size(), extension.size(), extension) == 0;
+	}
+
+	void writeMapHeader(BinaryWriter& writer, const MapData& map) {
+		writer.write<uint32_t>(map.mapWidth);
+		writer.write<uint32_t>(map.mapHeight);
+		writer.write<uint32_t>(map.tileWidth);
+		writer.write<uint32_t>(map.tileHeight);
+		writer.write<uint32_t>(static_cast<uint32_t>(map.tileset.size()));
+		for (const MapTileType& tileType : map.tileset) {
+			writer.write<uint32_t>(tileType.id);
+			writer.writeString(tileType.name);
+			writer.writeString(tileType.texFileName);
+			writer.write<uint32_t>(tileType.rising);
+			writer.write<uint32_t>(tileType.texOffsetX);
+		}
+	}
+
+	bool readMapHeader(BinaryReader& reader, MapData& map) {
+		uint32_t count;
+		if (!reader.read(map.mapWidth) || !reader.read(map.mapHeight) || !reader.read(map.tileWidth) || !reader.read(map.tileHeight)) return false;
+		if (!reader.read(count)) return false;
+		map.tileset.clear();
+		for (uint32_t i = 0; i < count; i++) {
+			MapTileType tileType;
+			if (!reader.read(tileType.id) || !reader.readString(tileType.name) || !reader.readString(tileType.texFileName) ||
+				!reader.read(tileType.rising) || !reader.read(tileType.texOffsetX)) {
+				return false;
+			}
+			map.tileset.push_back(tileType);
+		}
+		return true;
+	}
+
+	bool isChunkedMap(const char* data, size_t size) {
+		uint32_t magic;
+		BinaryReader file(data, size);
+		return file.read(magic) && magic == chunkedMapMagic;
+	}
+
+}
+
+bool Archipelago::loadMapFile(const std::string& fileName, MapData& map) {
+	std::vector<char> data;
+	if (!FileUtils::readFile(fileName, data)) {
+		spdlog::get(loggerName)->error("Error opening map file '{}'", fileName);
+		return false;
+	}
+	if (isChunkedMap(data.data(), data.size())) {
+		data.clear();
+		ChunkedMapReader reader;
+		if (!reader.open(fileName) || !reader.readAll(map)) {
+			spdlog::get(loggerName)->error("Chunked map file '{}' is truncated or corrupted", fileName);
+			return false;
+		}
+		return true;
+	}
+	if (isBinaryMap(data.data(), data.size())) {
+		if (!readMapBinary(data.data(), data.size(), map)) {
+			spdlog::get(loggerName)->error("Binary map file '{}' is truncated or corrupted", fileName);
+			return false;
+		}
+		return true;
+	}
+	return parseMapJSON(data.data(), data.size(), map);
+}
+
+bool Archipelago::saveMapFile(const MapData& map, const std::string& fileName) {
+	if (hasExtension(fileName, chunkedMapExtension)) {
+		std::vector<char> fileImage;
+		writeChunkedMap(map, defaultMapChunkSize, fileImage);
+		return FileUtils::writeFileAtomically(fileName, fileImage.data(), fileImage.size());
+	}
+	if (hasExtension(fileName, binaryMapExtension)) {
+		std::vector<char> fileImage;
+		writeMapBinary(map, fileImage);
+		return FileUtils::writeFileAtomically(fileName, fileImage.data(), fileImage.size());
+	}
+	std::string json;
+	writeMapJSON(map, json);
+	return FileUtils::writeFileAtomically(fileName, json.data(), json.size());
+}
+
+bool Archipelago::parseMapJSON(const char* data, size_t size, MapData& map) {
+	auto logger = spdlog::get(loggerName);
+	nlohmann::json mapJSON;
+	try {
+		mapJSON = nlohmann::json::parse(data, data + size);
+	}
+	catch (const std::exception& e) {
+		logger->error("Can't parse map JSON: {}", e.what());
+		return false;
+	}
+
+	try {
+		map.mapWidth = mapJSON.at("mapWidth");
+		map.mapHeight = mapJSON.at("mapHeight");
+		map.tileWidth = mapJSON.at("tileWidth");
+		map.tileHeight = mapJSON.at("tileHeight");
+		map.terrainLayer = mapJSON.at("terrain_layer").get<std::vector<unsigned int>>();
+		map.tileset.clear();
+		for (const nlohmann::json& tileJSON : mapJSON.at("tileset")) {
+			MapTileType tileType;
+			tileType.id = tileJSON.at("id");
+			tileType.name = tileJSON.at("tileName").get<std::string>();
+			tileType.texFileName = tileJSON.at("texFileName").get<std::string>();
+			tileType.rising = tileJSON.find("tileRising") != tileJSON.end() ? tileJSON.at("tileRising").get<unsigned int>() : 0;
+			tileType.texOffsetX = tileJSON.find("texOffsetX") != tileJSON.end() ? tileJSON.at("texOffsetX").get<unsigned int>() : 0;
+			map.tileset.push_back(tileType);
+		}
+	}
+	catch (const std::out_of_range& e) {
+		logger->error("Can't parse map JSON: {}", e.what());
+		return false;
+	}
+	size_t mapSize = static_cast<size_t>(map.mapWidth) * map.mapHeight;
+	if (map.terrainLayer.size() != mapSize) {
+		logger->error("terrain_layer size ({}) is not equal to width*height ({}). There is something wrong in map file.", map.terrainLayer.size(), mapSize);
+		return false;
+	}
+	if (mapJSON.find("resources_layer") != mapJSON.end()) {
+		map.resourcesLayer = mapJSON.at("resources_layer").get<std::vector<uint32_t>>();
+	}
+	if (map.resourcesLayer.size() != mapSize) {
+		logger->trace("Map has no resources_layer of width*height size, tiles will have no natural resources");
+		map.resourcesLayer.assign(mapSize, 0);
+	}
+	return true;
+}
+
+void Archipelago::writeMapJSON(const MapData& map, std::string& out) {
+	out.clear();
+	// Roughly 3 chars per terrain entry and 4 per resources entry
+	out.reserve(static_cast<size_t>(map.mapWidth) * map.mapHeight * 7 + 4096);
+	out += "{\n";
+	out += "\t\"mapWidth\": " + std::to_string(map.mapWidth) + ",\n";
+	out += "\t\"mapHeight\": " + std::to_string(map.mapHeight) + ",\n";
+	out += "\t\"tileWidth\": " + std::to_string(map.tileWidth) + ",\n";
+	out += "\t\"tileHeight\": " + std::to_string(map.tileHeight) + ",\n";
+	out += "\t\"tileset\": [\n";
+	for (size_t i = 0; i < map.tileset.size(); i++) {
+		const MapTileType& tileType = map.tileset[i];
+		out += "\t\t{ \"id\": " + std::to_string(tileType.id);
+		out += ", \"tileName\": " + nlohmann::json(tileType.name).dump();
+		out += ", \"texFileName\": " + nlohmann::json(tileType.texFileName).dump();
+		out += ", \"tileRising\": " + std::to_string(tileType.rising);
+		if (tileType.texOffsetX) {
+			out += ", \"texOffsetX\": " + std::to_string(tileType.texOffsetX);
+		}
+		out += i + 1 < map.tileset.size() ? " },\n" : " }\n";
+	}
+	out += "\t],\n";
+	auto writeLayer = [&](const char* name, auto& layer, bool last) {
+		out += "\t\"";
+		out += name;
+		out += "\": [\n";
+		size_t index = 0;
+		for (unsigned int y = 0; y < map.mapHeight; y++) {
+			out += "\t\t";
+			for (unsigned int x = 0; x < map.mapWidth; x++, index++) {
+				out += std::to_string(layer[index]);
+				if (index + 1 < layer.size()) {
+					out += x + 1 < map.mapWidth ? ", " : ",";
+				}
+			}
+			out += "\n";
+		}
+		out += last ? "\t]\n" : "\t],\n";
+	};
+	writeLayer("terrain_layer", map.terrainLayer, false);
+	writeLayer("resources_layer", map.resourcesLayer, true);
+	out += "}\n";
+}
+
+void Archipelago::writeMapBinary(const MapData& map, std::vector<char>& fileImage) {
+	size_t mapSize = static_cast<size_t>(map.mapWidth) * map.mapHeight;
+	std::vector<char> payloadBuffer;
+	payloadBuffer.reserve(mapSize * (sizeof(uint16_t) + sizeof(uint32_t)) + 4096);
+	BinaryWriter payload(payloadBuffer);
+	writeMapHeader(payload, map);
+	// Layers are stored as planes rather than interleaved per tile, which compresses better
+	for (size_t i = 0; i < mapSize; i++) {
+		payload.write<uint16_t>(static_cast<uint16_t>(map.terrainLayer[i]));
+	}
+	payload.writeBytes(map.resourcesLayer.data(), mapSize * sizeof(uint32_t));
+
+	std::vector<char> compressed;
+	LzCodec::compress(payloadBuffer.data(), payloadBuffer.size(), compressed);
+	fileImage.clear();
+	BinaryWriter file(fileImage);
+	file.write<uint32_t>(binaryMapMagic);
+	file.write<uint32_t>(binaryMapVersion);
+	file.write<uint64_t>(payloadBuffer.size());
+	file.writeBytes(compressed.data(), compressed.size());
+}
+
+bool Archipelago::isBinaryMap(const char* data, size_t size) {
+	uint32_t magic;
+	BinaryReader file(data, size);
+	return file.read(magic) && magic == binaryMapMagic;
+}
+
+bool Archipelago::readMapBinary(const char* data, size_t size, MapData& map) {
+	BinaryReader file(data, size);
+	uint32_t magic, version;
+	uint64_t payloadSize;
+	if (!file.read(magic) || magic != binaryMapMagic) return false;
+	if (!file.read(version) || version != binaryMapVersion) return false;
+	if (!file.read(payloadSize) || payloadSize > maxMapPayloadSize) return false;
+	std::vector<char> payloadBuffer(static_cast<size_t>(payloadSize));
+	if (!LzCodec::decompress(file.current(), file.remaining(), payloadBuffer.data(), payloadBuffer.size())) return false;
+
+	BinaryReader payload(payloadBuffer.data(), payloadBuffer.size());
+	if (!readMapHeader(payload, map)) return false;
+	size_t mapSize = static_cast<size_t>(map.mapWidth) * map.mapHeight;
+	if (payload.remaining() != mapSize * (sizeof(uint16_t) + sizeof(uint32_t))) return false;
+	map.terrainLayer.resize(mapSize);
+	const char* terrain = payload.current();
+	for (size_t i = 0; i < mapSize; i++) {
+		uint16_t id;
+		std::memcpy(&id, terrain + i * sizeof(uint16_t), sizeof(uint16_t));
+		map.terrainLayer[i] = id;
+	}
+	BinaryReader resources(terrain + mapSize * sizeof(uint16_t), mapSize * sizeof(uint32_t));
+	map.resourcesLayer.resize(mapSize);
+	return resources.readBytes(map.resourcesLayer.data(), mapSize * sizeof(uint32_t));
+}
+
+void Archipelago::writeChunkedMap(const MapData& map, unsigned int chunkSize, std::vector<char>& fileImage) {
+	chunkSize = std::max(chunkSize, 1u);
+	unsigned int chunksX = (map.mapWidth + chunkSize - 1) / chunkSize;
+	unsigned int chunksY = (map.mapHeight + chunkSize - 1) / chunkSize;
+	std::vector<char> header;
+	BinaryWriter headerWriter(header);
+	writeMapHeader(headerWriter, map);
+	headerWriter.write<uint32_t>(chunkSize);
+
+	// Compress chunks first, offsets in the index depend on their sizes
+	std::vector<char> blocks;
+	std::vector<uint64_t> offsets;
+	std::vector<uint32_t> sizes;
+	std::vector<char> payloadBuffer;
+	std::vector<char> compressed;
+	for (unsigned int cy = 0; cy < chunksY; cy++) {
+		for (unsigned int cx = 0; cx < chunksX; cx++) {
+			unsigned int x0 = cx * chunkSize, y0 = cy * chunkSize;
+			unsigned int w = std::min(chunkSize, map.mapWidth - x0), h = std::min(chunkSize, map.mapHeight - y0);
+			payloadBuffer.clear();
+			BinaryWriter payload(payloadBuffer);
+			for (unsigned int y = y0; y < y0 + h; y++) {
+				for (unsigned int x = x0; x < x0 + w; x++) {
+					payload.write<uint16_t>(static_cast<uint16_t>(map.terrainLayer[static_cast<size_t>(y) * map.mapWidth + x]));
+				}
+			}
+			for (unsigned int y = y0; y < y0 + h; y++) {
+				payload.writeBytes(&map.resourcesLayer[static_cast<size_t>(y) * map.mapWidth + x0], w * sizeof(uint32_t));
+			}
+			compressed.clear();
+			LzCodec::compress(payloadBuffer.data(), payloadBuffer.size(), compressed);
+			offsets.push_back(blocks.size());
+			sizes.push_back(static_cast<uint32_t>(compressed.size()));
+			blocks.insert(blocks.end(), compressed.begin(), compressed.end());
+		}
+	}
+
+	fileImage.clear();
+	BinaryWriter file(fileImage);
+	file.write<uint32_t>(chunkedMapMagic);
+	file.write<uint32_t>(chunkedMapVersion);
+	file.write<uint32_t>(static_cast<uint32_t>(header.size()));
+	file.writeBytes(header.data(), header.size());
+	file.write<uint32_t>(static_cast<uint32_t>(offsets.size()));
+	uint64_t blocksStart = file.size() + offsets.size() * (sizeof(uint64_t) + sizeof(uint32_t));
+	for (size_t i = 0; i < offsets.size(); i++) {
+		file.write<uint64_t>(blocksStart + offsets[i]);
+		file.write<uint32_t>(sizes[i]);
+	}
+	file.writeBytes(blocks.data(), blocks.size());
+}
+
+bool ChunkedMapReader::open(const std::string& fileName) {
+	_file.open(fileName, std::ios::binary);
+	if (_file.fail()) return false;
+	uint32_t prologue[3]; // magic, version, header size
+	if (!_file.read(reinterpret_cast<char*>(prologue), sizeof(prologue))) return false;
+	if (prologue[0] != chunkedMapMagic || prologue[1] != chunkedMapVersion || prologue[2] > maxMapHeaderSize) return false;
+	std::vector<char> header(prologue[2]);
+	if (!_file.read(header.data(), header.size())) return false;
+	BinaryReader headerReader(header.data(), header.size());
+	if (!readMapHeader(headerReader, _header) || !headerReader.read(_chunkSize) || _chunkSize == 0) return false;
+	if (_header.mapWidth > maxGeneratedMapSize || _header.mapHeight > maxGeneratedMapSize || _chunkSize > maxGeneratedMapSize) return false;
+	_chunksX = (_header.mapWidth + _chunkSize - 1) / _chunkSize;
+	_chunksY = (_header.mapHeight + _chunkSize - 1) / _chunkSize;
+
+	uint32_t chunkCount;
+	if (!_file.read(reinterpret_cast<char*>(&chunkCount), sizeof(chunkCount))) return false;
+	if (chunkCount != static_cast<size_t>(_chunksX) * _chunksY) return false;
+	std::vector<char> index(chunkCount * (sizeof(uint64_t) + sizeof(uint32_t)));
+	if (!_file.read(index.data(), index.size())) return false;
+	BinaryReader indexReader(index.data(), index.size());
+	_index.resize(chunkCount);
+	for (ChunkEntry& entry : _index) {
+		indexReader.read(entry.offset);
+		indexReader.read(entry.compressedSize);
+		if (entry.compressedSize > maxMapPayloadSize) return false;
+	}
+	return true;
+}
+
+bool ChunkedMapReader::readChunk(size_t chunkIndex, std::vector<unsigned int>& terrain, std::vector<uint32_t>& resources) {
+	if (chunkIndex >= _index.size()) return false;
+	unsigned int cx = static_cast<unsigned int>(chunkIndex % _chunksX), cy = static_cast<unsigned int>(chunkIndex / _chunksX);
+	size_t w = std::min(_chunkSize, _header.mapWidth - cx * _chunkSize);
+	size_t h = std::min(_chunkSize, _header.mapHeight - cy * _chunkSize);
+	size_t tiles = w * h;
+	const ChunkEntry& entry = _index[chunkIndex];
+	_compressed.resize(entry.compressedSize);
+	_payload.resize(tiles * (sizeof(uint16_t) + sizeof(uint32_t)));
+	_file.clear();
+	_file.seekg(static_cast<std::streamoff>(entry.offset));
+	if (!_file.read(_compressed.data(), _compressed.size())) return false;
+	if (!LzCodec::decompress(_compressed.data(), _compressed.size(), _payload.data(), _payload.size())) return false;
+	terrain.resize(tiles);
+	for (size_t i = 0; i < tiles; i++) {
+		uint16_t id;
+		std::memcpy(&id, _payload.data() + i * sizeof(uint16_t), sizeof(uint16_t));
+		terrain[i] = id;
+	}
+	resources.resize(tiles);
+	std::memcpy(resources.data(), _payload.data() + tiles * sizeof(uint16_t), tiles * sizeof(uint32_t));
+	return true;
+}
+
+bool ChunkedMapReader::readAll(MapData& map) {
+	MapData header = _header;
+	map = std::move(header);
+	size_t mapSize = static_cast<size_t>(map.mapWidth) * map.mapHeight;
+	map.terrainLayer.resize(mapSize);
+	map.resourcesLayer.resize(mapSize);
+	std::vector<unsigned int> terrain;
+	std::vector<uint32_t> resources;
+	for (size_t chunkIndex = 0; chunkIndex < _index.size(); chunkIndex++) {
+		if (!readChunk(chunkIndex, terrain, resources)) return false;
+		unsigned int x0 = static_cast<unsigned int>(chunkIndex % _chunksX) * _chunkSize;
+		unsigned int y0 = static_cast<unsigned int>(chunkIndex / _chunksX) * _chunkSize;
+		unsigned int w = std::min(_chunkSize, map.mapWidth - x0);
+		for (size_t i = 0; i < terrain.size(); i++) {
+			size_t mapIndex = static_cast<size_t>(y0 + i / w) * map.mapWidth + x0 + i % w;
+			map.terrainLayer[mapIndex] = terrain[i];
+			map.resourcesLayer[mapIndex] = resources[i];
+		}
+	}
+	return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Archipelago {
+
+	/// Tileset entry of the map, i.e. one kind of terrain
+	struct MapTileType {
+		unsigned int id;
+		std::string name;
+		std::string texFileName;
+		unsigned int rising;
+		unsigned int texOffsetX;
+	};
+
+	/** Contents of a map file, independent of its on-disk format.
+	* Layers are row-major, mapWidth * mapHeight entries each.
+	* Every byte of a resources layer entry is a NaturalResourceTypeId available on the tile,
+	* so one tile may carry up to four kinds of natural resources.
+	*/
+	struct MapData {
+		unsigned int mapWidth{ 0 };
+		unsigned int mapHeight{ 0 };
+		unsigned int tileWidth{ 0 };
+		unsigned int tileHeight{ 0 };
+		std::vector<MapTileType> tileset;
+		std::vector<unsigned int> terrainLayer;
+		std::vector<uint32_t> resourcesLayer;
+	};
+
+	/// Loads map file of either format, binary maps are recognized by their header
+	bool loadMapFile(const std::string& fileName, MapData& map);
+	/// Saves map in chunked format if file name ends with ".amapc", binary if ".amap" and JSON otherwise
+	bool saveMapFile(const MapData& map, const std::string& fileName);
+
+	bool parseMapJSON(const char* data, size_t size, MapData& map);
+	/// Writes JSON map in the same layout as hand-made maps in assets/maps, one map row per line
+	void writeMapJSON(const MapData& map, std::string& out);
+	/// Binary map: header + LZ compressed payload. Loads much faster than JSON, meant for large maps
+	void writeMapBinary(const MapData& map, std::vector<char>& fileImage);
+	bool readMapBinary(const char* data, size_t size, MapData& map);
+	bool isBinaryMap(const char* data, size_t size);
+
+	const unsigned int defaultMapChunkSize{ 32 }; /// tiles per chunk side
+
+	/** Chunked map: header, chunk index and separately compressed square chunks.
+	* Chunks are row-major, both in the file and in the index; edge chunks may be smaller than chunkSize.
+	*/
+	void writeChunkedMap(const MapData& map, unsigned int chunkSize, std::vector<char>& fileImage);
+
+	/** Random access reader of chunked map files.
+	* Only header and chunk index are kept in memory, so maps can be streamed whatever their size.
+	* Not thread safe: one reader is meant to be owned by one loader thread.
+	*/
+	class ChunkedMapReader {
+	public:
+		bool open(const std::string& fileName);
+		/// Map dimensions and tileset, layers are empty
+		const MapData& getHeader() const { return _header; };
+		unsigned int getChunkSize() const { return _chunkSize; };
+		unsigned int getChunksX() const { return _chunksX; };
+		unsigned int getChunksY() const { return _chunksY; };
+		/// Reads chunk layers, row-major within the chunk
+		bool readChunk(size_t chunkIndex, std::vector<unsigned int>& terrain, std::vector<uint32_t>& resources);
+		/// Reads every chunk into full map layers
+		bool readAll(MapData& map);
+	private:
+		struct ChunkEntry {
+			uint64_t offset;
+			uint32_t compressedSize;
+		};
+		std::ifstream _file;
+		MapData _header;
+		unsigned int _chunkSize{ 0 };
+		unsigned int _chunksX{ 0 };
+		unsigned int _chunksY{ 0 };
+		std::vector<ChunkEntry> _index;
+		std::vector<char> _compressed;
+		std::vector<char> _payload;
+	};
+
+} // namespace Archipelago
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cmath>
+#include "map_generator.h"
+#include "natural_resources_specification.h"
+
+namespace Archipelago {
+
+	/// Tile IDs of the default map tileset
+	enum class GeneratedTileId : unsigned int { Plains = 0, Hills, Forest, Mountains, Lake, Ocean };
+
+	const unsigned int generatedTileWidth{ 95 };
+	const unsigned int generatedTileHeight{ 48 };
+	const float elevationPeriod{ 96.0f }; /// tiles, roughly the size of an island
+	const float moisturePeriod{ 48.0f }; /// tiles
+	const float lakePeriod{ 20.0f }; /// tiles
+	const float forestNearHillsBand{ 0.08f }; /// elevation range below hill level where forests are more likely
+	const float forestNearHillsBonus{ 0.15f };
+	const float lakeMinHeightAboveSea{ 0.03f }; /// keeps lakes from merging into the ocean
+	const unsigned int coastFalloffWidth{ 24 }; /// tiles, map borders sink into the ocean
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	uint32_t hashCoords(int32_t x, int32_t y, uint32_t seed) {
+		uint32_t h = seed * 0x9E3779B9u ^ static_cast<uint32_t>(x) * 0x85EBCA6Bu ^ static_cast<uint32_t>(y) * 0xC2B2AE35u;
+		h ^= h >> 16;
+		h *= 0x7FEB352Du;
+		h ^= h >> 15;
+		h *= 0x846CA68Bu;
+		h ^= h >> 16;
+		return h;
+	}
+
+	float latticeValue(int32_t x, int32_t y, uint32_t seed) {
+		return (hashCoords(x, y, seed) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/// Smoothly interpolated value noise in [0, 1)
+	float valueNoise(float x, float y, uint32_t seed) {
+		float fx = std::floor(x);
+		float fy = std::floor(y);
+		int32_t x0 = static_cast<int32_t>(fx);
+		int32_t y0 = static_cast<int32_t>(fy);
+		float tx = x - fx;
+		float ty = y - fy;
+		tx = tx * tx * (3.0f - 2.0f * tx);
+		ty = ty * ty * (3.0f - 2.0f * ty);
+		float top = latticeValue(x0, y0, seed) + (latticeValue(x0 + 1, y0, seed) - latticeValue(x0, y0, seed)) * tx;
+		float bottom = latticeValue(x0, y0 + 1, seed) + (latticeValue(x0 + 1, y0 + 1, seed) - latticeValue(x0, y0 + 1, seed)) * tx;
+		return top + (bottom - top) * ty;
+	}
+
+	/// Sum of octaves of value noise, normalized back to [0, 1)
+	float fractalNoise(float x, float y, uint32_t seed, unsigned int octaves, float period) {
+		float sum = 0.0f;
+		float amplitude = 1.0f;
+		float amplitudeSum = 0.0f;
+		float frequency = 1.0f / period;
+		for (unsigned int octave = 0; octave < octaves; octave++) {
+			sum += valueNoise(x * frequency, y * frequency, seed + octave * 0x68E31DA4u) * amplitude;
+			amplitudeSum += amplitude;
+			amplitude *= 0.5f;
+			frequency *= 2.0f;
+		}
+		return sum / amplitudeSum;
+	}
+
+	float clamp01(float value) {
+		return std::min(1.0f, std::max(0.0f, value));
+	}
+
+	unsigned int tileId(GeneratedTileId id) {
+		return static_cast<unsigned int>(id);
+	}
+
+	uint32_t natresByte(NaturalResourceTypeId id, unsigned int slot) {
+		return static_cast<uint32_t>(id) << (slot * 8);
+	}
+
+}
+
+void Archipelago::generateMap(const MapGeneratorSettings& settings, MapData& map) {
+	map.mapWidth = std::min(std::max(settings.mapWidth, 1u), maxGeneratedMapSize);
+	map.mapHeight = std::min(std::max(settings.mapHeight, 1u), maxGeneratedMapSize);
+	map.tileWidth = generatedTileWidth;
+	map.tileHeight = generatedTileHeight;
+	map.tileset = {
+		{ tileId(GeneratedTileId::Plains), "Plains", "assets/textures/default_map/plains.png", 0, 0 },
+		{ tileId(GeneratedTileId::Hills), "Hills", "assets/textures/default_map/hills.png", 9, 0 },
+		{ tileId(GeneratedTileId::Forest), "Forest", "assets/textures/default_map/forest.png", 8, 0 },
+		{ tileId(GeneratedTileId::Mountains), "Mountains", "assets/textures/default_map/mountains.png", 9, 0 },
+		{ tileId(GeneratedTileId::Lake), "Lake", "assets/textures/default_map/lake.png", 0, 0 },
+		{ tileId(GeneratedTileId::Ocean), "Ocean", "assets/textures/default_map/ocean.png", 0, 0 }
+	};
+	const unsigned int width = map.mapWidth;
+	const unsigned int height = map.mapHeight;
+	const size_t mapSize = static_cast<size_t>(width) * height;
+	const uint32_t elevationSeed = hashCoords(1, 0, settings.seed);
+	const uint32_t moistureSeed = hashCoords(2, 0, settings.seed);
+	const uint32_t lakeSeed = hashCoords(3, 0, settings.seed);
+	const float falloffWidth = static_cast<float>(std::max(1u, std::min(coastFalloffWidth, std::min(width, height) / 4)));
+
+	// Terrain: elevation decides ocean, plains, hills and mountains. Forests grow where it is wet
+	// and more readily on the slopes just below the hills; lakes fill inland hollows of a separate noise field.
+	map.terrainLayer.resize(mapSize);
+	for (unsigned int y = 0; y < height; y++) {
+		for (unsigned int x = 0; x < width; x++) {
+			float fx = static_cast<float>(x);
+			float fy = static_cast<float>(y);
+			float edgeDistance = static_cast<float>(std::min(std::min(x, width - 1 - x), std::min(y, height - 1 - y)));
+			float falloff = clamp01(edgeDistance / falloffWidth);
+			float elevation = fractalNoise(fx, fy, elevationSeed, 5, elevationPeriod) * (falloff * (2.0f - falloff));
+			GeneratedTileId tile;
+			if (elevation < settings.seaLevel) {
+				tile = GeneratedTileId::Ocean;
+			}
+			else if (elevation >= settings.mountainLevel) {
+				tile = GeneratedTileId::Mountains;
+			}
+			else if (elevation >= settings.hillLevel) {
+				tile = GeneratedTileId::Hills;
+			}
+			else if (elevation >= settings.seaLevel + lakeMinHeightAboveSea && fractalNoise(fx, fy, lakeSeed, 3, lakePeriod) < settings.lakeLevel) {
+				tile = GeneratedTileId::Lake;
+			}
+			else {
+				float nearHills = clamp01((elevation - (settings.hillLevel - forestNearHillsBand)) / forestNearHillsBand);
+				float moisture = fractalNoise(fx, fy, moistureSeed, 4, moisturePeriod);
+				tile = moisture + nearHills * forestNearHillsBonus >= settings.forestLevel ? GeneratedTileId::Forest : GeneratedTileId::Plains;
+			}
+			map.terrainLayer[static_cast<size_t>(y) * width + x] = tileId(tile);
+		}
+	}
+
+	// Natural resources, one per byte. Land next to a lake gets fresh water as a second resource
+	map.resourcesLayer.assign(mapSize, 0);
+	auto isLake = [&](unsigned int x, unsigned int y) {
+		return map.terrainLayer[static_cast<size_t>(y) * width + x] == tileId(GeneratedTileId::Lake);
+	};
+	for (unsigned int y = 0; y < height; y++) {
+		for (unsigned int x = 0; x < width; x++) {
+			size_t index = static_cast<size_t>(y) * width + x;
+			uint32_t& resources = map.resourcesLayer[index];
+			switch (static_cast<GeneratedTileId>(map.terrainLayer[index])) {
+			case GeneratedTileId::Plains:
+				resources = natresByte(NaturalResourceTypeId::FertileSoil, 0);
+				break;
+			case GeneratedTileId::Forest:
+				resources = natresByte(NaturalResourceTypeId::Forest, 0);
+				break;
+			case GeneratedTileId::Lake:
+				resources = natresByte(NaturalResourceTypeId::FreshWater, 0);
+				continue;
+			case GeneratedTileId::Ocean:
+				resources = natresByte(NaturalResourceTypeId::SaltWater, 0);
+				continue;
+			default:
+				break;
+			}
+			bool lakeShore = (x > 0 && isLake(x - 1, y)) || (x + 1 < width && isLake(x + 1, y)) ||
+				(y > 0 && isLake(x, y - 1)) || (y + 1 < height && isLake(x, y + 1));
+			if (lakeShore) {
+				resources |= natresByte(NaturalResourceTypeId::FreshWater, resources ? 1 : 0);
+			}
+		}
+	}
+}
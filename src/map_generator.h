@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include "map_data.h"
+
+namespace Archipelago {
+
+	const unsigned int maxGeneratedMapSize{ 4096 }; /// tiles per side
+
+	/** Parameters of procedural map generation.
+	* Levels are thresholds on noise values in [0, 1]; features keep their size in tiles
+	* whatever the map size is, so large maps get more islands rather than bigger ones.
+	*/
+	struct MapGeneratorSettings {
+		unsigned int mapWidth{ 256 };
+		unsigned int mapHeight{ 256 };
+		uint32_t seed{ 1 };
+		float seaLevel{ 0.45f };
+		float hillLevel{ 0.62f };
+		float mountainLevel{ 0.7f };
+		float forestLevel{ 0.56f };
+		float lakeLevel{ 0.3f };
+	};
+
+	/** Seeded procedural map generator for stress testing.
+	* Uses tileset of the default map (Plains, Hills, Forest, Mountains, Lake, Ocean) and
+	* fills resources layer the way default map does: soil on plains, trees in forests,
+	* fresh water in lakes and on their shores, salt water in ocean.
+	* Same settings always produce the same map.
+	*/
+	void generateMap(const MapGeneratorSettings& settings, MapData& map);
+
+} // namespace Archipelago
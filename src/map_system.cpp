@@ -1,21 +1,33 @@
-#include <spdlog\spdlog.h>
-#include <fstream>
-#include <json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
 #include "map_system.h"
-#include "building_component.h"
+#include "perf_counters.h"
+#include "texture_cache.h"
+
+namespace Archipelago {
+
+	const unsigned int maxChunksBuiltPerFrame{ 4 }; /// streamed chunks turned into entities per frame, bounds the hitch of a fast pan
+	const float renderMarginTiles{ 2.0f }; /// tiles drawn beyond the view, covers sprites rising above their tile
+
+}
 
 using namespace Archipelago;
 
 void MapSystem::configure(World* world) {
 	spdlog::get(loggerName)->trace("MapSystem::configure started");
 	world->subscribe<LoadMapEvent>(this);
+	world->subscribe<LoadMapDataEvent>(this);
 	world->subscribe<MoveCameraEvent>(this);
 	world->subscribe<MoveCameraToMapCenterEvent>(this);
 	world->subscribe<ConvertScreenToMapCoordsEvent>(this);
 	world->subscribe<ConvertMapToScreenCoordsEvent>(this);
 	world->subscribe<ShowNaturalResourcesEvent>(this);
 	world->subscribe<RequestHighlightedEntityEvent>(this);
+	world->subscribe<BuildingPlacedEvent>(this);
+	world->subscribe<SpecificationsReloadedEvent>(this);
 	world->subscribe<RenderMapEvent>(this);
+	_resolveNatresIcons();
 	_showNaturalResources = false;
 	_currentHighlightedEntity = 0;
 }
@@ -23,85 +35,345 @@ void MapSystem::configure(World* world) {
 void MapSystem::unconfigure(World* world) {
 	spdlog::get(loggerName)->trace("MapSystem::unconfigure started");
 	world->unsubscribe<LoadMapEvent>(this);
+	world->unsubscribe<LoadMapDataEvent>(this);
 	world->unsubscribe<MoveCameraEvent>(this);
 	world->unsubscribe<MoveCameraToMapCenterEvent>(this);
 	world->unsubscribe<ConvertScreenToMapCoordsEvent>(this);
 	world->unsubscribe<ConvertMapToScreenCoordsEvent>(this);
 	world->unsubscribe<ShowNaturalResourcesEvent>(this);
 	world->unsubscribe<RequestHighlightedEntityEvent>(this);
+	world->unsubscribe<BuildingPlacedEvent>(this);
+	world->unsubscribe<SpecificationsReloadedEvent>(this);
 	world->unsubscribe<RenderMapEvent>(this);
 }
 
 void MapSystem::receive(World* world, const LoadMapEvent& event) {
 	auto logger = spdlog::get(loggerName);
 	logger->trace("MapSystem: LoadMapEvent received. Loading map '{}'", event.filename);
-	nlohmann::json mapJSON;
-	std::fstream mapFile;
-	mapFile.open(event.filename);
-	if (mapFile.fail()) {
-		logger->error("MapSystem: Error opening map file '{}'", event.filename);
+	auto reader = std::make_unique<ChunkedMapReader>();
+	if (reader->open(event.filename)) {
+		// Chunked maps are streamed, chunks get paged in by tick() as the camera looks at them
+		_resetMap(world);
+		_initMapGeometry(reader->getHeader(), reader->getChunkSize());
+		_residentChunkBudget = std::max<size_t>(_game.getMapResidentChunkBudget(), 1);
+		_streamer = std::make_unique<MapChunkStreamer>(std::move(reader));
+		logger->trace("MapSystem: Streaming map. Width: {}, height: {}, {}x{} chunks, resident budget {} chunks",
+			_mapWidth, _mapHeight, _chunksX, _chunksY, _residentChunkBudget);
+		return;
+	}
+	MapData map;
+	if (!loadMapFile(event.filename, map)) {
+		logger->error("MapSystem: Can't load map file '{}'", event.filename);
 		return;
 	}
-	mapFile >> mapJSON;
-	mapFile.close();
+	_buildMap(world, map);
+}
+
+void MapSystem::receive(World* world, const LoadMapDataEvent& event) {
+	spdlog::get(loggerName)->trace("MapSystem: LoadMapDataEvent received. Building {}x{} map", event.map.mapWidth, event.map.mapHeight);
+	_buildMap(world, event.map);
+}
+
+void MapSystem::tick(World* world, float deltaTime) {
+	++_frame;
+	if (_streamer) {
+		_updateStreaming(world);
+	}
+}
 
-	unsigned int mapSize = 0;
-	std::vector<unsigned int> terrainLayer;
-	std::vector<unsigned int> natresLayer;
-	try {
-		_mapWidth = mapJSON.at("mapWidth");
-		_mapHeight = mapJSON.at("mapHeight");
-		_tileWidth = mapJSON.at("tileWidth");
-		_tileHeight = mapJSON.at("tileHeight");
-		mapSize = _mapWidth * _mapHeight;
-		terrainLayer = std::move(mapJSON.at("terrain_layer").get<std::vector<unsigned int>>());
-		natresLayer = std::move(mapJSON.at("resources_layer").get<std::vector<unsigned int>>());
-		if (terrainLayer.size() != mapSize) {
-			logger->error("terrain_layer size ({}) is not equal to width*height ({}). There is something wrong in map file.", terrainLayer.size(), mapSize);
+void MapSystem::_buildMap(World* world, const MapData& map) {
+	_resetMap(world);
+	_initMapGeometry(map, defaultMapChunkSize);
+	std::vector<unsigned int> terrain;
+	std::vector<uint32_t> resources;
+	for (size_t chunkIndex = 0; chunkIndex < _chunks.size(); chunkIndex++) {
+		unsigned int x0 = static_cast<unsigned int>(chunkIndex % _chunksX) * _chunkSize;
+		unsigned int y0 = static_cast<unsigned int>(chunkIndex / _chunksX) * _chunkSize;
+		unsigned int w = std::min(_chunkSize, _mapWidth - x0), h = std::min(_chunkSize, _mapHeight - y0);
+		terrain.clear();
+		resources.clear();
+		for (unsigned int y = y0; y < y0 + h; y++) {
+			size_t row = static_cast<size_t>(y) * _mapWidth + x0;
+			terrain.insert(terrain.end(), map.terrainLayer.begin() + row, map.terrainLayer.begin() + row + w);
+			resources.insert(resources.end(), map.resourcesLayer.begin() + row, map.resourcesLayer.begin() + row + w);
 		}
+		_buildChunk(world, chunkIndex, terrain, resources);
 	}
-	catch (std::out_of_range& e) {
-		logger->error("MapSystem: Can't parse map file: {}", e.what());
+	spdlog::get(loggerName)->trace("MapSystem: Map loaded. Width: {}, height: {}", _mapWidth, _mapHeight);
+}
+
+void MapSystem::_resetMap(World* world) {
+	// Previous map is replaced rather than overlaid
+	_streamer.reset();
+	for (size_t chunkIndex : _residentChunks) {
+		for (Entity* ent : _chunks[chunkIndex].tiles) {
+			world->destroy(ent, true);
+		}
 	}
+	_chunks.clear();
+	_residentChunks.clear();
+	_wantedChunks = { 1, 1, 0, 0 };
+	_currentHighlightedEntity = 0;
+}
+
+void MapSystem::_initMapGeometry(const MapData& header, unsigned int chunkSize) {
+	_mapWidth = header.mapWidth;
+	_mapHeight = header.mapHeight;
+	_tileWidth = header.tileWidth;
+	_tileHeight = header.tileHeight;
+	_chunkSize = chunkSize;
+	_chunksX = (_mapWidth + _chunkSize - 1) / _chunkSize;
+	_chunksY = (_mapHeight + _chunkSize - 1) / _chunkSize;
+	_chunks.assign(static_cast<size_t>(_chunksX) * _chunksY, MapChunk());
 
 	//    ,    
-	std::map<unsigned int, TileComponent> tileAtlas;
-	for (nlohmann::json tileJSON : mapJSON.at("tileset")) {
-		unsigned int id = tileJSON.at("id");
-		std::string tileName = tileJSON.at("tileName");
-		std::string texFileName = tileJSON.at("texFileName");
-		unsigned int tileRising = tileJSON.find("tileRising") != tileJSON.end() ? tileJSON.at("tileRising") : 0;
-		unsigned int texOffsetX = tileJSON.find("texOffsetX") != tileJSON.end() ? tileJSON.at("texOffsetX") : 0;
-		_game.getAssetRegistry().loadTexture(tileName, texFileName);
-		tileAtlas.insert(std::pair<int, TileComponent>(id, std::move(TileComponent())));
-		TileComponent& tileComponent = tileAtlas.at(id);
-		tileComponent.name = tileName;
-		tileComponent.sprite.setTexture(*_game.getAssetRegistry().getTexture(tileName), true);
-		tileComponent.rising = tileRising;
-	}
-	unsigned int mapX = 0, mapY = 0;
+	_tileAtlas.clear();
+	// Tile textures are only registered, terrain is drawn from the atlas texture and the info window loads them when it shows one
+	AssetRegistry& registry = _game.getAssetRegistry();
+	for (const MapTileType& tileType : header.tileset) {
+		TileComponent& tileComponent = _tileAtlas[tileType.id];
+		tileComponent.name = tileType.name;
+		tileComponent.rising = tileType.rising;
+		registry.registerTexture(tileType.name, tileType.texFileName);
+	}
+	_buildTileAtlasTexture(header);
+}
+
+void MapSystem::_buildTileAtlasTexture(const MapData& header) {
+	// Tile images are packed side by side, so that terrain of a whole chunk is one textured vertex array.
+	// They come decoded from the texture cache, in parallel, and go to the GPU once, as the atlas
+	std::vector<sf::Image> images(header.tileset.size());
+	std::vector<char> decoded(header.tileset.size(), 0);
+	_game.getJobSystem().parallelFor(images.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			decoded[i] = loadCachedImage(header.tileset[i].texFileName, images[i]);
+		}
+	});
+	unsigned int atlasWidth = 0, atlasHeight = 0;
+	for (size_t i = 0; i < images.size(); i++) {
+		if (!decoded[i]) {
+			spdlog::get(loggerName)->error("MapSystem: Can't load tile image '{}'", header.tileset[i].texFileName);
+			continue;
+		}
+		atlasWidth += images[i].getSize().x;
+		atlasHeight = std::max(atlasHeight, images[i].getSize().y);
+	}
+	_tileMeshTemplates.clear();
+	if (atlasWidth == 0 || !_tileAtlasTexture.create(atlasWidth, atlasHeight)) {
+		spdlog::get(loggerName)->error("MapSystem: Can't create {}x{} tile atlas texture", atlasWidth, atlasHeight);
+		return;
+	}
+	unsigned int x = 0;
+	for (size_t i = 0; i < images.size(); i++) {
+		if (!decoded[i]) continue;
+		const MapTileType& tileType = header.tileset[i];
+		_tileAtlasTexture.update(images[i], x, 0);
+		TileMeshTemplate& meshTemplate = _tileMeshTemplates[tileType.id];
+		meshTemplate.texOrigin = sf::Vector2f(static_cast<float>(x), 0.0f);
+		meshTemplate.size = sf::Vector2f(images[i].getSize());
+		meshTemplate.rising = static_cast<float>(tileType.rising);
+		x += images[i].getSize().x;
+	}
+}
+
+void MapSystem::_buildChunk(World* world, size_t chunkIndex, const std::vector<unsigned int>& terrain, const std::vector<uint32_t>& resources) {
+	MapChunk& chunk = _chunks[chunkIndex];
+	unsigned int x0 = static_cast<unsigned int>(chunkIndex % _chunksX) * _chunkSize;
+	unsigned int y0 = static_cast<unsigned int>(chunkIndex / _chunksX) * _chunkSize;
+	unsigned int w = std::min(_chunkSize, _mapWidth - x0);
 	TileComponent tmpTileComponent;
-	for (unsigned int i = 0; i < mapSize; i++) {
+	chunk.tiles.resize(terrain.size());
+	for (size_t i = 0; i < terrain.size(); i++) {
+		unsigned int mapX = x0 + static_cast<unsigned int>(i % w);
+		unsigned int mapY = y0 + static_cast<unsigned int>(i / w);
 		Entity* ent = world->create();
-		tmpTileComponent = tileAtlas.at(terrainLayer[i]);
-		NaturalResourceTypeId natresType;
+		chunk.tiles[i] = ent;
+		auto tileIt = _tileAtlas.find(terrain[i]);
+		if (tileIt == _tileAtlas.end()) {
+			spdlog::get(loggerName)->error("MapSystem: Unknown tile id {} at ({}, {})", terrain[i], mapX, mapY);
+			tileIt = _tileAtlas.begin();
+		}
+		tmpTileComponent = tileIt->second;
+		NaturalResourceTypeId natresType{ NaturalResourceTypeId::Unknown };
 		sf::Vector2f screenCoords = _mapToScreenCoords(sf::Vector2f(static_cast<float>(mapX), static_cast<float>(mapY)));
 		screenCoords.y = screenCoords.y - tmpTileComponent.rising;
 		tmpTileComponent.sprite.setPosition(screenCoords);
 		ent->assign<TileComponent>(tmpTileComponent.name, tmpTileComponent.rising, tmpTileComponent.sprite, mapX, mapY);
-		ent->assign<NaturalResourceComponent>(natresType, natresLayer[i]);
-		mapX++;
-		if (mapX >= _mapWidth) {
-			mapX = 0;
-			mapY++;
+		ent->assign<NaturalResourceComponent>(natresType, resources[i]);
+	}
+	chunk.terrain = terrain;
+	chunk.meshDirty = true;
+	chunk.loading = false;
+	chunk.lastVisibleFrame = _frame;
+	_residentChunks.push_back(chunkIndex);
+}
+
+void MapSystem::_evictChunk(World* world, size_t chunkIndex) {
+	MapChunk& chunk = _chunks[chunkIndex];
+	for (Entity* ent : chunk.tiles) {
+		if (ent->getEntityId() == _currentHighlightedEntity) {
+			_currentHighlightedEntity = 0;
+		}
+		world->destroy(ent, true);
+	}
+	std::vector<Entity*>().swap(chunk.tiles); // release memory, not just entities
+	std::vector<unsigned int>().swap(chunk.terrain);
+	chunk.mesh = sf::VertexArray();
+	chunk.meshDirty = false;
+	auto it = std::find(_residentChunks.begin(), _residentChunks.end(), chunkIndex);
+	*it = _residentChunks.back();
+	_residentChunks.pop_back();
+}
+
+void MapSystem::_getChunkBuildings(size_t chunkIndex, std::vector<IndexedBuilding>& out) const {
+	unsigned int x0 = static_cast<unsigned int>(chunkIndex % _chunksX) * _chunkSize;
+	unsigned int y0 = static_cast<unsigned int>(chunkIndex / _chunksX) * _chunkSize;
+	_game.getBuildingIndex().queryRect(x0, y0, x0 + _chunkSize - 1, y0 + _chunkSize - 1, out);
+	// Chunk spans several index buckets, each ordered on its own
+	std::sort(out.begin(), out.end(), [](const IndexedBuilding& a, const IndexedBuilding& b) {
+		return a.y != b.y ? a.y < b.y : a.x < b.x;
+	});
+}
+
+void MapSystem::_rebuildChunkMesh(size_t chunkIndex) {
+	// Runs on job threads: reads only chunk terrain, templates and building index, writes only chunk mesh.
+	// Index is only changed on main thread between frames
+	MapChunk& chunk = _chunks[chunkIndex];
+	unsigned int x0 = static_cast<unsigned int>(chunkIndex % _chunksX) * _chunkSize;
+	unsigned int y0 = static_cast<unsigned int>(chunkIndex / _chunksX) * _chunkSize;
+	unsigned int w = std::min(_chunkSize, _mapWidth - x0);
+	chunk.mesh.setPrimitiveType(sf::Quads);
+	chunk.mesh.resize(chunk.terrain.size() * 4);
+	size_t vertexCount = 0;
+	std::vector<IndexedBuilding> buildings;
+	_getChunkBuildings(chunkIndex, buildings);
+	auto nextBuilding = buildings.begin();
+	for (size_t i = 0; i < chunk.terrain.size() && !_tileMeshTemplates.empty(); i++) {
+		if (nextBuilding != buildings.end() && (nextBuilding->y - y0) * w + nextBuilding->x - x0 == i) {
+			++nextBuilding;
+			continue;
+		}
+		auto templateIt = _tileMeshTemplates.find(chunk.terrain[i]);
+		if (templateIt == _tileMeshTemplates.end()) {
+			templateIt = _tileMeshTemplates.begin(); // unknown ids are reported by _buildChunk
+		}
+		const TileMeshTemplate& meshTemplate = templateIt->second;
+		sf::Vector2f position = _mapToScreenCoords(sf::Vector2f(static_cast<float>(x0 + i % w), static_cast<float>(y0 + i / w)));
+		position.y -= meshTemplate.rising;
+		sf::Vertex* quad = &chunk.mesh[vertexCount];
+		quad[0].position = position;
+		quad[1].position = position + sf::Vector2f(meshTemplate.size.x, 0.0f);
+		quad[2].position = position + meshTemplate.size;
+		quad[3].position = position + sf::Vector2f(0.0f, meshTemplate.size.y);
+		quad[0].texCoords = meshTemplate.texOrigin;
+		quad[1].texCoords = meshTemplate.texOrigin + sf::Vector2f(meshTemplate.size.x, 0.0f);
+		quad[2].texCoords = meshTemplate.texOrigin + meshTemplate.size;
+		quad[3].texCoords = meshTemplate.texOrigin + sf::Vector2f(0.0f, meshTemplate.size.y);
+		vertexCount += 4;
+	}
+	chunk.mesh.resize(vertexCount);
+	chunk.meshDirty = false;
+}
+
+void MapSystem::_updateStreaming(World* world) {
+	auto logger = spdlog::get(loggerName);
+	// One chunk of prefetch around the view, so panning finds neighbours already loaded
+	ChunkRange wanted = _getVisibleChunks(static_cast<float>(_chunkSize));
+	if (!(wanted == _wantedChunks)) {
+		// Requests for chunks the camera has left are dropped, still wanted ones are requested again
+		_streamer->cancelPending(_chunkScratch);
+		for (size_t chunkIndex : _chunkScratch) {
+			_chunks[chunkIndex].loading = false;
+		}
+		_wantedChunks = wanted;
+		_requestChunks(wanted);
+	}
+	for (unsigned int cy = wanted.y0; cy <= wanted.y1 && wanted.x0 <= wanted.x1; cy++) {
+		for (unsigned int cx = wanted.x0; cx <= wanted.x1; cx++) {
+			_chunks[static_cast<size_t>(cy) * _chunksX + cx].lastVisibleFrame = _frame;
+		}
+	}
+
+	unsigned int built = 0;
+	while (built < maxChunksBuiltPerFrame && _streamer->poll(_streamedChunk)) {
+		MapChunk& chunk = _chunks[_streamedChunk.chunkIndex];
+		if (!chunk.loading || !chunk.tiles.empty()) continue; // cancelled or already built
+		chunk.loading = false;
+		if (!_streamedChunk.loaded) {
+			logger->error("MapSystem: Can't read map chunk {}", _streamedChunk.chunkIndex);
+			continue;
+		}
+		_buildChunk(world, _streamedChunk.chunkIndex, _streamedChunk.terrain, _streamedChunk.resources);
+		++built;
+	}
+
+	if (_residentChunks.size() <= _residentChunkBudget) return;
+	// Evict least recently visible chunks, never the wanted ones
+	_chunkScratch.clear();
+	for (size_t chunkIndex : _residentChunks) {
+		const MapChunk& chunk = _chunks[chunkIndex];
+		if (!wanted.contains(chunkIndex % _chunksX, static_cast<unsigned int>(chunkIndex / _chunksX))) {
+			_chunkScratch.push_back(chunkIndex);
 		}
 	}
-	logger->trace("MapSystem: Map loaded. Width: {}, height: {}", _mapWidth, _mapHeight);
+	std::sort(_chunkScratch.begin(), _chunkScratch.end(), [this](size_t a, size_t b) {
+		return _chunks[a].lastVisibleFrame < _chunks[b].lastVisibleFrame;
+	});
+	for (size_t i = 0; i < _chunkScratch.size() && _residentChunks.size() > _residentChunkBudget; i++) {
+		_evictChunk(world, _chunkScratch[i]);
+	}
+}
+
+void MapSystem::_requestChunks(const ChunkRange& range) {
+	if (range.x0 > range.x1) return;
+	_chunkScratch.clear();
+	for (unsigned int cy = range.y0; cy <= range.y1; cy++) {
+		for (unsigned int cx = range.x0; cx <= range.x1; cx++) {
+			size_t chunkIndex = static_cast<size_t>(cy) * _chunksX + cx;
+			if (_chunks[chunkIndex].tiles.empty() && !_chunks[chunkIndex].loading) {
+				_chunkScratch.push_back(chunkIndex);
+			}
+		}
+	}
+	// Streamer serves newest requests first, so request from the border inwards to get the view center first
+	float centerX = (range.x0 + range.x1) / 2.0f, centerY = (range.y0 + range.y1) / 2.0f;
+	auto distance = [&](size_t chunkIndex) {
+		return std::abs(chunkIndex % _chunksX - centerX) + std::abs(chunkIndex / _chunksX - centerY);
+	};
+	std::sort(_chunkScratch.begin(), _chunkScratch.end(), [&](size_t a, size_t b) { return distance(a) > distance(b); });
+	for (size_t chunkIndex : _chunkScratch) {
+		_chunks[chunkIndex].loading = true;
+		_streamer->request(chunkIndex);
+	}
+}
+
+MapSystem::ChunkRange MapSystem::_getVisibleChunks(float marginTiles) const {
+	if (_chunks.empty()) return { 1, 1, 0, 0 };
+	const sf::View& view = _game.getView();
+	sf::Vector2f halfSize = view.getSize() / 2.0f;
+	sf::Vector2f corners[] = {
+		_screenToMapCoords(view.getCenter() - halfSize),
+		_screenToMapCoords(view.getCenter() + halfSize),
+		_screenToMapCoords(view.getCenter() + sf::Vector2f(halfSize.x, -halfSize.y)),
+		_screenToMapCoords(view.getCenter() + sf::Vector2f(-halfSize.x, halfSize.y))
+	};
+	float minX = corners[0].x, maxX = corners[0].x, minY = corners[0].y, maxY = corners[0].y;
+	for (const sf::Vector2f& corner : corners) {
+		minX = std::min(minX, corner.x);
+		maxX = std::max(maxX, corner.x);
+		minY = std::min(minY, corner.y);
+		maxY = std::max(maxY, corner.y);
+	}
+	auto toChunk = [this](float tile, unsigned int chunks) {
+		return static_cast<unsigned int>(std::min(std::max(tile / _chunkSize, 0.0f), static_cast<float>(chunks - 1)));
+	};
+	return { toChunk(minX - marginTiles, _chunksX), toChunk(minY - marginTiles, _chunksY),
+		toChunk(maxX + marginTiles, _chunksX), toChunk(maxY + marginTiles, _chunksY) };
 }
 
 void MapSystem::receive(World* world, const MoveCameraEvent& event) {
 	//spdlog::get(loggerName)->trace("MoveCameraEvent received. Offset ({}, {})", event.offsetX, event.offsetY);
-	sf::View v = _game.getRenderWindow().getView();
+	sf::View v = _game.getView();
 	sf::Vector2f viewCenter = v.getCenter();
 	viewCenter.x = viewCenter.x + event.offsetX;
 	viewCenter.y = viewCenter.y + event.offsetY;
@@ -110,13 +382,13 @@ void MapSystem::receive(World* world, const MoveCameraEvent& event) {
 		return;
 	}
 	v.move(event.offsetX, event.offsetY);
-	_game.getRenderWindow().setView(v);
+	_game.setView(v);
 }
 
 void MapSystem::receive(World* world, const MoveCameraToMapCenterEvent& event) {
-	sf::View view = _game.getRenderWindow().getView();
+	sf::View view = _game.getView();
 	view.setCenter(static_cast<float>(_tileWidth) / 2, static_cast<float>(_tileHeight * _mapHeight) / 2);
-	_game.getRenderWindow().setView(view);
+	_game.setView(view);
 }
 
 void MapSystem::receive(World* world, const ConvertScreenToMapCoordsEvent& event) {
@@ -137,57 +409,135 @@ void MapSystem::receive(World* world, const RequestHighlightedEntityEvent& event
 	event.entityID = _currentHighlightedEntity;
 }
 
+void MapSystem::receive(World* world, const BuildingPlacedEvent& event) {
+	if (event.x >= _mapWidth || event.y >= _mapHeight || _chunks.empty()) return;
+	MapChunk& chunk = _chunks[static_cast<size_t>(event.y / _chunkSize) * _chunksX + event.x / _chunkSize];
+	if (!chunk.tiles.empty()) {
+		chunk.meshDirty = true; // tile is cut out of terrain mesh
+	}
+}
+
+void MapSystem::receive(World* world, const SpecificationsReloadedEvent& event) {
+	_resolveNatresIcons();
+}
+
+void MapSystem::_resolveNatresIcons() {
+	for (NaturalResourceTypeId natresType : naturalResourceTypeIds) {
+		_natresIcons[static_cast<size_t>(natresType)] = _game.getAssetRegistry().getNatresSpecification(natresType).icon;
+	}
+}
+
 void MapSystem::receive(World* world, const RenderMapEvent& event) {
 	sf::Vector2f mouseScreenCoords = _game.getRenderWindow().mapPixelToCoords(sf::Mouse::getPosition(_game.getRenderWindow()));
 	sf::Vector2f mouseMapCoords = _screenToMapCoords(mouseScreenCoords);
 	//if (_currentHighlightedEntity) world->getById(_currentHighlightedEntity)->get<TileComponent>()->sprite.setColor(sf::Color::White);
 	_currentHighlightedEntity = 0;
-	world->each<TileComponent>([&](Entity* ent, ComponentHandle<TileComponent> tile) {
-		if (static_cast<int>(mouseMapCoords.x) == tile->x && static_cast<int>(mouseMapCoords.y) == tile->y) {
-			//tile->sprite.setColor(sf::Color(255, 255, 255, 127));
-			_currentHighlightedEntity = ent->getEntityId();
-		}
-		// Draw tile
-		if (ent->has<BuildingComponent>()) {
-			_game.getRenderWindow().draw(ent->get<BuildingComponent>()->sprite);
-		}
-		else {
-			_game.getRenderWindow().draw(tile->sprite);
-		}
-		// Draw natural resources on tile
-		if (_showNaturalResources) {
-			uint32_t resourceSet = ent->get<NaturalResourceComponent>()->resourceSet;
-			uint32_t mask = 0x000000FF;
-			//    : 32- ,        , ..
-			//          .
-			//     (tileWidth - iconWidth) * 2 
-			sf::Sprite natresSprite;
-			for (unsigned int g = 0; g < 4; g++) {
-				int numWares = 1;
-				NaturalResourceTypeId natresType = static_cast<NaturalResourceTypeId>((resourceSet & mask) >> (g*8));
-				mask = mask << 8;
-				if ((natresType >= NaturalResourceTypeId::_First) && (natresType <= NaturalResourceTypeId::_Last)) {
-					natresSprite.setTexture(*_game.getAssetRegistry().getNatresSpecification(natresType).icon, true);
-					auto gsTexSize = natresSprite.getTexture()->getSize();
-					auto natresSpritePos = tile->sprite.getPosition();
-					natresSpritePos.x += (_tileWidth / 2) + ((gsTexSize.x) * (g - (numWares / 2)));
-					natresSpritePos.y += (_tileHeight / 2) - (gsTexSize.y / 2);
-					natresSprite.setPosition(natresSpritePos);
-					_game.getRenderWindow().draw(natresSprite);
-				}
+	int mouseX = static_cast<int>(mouseMapCoords.x), mouseY = static_cast<int>(mouseMapCoords.y);
+	if (mouseX >= 0 && mouseY >= 0 && mouseX < static_cast<int>(_mapWidth) && mouseY < static_cast<int>(_mapHeight)) {
+		const MapChunk& chunk = _chunks[static_cast<size_t>(mouseY / _chunkSize) * _chunksX + mouseX / _chunkSize];
+		unsigned int w = std::min(_chunkSize, _mapWidth - (mouseX / _chunkSize) * _chunkSize);
+		if (!chunk.tiles.empty()) {
+			_currentHighlightedEntity = chunk.tiles[(mouseY % _chunkSize) * w + mouseX % _chunkSize]->getEntityId();
+		}
+	}
+	// Only chunks overlapping the view are drawn, chunk by chunk in row-major order.
+	// Terrain meshes invalidated by streaming or building placement are rebuilt in parallel first
+	ChunkRange visible = _getVisibleChunks(renderMarginTiles);
+	_dirtyMeshes.clear();
+	for (unsigned int cy = visible.y0; cy <= visible.y1 && visible.x0 <= visible.x1; cy++) {
+		for (unsigned int cx = visible.x0; cx <= visible.x1; cx++) {
+			const MapChunk& chunk = _chunks[static_cast<size_t>(cy) * _chunksX + cx];
+			if (chunk.meshDirty && !chunk.tiles.empty()) {
+				_dirtyMeshes.push_back(static_cast<size_t>(cy) * _chunksX + cx);
 			}
 		}
+	}
+	_game.getJobSystem().parallelFor(_dirtyMeshes.size(), 1, [this](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			_rebuildChunkMesh(_dirtyMeshes[i]);
+		}
 	});
+	for (unsigned int cy = visible.y0; cy <= visible.y1 && visible.x0 <= visible.x1; cy++) {
+		for (unsigned int cx = visible.x0; cx <= visible.x1; cx++) {
+			_drawChunk(static_cast<size_t>(cy) * _chunksX + cx);
+		}
+	}
+}
+
+void MapSystem::_drawChunk(size_t chunkIndex) {
+	const MapChunk& chunk = _chunks[chunkIndex];
+	if (chunk.tiles.empty()) return;
+	PerfCounters& counters = PerfCounters::instance();
+	AssetRegistry& registry = _game.getAssetRegistry();
+	sf::RenderWindow& window = _game.getRenderWindow();
+	// Buildings replace their tiles in the mesh. For isometric occlusion they are drawn in tile order too:
+	// mesh quads of the tiles before a building, then the building, so terrain in front of it covers it
+	unsigned int x0 = static_cast<unsigned int>(chunkIndex % _chunksX) * _chunkSize;
+	unsigned int y0 = static_cast<unsigned int>(chunkIndex / _chunksX) * _chunkSize;
+	unsigned int w = std::min(_chunkSize, _mapWidth - x0);
+	size_t meshVertices = chunk.mesh.getVertexCount();
+	size_t drawnVertices = 0;
+	auto drawMeshUpTo = [&](size_t endVertex) {
+		endVertex = std::min(endVertex, meshVertices);
+		if (endVertex <= drawnVertices) return;
+		window.draw(&chunk.mesh[drawnVertices], endVertex - drawnVertices, sf::Quads, sf::RenderStates(&_tileAtlasTexture));
+		counters.countDraw(&_tileAtlasTexture, endVertex - drawnVertices);
+		drawnVertices = endVertex;
+	};
+	_getChunkBuildings(chunkIndex, _chunkBuildings);
+	for (size_t b = 0; b < _chunkBuildings.size(); b++) {
+		const IndexedBuilding& building = _chunkBuildings[b];
+		size_t tileIndex = (building.y - y0) * w + building.x - x0;
+		drawMeshUpTo((tileIndex - b) * 4); // every tile before it has a quad, except the b buildings before it
+		// Building stands on its tile's ground level, whatever the tile's own rising, so map coordinates are enough
+		const BuildingSpecification& bs = registry.getBuildingSpecification(building.type);
+		const sf::Texture& texture = registry.useTexture(bs.icon);
+		_buildingSprite.setTexture(texture, true);
+		sf::Vector2f position = _mapToScreenCoords(sf::Vector2f(static_cast<float>(building.x), static_cast<float>(building.y)));
+		position.y -= static_cast<float>(bs.tileRising);
+		_buildingSprite.setPosition(position);
+		window.draw(_buildingSprite);
+		counters.countDraw(&texture, 4);
+	}
+	drawMeshUpTo(meshVertices);
+	counters.add(PerfCounterId::EntitiesIterated, _chunkBuildings.size());
+	if (!_showNaturalResources) return;
+	// Draw natural resources on tiles
+	for (Entity* ent : chunk.tiles) {
+		ComponentHandle<TileComponent> tile = ent->get<TileComponent>();
+		uint32_t resourceSet = ent->get<NaturalResourceComponent>()->resourceSet;
+		uint32_t mask = 0x000000FF;
+		//    : 32- ,        , ..
+		//          .
+		//     (tileWidth - iconWidth) * 2 
+		sf::Sprite natresSprite;
+		for (unsigned int g = 0; g < 4; g++) {
+			int numWares = 1;
+			NaturalResourceTypeId natresType = static_cast<NaturalResourceTypeId>((resourceSet & mask) >> (g*8));
+			mask = mask << 8;
+			if (isKnownId(natresType)) {
+				natresSprite.setTexture(registry.useTexture(_natresIcons[static_cast<size_t>(natresType)]), true);
+				auto gsTexSize = natresSprite.getTexture()->getSize();
+				auto natresSpritePos = tile->sprite.getPosition();
+				natresSpritePos.x += (_tileWidth / 2) + ((gsTexSize.x) * (g - (numWares / 2)));
+				natresSpritePos.y += (_tileHeight / 2) - (gsTexSize.y / 2);
+				natresSprite.setPosition(natresSpritePos);
+				_game.getRenderWindow().draw(natresSprite);
+				counters.countDraw(natresSprite.getTexture(), 4);
+			}
+		}
+	}
+	counters.add(PerfCounterId::EntitiesIterated, chunk.tiles.size());
 }
 
-const sf::Vector2f MapSystem::_mapToScreenCoords(sf::Vector2f mapCoords) {
+const sf::Vector2f MapSystem::_mapToScreenCoords(sf::Vector2f mapCoords) const {
 	sf::Vector2f screenCoords;
 	screenCoords.x = (mapCoords.x - mapCoords.y) * _tileWidth / 2;
 	screenCoords.y = (mapCoords.x + mapCoords.y) * _tileHeight / 2;
 	return screenCoords;
 }
 
-const sf::Vector2f MapSystem::_screenToMapCoords(sf::Vector2f screenCoords) {
+const sf::Vector2f MapSystem::_screenToMapCoords(sf::Vector2f screenCoords) const {
 	sf::Vector2f mapCoords;
 	mapCoords.x = (screenCoords.x / (_tileWidth / 2) + screenCoords.y / (_tileHeight / 2)) / 2 - 0.5f;
 	mapCoords.y = (screenCoords.y / (_tileHeight / 2) - (screenCoords.x / (_tileWidth / 2))) / 2 + 0.5f;
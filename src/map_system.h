@@ -1,7 +1,10 @@
 #pragma once
 
+#include <map>
 #include <ECS.h>
 #include "game.h"
+#include "map_data.h"
+#include "map_chunk_streamer.h"
 #include "map_system_events.h"
 #include "tile_component.h"
 #include "natural_resource_component.h"
@@ -14,26 +17,33 @@ namespace Archipelago {
 
 	class MapSystem : public EntitySystem,
 		public EventSubscriber<LoadMapEvent>,
+		public EventSubscriber<LoadMapDataEvent>,
 		public EventSubscriber<MoveCameraEvent>,
 		public EventSubscriber<MoveCameraToMapCenterEvent>,
 		public EventSubscriber<ConvertScreenToMapCoordsEvent>,
 		public EventSubscriber<ConvertMapToScreenCoordsEvent>,
 		public EventSubscriber<ShowNaturalResourcesEvent>,
 		public EventSubscriber<RequestHighlightedEntityEvent>,
+		public EventSubscriber<BuildingPlacedEvent>,
+		public EventSubscriber<SpecificationsReloadedEvent>,
 		public EventSubscriber<RenderMapEvent> {
 	public:
-		MapSystem(Game& game) : _game(game), _mapWidth(0), _mapHeight(0), _tileWidth(0), _tileHeight(0) {};
+		MapSystem(Game& game) : _game(game), _mapWidth(0), _mapHeight(0), _tileWidth(0), _tileHeight(0),
+			_chunkSize(defaultMapChunkSize), _chunksX(0), _chunksY(0), _residentChunkBudget(0), _frame(0) {};
 		virtual ~MapSystem() {};
 		virtual void configure(World* world) override;
 		virtual void unconfigure(World* world) override;
-		virtual void tick(World* world, float deltaTime) override {};
+		virtual void tick(World* world, float deltaTime) override;
 		virtual void receive(World* world, const LoadMapEvent& event) override;
+		virtual void receive(World* world, const LoadMapDataEvent& event) override;
 		virtual void receive(World* world, const MoveCameraEvent& event) override;
 		virtual void receive(World* world, const MoveCameraToMapCenterEvent& event) override;
 		virtual void receive(World* world, const ConvertScreenToMapCoordsEvent& event) override;
 		virtual void receive(World* world, const ConvertMapToScreenCoordsEvent& event) override;
 		virtual void receive(World* world, const ShowNaturalResourcesEvent& event) override;
 		virtual void receive(World* world, const RequestHighlightedEntityEvent& event) override;
+		virtual void receive(World* world, const BuildingPlacedEvent& event) override;
+		virtual void receive(World* world, const SpecificationsReloadedEvent& event) override;
 		virtual void receive(World* world, const RenderMapEvent& event) override;
 	private:
 		Game& _game;
@@ -44,8 +54,69 @@ namespace Archipelago {
 		bool _showNaturalResources;
 		size_t _currentHighlightedEntity;
 
-		const sf::Vector2f _mapToScreenCoords(sf::Vector2f mapCoords);
-		const sf::Vector2f _screenToMapCoords(sf::Vector2f screenCoords);
+		/** Square block of tiles, the unit of streaming and render culling.
+		* Whole map is resident when it was loaded from a non-chunked file. Otherwise chunks are
+		* paged in around the camera and least recently visible ones are evicted over the budget.
+		* Buildings aren't part of tile entities: they are looked up in the game's building index,
+		* so chunks with buildings are evicted and rebuilt like any other.
+		*/
+		struct MapChunk {
+			std::vector<Entity*> tiles; // row-major within chunk, empty while chunk is not resident
+			std::vector<unsigned int> terrain; // tileset ids of tiles, input of mesh rebuilds
+			sf::VertexArray mesh; // terrain of the whole chunk as quads in tile order, textured from tile atlas; drawn in one call per building plus one
+			uint64_t lastVisibleFrame{ 0 };
+			bool loading{ false };
+			bool meshDirty{ false };
+		};
+		/// Where tile of one tileset entry is found in tile atlas texture
+		struct TileMeshTemplate {
+			sf::Vector2f texOrigin;
+			sf::Vector2f size;
+			float rising;
+		};
+		/// Inclusive range of chunks, empty if x0 > x1
+		struct ChunkRange {
+			unsigned int x0, y0, x1, y1;
+			bool operator==(const ChunkRange& other) const { return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1; };
+			bool contains(unsigned int x, unsigned int y) const { return x >= x0 && x <= x1 && y >= y0 && y <= y1; };
+		};
+		unsigned int _chunkSize;
+		unsigned int _chunksX;
+		unsigned int _chunksY;
+		std::vector<MapChunk> _chunks; // row-major
+		std::vector<size_t> _residentChunks;
+		std::map<unsigned int, TileComponent> _tileAtlas; // tile templates by tileset id
+		TextureHandle _natresIcons[naturalResourceTypeCount]{}; // by NaturalResourceTypeId
+		std::map<unsigned int, TileMeshTemplate> _tileMeshTemplates; // by tileset id, read by mesh jobs
+		sf::Texture _tileAtlasTexture; // all tileset textures side by side
+		std::unique_ptr<MapChunkStreamer> _streamer; // null if whole map is resident
+		size_t _residentChunkBudget;
+		uint64_t _frame;
+		ChunkRange _wantedChunks{ 1, 1, 0, 0 };
+		// reused buffers
+		StreamedMapChunk _streamedChunk;
+		std::vector<size_t> _chunkScratch;
+		std::vector<size_t> _dirtyMeshes;
+		std::vector<IndexedBuilding> _chunkBuildings;
+		sf::Sprite _buildingSprite; // every building is drawn with it
+
+		void _buildMap(World* world, const MapData& map);
+		void _resetMap(World* world);
+		void _initMapGeometry(const MapData& header, unsigned int chunkSize);
+		void _buildChunk(World* world, size_t chunkIndex, const std::vector<unsigned int>& terrain, const std::vector<uint32_t>& resources);
+		void _evictChunk(World* world, size_t chunkIndex);
+		/// Icons are resolved once, the overlay draws them for every visible tile
+		void _resolveNatresIcons();
+		/// Buildings on tiles of the chunk in row-major order, the order their sprites are drawn in
+		void _getChunkBuildings(size_t chunkIndex, std::vector<IndexedBuilding>& out) const;
+		void _buildTileAtlasTexture(const MapData& header);
+		void _rebuildChunkMesh(size_t chunkIndex);
+		void _drawChunk(size_t chunkIndex);
+		void _updateStreaming(World* world);
+		void _requestChunks(const ChunkRange& range);
+		ChunkRange _getVisibleChunks(float marginTiles) const;
+		const sf::Vector2f _mapToScreenCoords(sf::Vector2f mapCoords) const;
+		const sf::Vector2f _screenToMapCoords(sf::Vector2f screenCoords) const;
 		int _numberOfSetBits(uint32_t value);
 	};
 
@@ -4,6 +4,11 @@ struct LoadMapEvent {
 	const std::string& filename;
 };
 
+/// Loads map which is already in memory, e.g. generated one
+struct LoadMapDataEvent {
+	const Archipelago::MapData& map;
+};
+
 struct MouseMovedEvent {
 	const bool orly;
 };
@@ -35,4 +40,16 @@ struct ShowNaturalResourcesEvent {
 
 struct RequestHighlightedEntityEvent {
 	size_t& entityID;
-};
\ No newline at end of file
+};
+
+/// Building was placed on the tile, so the tile is drawn as building from now on
+struct BuildingPlacedEvent {
+	const unsigned int x;
+	const unsigned int y;
+};
+
+/// Specifications were replaced in place by hot reload, anything cached from them has to be picked up again
+struct SpecificationsReloadedEvent {
+	const bool orly;
+};
+
@@ -1,13 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
+#include "spec_ids.h"
+#include "texture_handle.h"
 
 namespace Archipelago {
 
-	enum class NaturalResourceTypeId { Unknown = 0, FertileSoil = 1, Forest = 2, SaltWater = 3, FreshWater = 4, _Last = FreshWater, _First = FertileSoil };
-
 	struct NaturalResourceSpecification {
 		std::string name;
-		sf::Texture* icon; // non-owning pointer
+		TextureHandle icon{ noTextureHandle }; // loaded on first use
 	};
 } // namespace Archipelago
@@ -0,0 +1,171 @@
+#include <cctype>
+#include <cstdlib>
+#include <new>
+#include <spdlog/spdlog.h>
+#include "perf_counters.h"
+
+namespace Archipelago {
+
+	extern const std::string& loggerName;
+
+	const char* const builtinPerfCounterNames[static_cast<size_t>(PerfCounterId::_Count)] = {
+		"Draw calls", "Vertices", "Texture binds", "Entities iterated", "Allocations",
+		"Jobs run", "Jobs stolen", "Job busy us", "Worker idle us"
+	};
+
+}
+
+using namespace Archipelago;
+
+std::atomic<uint64_t> PerfCounters::_allocations{ 0 };
+
+PerfCounters& PerfCounters::instance() {
+	static PerfCounters counters;
+	return counters;
+}
+
+PerfCounters::PerfCounters() : _frameCount(0), _lastBoundTexture(nullptr), _allocationsAtFrameStart(0) {
+	for (size_t i = 0; i <= perfCounterOverflowIndex; i++) {
+		_current[i].store(0, std::memory_order_relaxed);
+		_lastFrame[i] = 0;
+		_totals[i] = 0;
+	}
+	_names.reserve(perfCountersCapacity);
+	for (const char* name : builtinPerfCounterNames) {
+		_names.push_back(name);
+	}
+}
+
+void PerfCounters::countDraw(const sf::Texture* texture, size_t vertices) {
+	add(PerfCounterId::DrawCalls);
+	add(PerfCounterId::VerticesSubmitted, vertices);
+	if (texture != _lastBoundTexture) {
+		add(PerfCounterId::TextureBinds);
+		_lastBoundTexture = texture;
+	}
+}
+
+size_t PerfCounters::registerCounter(const std::string& name) {
+	std::lock_guard<std::mutex> lock(_namesMutex);
+	for (size_t i = 0; i < _names.size(); i++) {
+		if (_names[i] == name) return i;
+	}
+	if (_names.size() == perfCountersCapacity) {
+		// registry is full, count into a slot nobody reads rather than crash or corrupt a real counter
+		auto logger = spdlog::get(loggerName);
+		if (logger) {
+			logger->warn("PerfCounters: registry is full, counter '{}' is discarded", name);
+		}
+		return perfCounterOverflowIndex;
+	}
+	_names.push_back(name);
+	return _names.size() - 1;
+}
+
+void PerfCounters::endFrame() {
+	uint64_t allocations = _allocations.load(std::memory_order_relaxed);
+	add(PerfCounterId::Allocations, allocations - _allocationsAtFrameStart);
+	_allocationsAtFrameStart = allocations;
+	size_t count = getCounterCount();
+	for (size_t i = 0; i < count; i++) {
+		_lastFrame[i] = _current[i].exchange(0, std::memory_order_relaxed);
+		_totals[i] += _lastFrame[i];
+	}
+	_current[perfCounterOverflowIndex].store(0, std::memory_order_relaxed);
+	_lastBoundTexture = nullptr;
+	++_frameCount;
+}
+
+size_t PerfCounters::getCounterCount() const {
+	std::lock_guard<std::mutex> lock(_namesMutex);
+	return _names.size();
+}
+
+const std::string& PerfCounters::getCounterName(size_t index) const {
+	std::lock_guard<std::mutex> lock(_namesMutex);
+	return _names[index];
+}
+
+void PerfCounters::formatLastFrame(std::string& out) const {
+	out.clear();
+	size_t count = getCounterCount();
+	for (size_t i = 0; i < count; i++) {
+		out += getCounterName(i);
+		out += ": ";
+		out += std::to_string(_lastFrame[i]);
+		out += i + 1 < count ? ", " : "";
+	}
+}
+
+void PerfCounters::formatTotals(std::string& out) const {
+	out.clear();
+	size_t count = getCounterCount();
+	for (size_t i = 0; i < count; i++) {
+		out += getCounterName(i);
+		out += ": ";
+		out += std::to_string(_totals[i]);
+		if (_frameCount > 0) {
+			out += " (";
+			out += std::to_string(_totals[i] / _frameCount);
+			out += "/frame)";
+		}
+		out += i + 1 < count ? ", " : "";
+	}
+}
+
+bool PerfCounters::isCountingAllocations() {
+#ifdef ARCHIPELAGO_COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::string Archipelago::cleanTypeName(const char* typeName) {
+	// MSVC reports "struct Name", GCC and Clang report mangled "4Name"
+	std::string name(typeName);
+	const std::string structPrefix("struct ");
+	if (name.compare(0, structPrefix.size(), structPrefix) == 0) {
+		name.erase(0, structPrefix.size());
+	}
+	size_t digits = 0;
+	while (digits < name.size() && std::isdigit(static_cast<unsigned char>(name[digits]))) {
+		++digits;
+	}
+	name.erase(0, digits);
+	return name;
+}
+
+#ifdef ARCHIPELAGO_COUNT_ALLOCATIONS
+// Global allocation hooks feeding PerfCounterId::Allocations
+void* operator new(std::size_t size) {
+	PerfCounters::countAllocation();
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	PerfCounters::countAllocation();
+	void* p = std::malloc(size ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	PerfCounters::countAllocation();
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	PerfCounters::countAllocation();
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace sf { class Texture; }
+
+// Replacing global operator new costs every allocation on every thread an atomic add on one shared cache line,
+// so allocations are counted in debug builds only, unless a build opts in
+#if !defined(NDEBUG) || defined(ARCHIPELAGO_ALLOCATION_COUNTING)
+#define ARCHIPELAGO_COUNT_ALLOCATIONS
+#endif
+
+namespace Archipelago {
+
+	enum class PerfCounterId : uint8_t { DrawCalls = 0, VerticesSubmitted, TextureBinds, EntitiesIterated, Allocations,
+		JobsRun, JobsStolen, JobBusyMicroseconds, WorkerIdleMicroseconds, _Count };
+	const size_t perfCountersCapacity{ 64 }; /// built-in plus dynamically registered counters
+	const size_t perfCounterOverflowIndex{ perfCountersCapacity }; /// unnamed slot counters registered past capacity count into, never reported
+
+	/** Registry of hot-path event counters.
+	* Incrementing is a relaxed atomic add, so counters may be bumped from any thread.
+	* Once per frame the main thread calls endFrame, which turns running values into
+	* "last frame" values and accumulates totals for the whole session.
+	* Besides built-in counters (PerfCounterId) subsystems may register their own, e.g. one per ECS event type.
+	*/
+	class PerfCounters {
+	public:
+		static PerfCounters& instance();
+		PerfCounters(const PerfCounters&) = delete;
+		void add(PerfCounterId id, uint64_t value = 1) { add(static_cast<size_t>(id), value); };
+		void add(size_t index, uint64_t value = 1) { _current[index].fetch_add(value, std::memory_order_relaxed); };
+		void countDraw(const sf::Texture* texture, size_t vertices); // main thread only
+		size_t registerCounter(const std::string& name);
+		void endFrame();
+		size_t getCounterCount() const;
+		const std::string& getCounterName(size_t index) const;
+		uint64_t getLastFrameValue(size_t index) const { return _lastFrame[index]; };
+		uint64_t getLastFrameValue(PerfCounterId id) const { return _lastFrame[static_cast<size_t>(id)]; };
+		uint64_t getTotal(size_t index) const { return _totals[index]; };
+		uint64_t getFrameCount() const { return _frameCount; };
+		void formatLastFrame(std::string& out) const;
+		void formatTotals(std::string& out) const;
+		static void countAllocation() { _allocations.fetch_add(1, std::memory_order_relaxed); };
+		/// False if this build doesn't hook operator new, PerfCounterId::Allocations then stays 0
+		static bool isCountingAllocations();
+	private:
+		PerfCounters();
+
+		std::atomic<uint64_t> _current[perfCountersCapacity + 1]; // plus overflow slot
+		uint64_t _lastFrame[perfCountersCapacity + 1];
+		uint64_t _totals[perfCountersCapacity + 1];
+		uint64_t _frameCount;
+		std::vector<std::string> _names;
+		mutable std::mutex _namesMutex;
+		const sf::Texture* _lastBoundTexture;
+		uint64_t _allocationsAtFrameStart;
+		// Plain global rather than registry member, because operator new may run before registry exists
+		static std::atomic<uint64_t> _allocations;
+	};
+
+	std::string cleanTypeName(const char* typeName);
+
+	/// Counter of emitted events of given type, registered on first use
+	template<typename Event>
+	size_t eventCounterIndex() {
+		static const size_t index = PerfCounters::instance().registerCounter("Event " + cleanTypeName(typeid(Event).name()));
+		return index;
+	}
+
+} // namespace Archipelago
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include "profiler.h"
+
+namespace Archipelago {
+
+	const size_t profilerSamplesCapacity{ 1 << 16 }; /// must be power of two
+	const size_t profilerHistoryCapacity{ 512 }; /// frames kept for percentiles and graph
+
+	const char* const profileZoneNames[profileZoneCount] = {
+		"Frame", "ProcessEvents", "ProcessInput", "Update", "WorldTick", "RenderMap", "RenderUi", "Display", "Job", "Simulation"
+	};
+
+	namespace {
+		int64_t steadyMicroseconds() {
+			return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		uint32_t currentThreadId() {
+			static std::atomic<uint32_t> nextThreadId{ 0 };
+			thread_local uint32_t threadId = nextThreadId++;
+			return threadId;
+		}
+	}
+
+}
+
+using namespace Archipelago;
+
+Profiler& Profiler::instance() {
+	static Profiler profiler;
+	return profiler;
+}
+
+Profiler::Profiler() :
+	_epoch(steadyMicroseconds()),
+	_slots(new Slot[profilerSamplesCapacity]),
+	_writeIndex(0),
+	_readIndex(0),
+	_history(profilerHistoryCapacity * profileZoneCount, 0.0f),
+	_historyPos(0),
+	_historyCount(0),
+	_frameHistorySum(0.0) {
+	for (size_t i = 0; i < profilerSamplesCapacity; i++) {
+		_slots[i].sequence.store(0, std::memory_order_relaxed);
+	}
+	std::fill(std::begin(_currentFrameTotals), std::end(_currentFrameTotals), 0);
+	_percentileScratch.reserve(profilerHistoryCapacity);
+}
+
+int64_t Profiler::now() const {
+	return steadyMicroseconds() - _epoch;
+}
+
+void Profiler::record(ProfileZoneId zone, int64_t startUs, int64_t durationUs) {
+	uint64_t index = _writeIndex.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = _slots[index & (profilerSamplesCapacity - 1)];
+	slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.zoneAndThread.store((static_cast<uint64_t>(currentThreadId()) << 8) | static_cast<uint64_t>(zone), std::memory_order_relaxed);
+	slot.startUs.store(startUs, std::memory_order_relaxed);
+	slot.durationUs.store(durationUs, std::memory_order_relaxed);
+	slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+bool Profiler::_readSlot(uint64_t index, Sample& sample) const {
+	const Slot& slot = _slots[index & (profilerSamplesCapacity - 1)];
+	if (slot.sequence.load(std::memory_order_acquire) != 2 * index + 2) {
+		return false; // not written yet or already overwritten by newer sample
+	}
+	uint64_t zoneAndThread = slot.zoneAndThread.load(std::memory_order_relaxed);
+	sample.startUs = slot.startUs.load(std::memory_order_relaxed);
+	sample.durationUs = slot.durationUs.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (slot.sequence.load(std::memory_order_relaxed) != 2 * index + 2) {
+		return false; // overwritten while reading
+	}
+	sample.zone = static_cast<ProfileZoneId>(zoneAndThread & 0xFF);
+	sample.threadId = static_cast<uint32_t>(zoneAndThread >> 8);
+	return true;
+}
+
+template<typename Fn>
+void Profiler::_forEachStoredSample(Fn fn) const {
+	uint64_t end = _writeIndex.load(std::memory_order_acquire);
+	uint64_t begin = end > profilerSamplesCapacity ? end - profilerSamplesCapacity : 0;
+	Sample sample;
+	for (uint64_t i = begin; i < end; i++) {
+		if (_readSlot(i, sample)) {
+			fn(sample);
+		}
+	}
+}
+
+void Profiler::endFrame() {
+	uint64_t end = _writeIndex.load(std::memory_order_acquire);
+	if (end - _readIndex > profilerSamplesCapacity) {
+		_readIndex = end - profilerSamplesCapacity; // samples were overwritten before we got to them
+	}
+	Sample sample;
+	for (; _readIndex < end; _readIndex++) {
+		uint64_t sequence = _slots[_readIndex & (profilerSamplesCapacity - 1)].sequence.load(std::memory_order_acquire);
+		if (sequence < 2 * _readIndex + 2) break; // still being written, pick it up next frame
+		if (!_readSlot(_readIndex, sample)) continue; // overwritten by newer sample
+		_currentFrameTotals[static_cast<size_t>(sample.zone)] += sample.durationUs;
+	}
+
+	float* frame = &_history[_historyPos * profileZoneCount];
+	if (_historyCount == profilerHistoryCapacity) {
+		_frameHistorySum -= frame[static_cast<size_t>(ProfileZoneId::Frame)];
+	}
+	for (size_t zone = 0; zone < profileZoneCount; zone++) {
+		frame[zone] = _currentFrameTotals[zone] / 1000.0f;
+		_currentFrameTotals[zone] = 0;
+	}
+	_frameHistorySum += frame[static_cast<size_t>(ProfileZoneId::Frame)];
+	_historyPos = (_historyPos + 1) % profilerHistoryCapacity;
+	_historyCount = std::min(_historyCount + 1, profilerHistoryCapacity);
+}
+
+float Profiler::getHistoryValue(ProfileZoneId zone, size_t age) const {
+	if (age >= _historyCount) return 0.0f;
+	size_t pos = (_historyPos + profilerHistoryCapacity - 1 - age) % profilerHistoryCapacity;
+	return _history[pos * profileZoneCount + static_cast<size_t>(zone)];
+}
+
+ProfileZoneStats Profiler::getZoneStats(ProfileZoneId zone) const {
+	ProfileZoneStats stats{ 0.0f, 0.0f, 0.0f };
+	if (_historyCount == 0) return stats;
+	_percentileScratch.clear();
+	for (size_t age = 0; age < _historyCount; age++) {
+		_percentileScratch.push_back(getHistoryValue(zone, age));
+	}
+	auto nth = [this](float percentile) {
+		size_t n = static_cast<size_t>(percentile * (_percentileScratch.size() - 1));
+		std::nth_element(_percentileScratch.begin(), _percentileScratch.begin() + n, _percentileScratch.end());
+		return _percentileScratch[n];
+	};
+	stats.p50 = nth(0.5f);
+	stats.p99 = nth(0.99f);
+	stats.max = *std::max_element(_percentileScratch.begin(), _percentileScratch.end());
+	return stats;
+}
+
+float Profiler::getAverageFrameTime() const {
+	if (_historyCount == 0) return 0.0f;
+	return static_cast<float>(_frameHistorySum / _historyCount);
+}
+
+bool Profiler::exportCSV(const std::string& filename) const {
+	std::ofstream file(filename, std::ios::trunc);
+	if (file.fail()) return false;
+	file << "zone,thread,start_us,duration_us\n";
+	_forEachStoredSample([&](const Sample& s) {
+		file << getZoneName(s.zone) << ',' << s.threadId << ',' << s.startUs << ',' << s.durationUs << '\n';
+	});
+	return !file.fail();
+}
+
+bool Profiler::exportChromeTrace(const std::string& filename) const {
+	// Trace Event Format, loadable by chrome://tracing and Perfetto
+	std::ofstream file(filename, std::ios::trunc);
+	if (file.fail()) return false;
+	file << "{\"traceEvents\":[";
+	bool first = true;
+	_forEachStoredSample([&](const Sample& s) {
+		file << (first ? "\n" : ",\n");
+		file << "{\"name\":\"" << getZoneName(s.zone) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.threadId
+			<< ",\"ts\":" << s.startUs << ",\"dur\":" << s.durationUs << "}";
+		first = false;
+	});
+	file << "\n]}\n";
+	return !file.fail();
+}
+
+const char* Profiler::getZoneName(ProfileZoneId zone) {
+	return profileZoneNames[static_cast<size_t>(zone)];
+}
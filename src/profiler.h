@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Archipelago {
+
+	enum class ProfileZoneId : uint8_t { Frame = 0, ProcessEvents, ProcessInput, Update, WorldTick, RenderMap, RenderUi, Display, Job, Simulation, _Count };
+	const size_t profileZoneCount{ static_cast<size_t>(ProfileZoneId::_Count) };
+
+	/// Per-zone frame time statistics over profiler history window, in milliseconds
+	struct ProfileZoneStats {
+		float p50;
+		float p99;
+		float max;
+	};
+
+	/** Collects timings of scoped zones.
+	* Zones may be recorded from any thread: samples go into a fixed size lock-free ring buffer,
+	* which is drained once per frame by the main thread (endFrame) into per-zone frame history.
+	* The raw ring buffer contents (last samplesCapacity samples) can be exported for offline analysis.
+	*/
+	class Profiler {
+	public:
+		static Profiler& instance();
+		Profiler(const Profiler&) = delete;
+		int64_t now() const; // microseconds since profiler creation
+		void record(ProfileZoneId zone, int64_t startUs, int64_t durationUs);
+		void endFrame();
+		ProfileZoneStats getZoneStats(ProfileZoneId zone) const;
+		float getAverageFrameTime() const; // milliseconds
+		size_t getHistorySize() const { return _historyCount; };
+		float getHistoryValue(ProfileZoneId zone, size_t age) const; // age 0 is the last completed frame
+		bool exportCSV(const std::string& filename) const;
+		bool exportChromeTrace(const std::string& filename) const;
+		static const char* getZoneName(ProfileZoneId zone);
+	private:
+		Profiler();
+
+		struct Sample {
+			ProfileZoneId zone;
+			uint32_t threadId;
+			int64_t startUs;
+			int64_t durationUs;
+		};
+		struct Slot {
+			std::atomic<uint64_t> sequence; // 2*index+1 while being written, 2*index+2 when complete
+			std::atomic<uint64_t> zoneAndThread;
+			std::atomic<int64_t> startUs;
+			std::atomic<int64_t> durationUs;
+		};
+		bool _readSlot(uint64_t index, Sample& sample) const;
+		template<typename Fn> void _forEachStoredSample(Fn fn) const;
+
+		int64_t _epoch;
+		std::unique_ptr<Slot[]> _slots;
+		std::atomic<uint64_t> _writeIndex;
+		uint64_t _readIndex; // main thread only
+
+		// Main thread only: per-zone totals of every frame, ring buffer of historyCapacity frames
+		std::vector<float> _history; // [frame][zone]
+		size_t _historyPos;
+		size_t _historyCount;
+		double _frameHistorySum;
+		int64_t _currentFrameTotals[profileZoneCount];
+		mutable std::vector<float> _percentileScratch;
+	};
+
+	/// RAII timer recording its lifetime as a sample of given zone
+	class ProfileZone {
+	public:
+		explicit ProfileZone(ProfileZoneId zone) : _zone(zone), _startUs(Profiler::instance().now()) {};
+		ProfileZone(const ProfileZone&) = delete;
+		~ProfileZone() {
+			Profiler& profiler = Profiler::instance();
+			profiler.record(_zone, _startUs, profiler.now() - _startUs);
+		}
+	private:
+		ProfileZoneId _zone;
+		int64_t _startUs;
+	};
+
+} // namespace Archipelago
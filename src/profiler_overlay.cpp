@@ -0,0 +1,115 @@
+#include <cstdio>
+#include "profiler_overlay.h"
+#include "profiler.h"
+#include "perf_counters.h"
+
+namespace Archipelago {
+
+	const float profilerOverlayRefreshInterval{ 0.25f }; /// seconds between table updates
+	const float profilerOverlayMargin{ 10.0f };
+	const float profilerOverlayWidth{ 420.0f };
+	const float profilerGraphHeight{ 100.0f };
+	const float profilerGraphScale{ 3.0f }; /// pixels per millisecond
+	const float profilerGraphTargetFrameTime{ 1000.0f / 60.0f }; /// milliseconds
+	const unsigned int profilerOverlayFontSize{ 12 };
+
+}
+
+using namespace Archipelago;
+
+ProfilerOverlay::ProfilerOverlay() :
+	_isVisible(false),
+	_timeSinceRefresh(profilerOverlayRefreshInterval),
+	_graph(sf::Lines) {
+	_background.setFillColor(sf::Color(0, 0, 0, 180));
+	_text.setCharacterSize(profilerOverlayFontSize);
+	_text.setFillColor(sf::Color::White);
+	_textBuffer.reserve(1024);
+}
+
+bool ProfilerOverlay::loadFont(const std::string& filename) {
+	if (!_font.loadFromFile(filename)) {
+		return false;
+	}
+	_text.setFont(_font);
+	return true;
+}
+
+void ProfilerOverlay::update(float seconds) {
+	if (!_isVisible) return;
+	_timeSinceRefresh += seconds;
+	if (_timeSinceRefresh >= profilerOverlayRefreshInterval) {
+		_refreshText();
+		_timeSinceRefresh = 0;
+	}
+	_rebuildGraph();
+}
+
+void ProfilerOverlay::render(sf::RenderWindow& window) {
+	if (!_isVisible) return;
+	sf::View worldView = window.getView();
+	sf::Vector2u windowSize = window.getSize();
+	window.setView(sf::View(sf::FloatRect(0.0f, 0.0f, static_cast<float>(windowSize.x), static_cast<float>(windowSize.y))));
+	window.draw(_background);
+	window.draw(_graph);
+	window.draw(_text);
+	window.setView(worldView);
+}
+
+void ProfilerOverlay::_refreshText() {
+	const Profiler& profiler = Profiler::instance();
+	char line[128];
+	_textBuffer = "Zone               p50      p99      max   (ms)\n";
+	for (size_t zone = 0; zone < profileZoneCount; zone++) {
+		ProfileZoneStats stats = profiler.getZoneStats(static_cast<ProfileZoneId>(zone));
+		std::snprintf(line, sizeof(line), "%-15s %7.2f  %7.2f  %7.2f\n", Profiler::getZoneName(static_cast<ProfileZoneId>(zone)), stats.p50, stats.p99, stats.max);
+		_textBuffer += line;
+	}
+	const PerfCounters& counters = PerfCounters::instance();
+	_textBuffer += "\nCounters (last frame)\n";
+	size_t counterCount = counters.getCounterCount();
+	for (size_t i = 0; i < counterCount; i++) {
+		std::snprintf(line, sizeof(line), "%-30s %10llu\n", counters.getCounterName(i).c_str(), static_cast<unsigned long long>(counters.getLastFrameValue(i)));
+		_textBuffer += line;
+	}
+	// Idle time is reported by workers only, busy time also includes jobs run by threads waiting for them
+	uint64_t busyUs = counters.getLastFrameValue(PerfCounterId::JobBusyMicroseconds);
+	uint64_t idleUs = counters.getLastFrameValue(PerfCounterId::WorkerIdleMicroseconds);
+	if (busyUs + idleUs > 0) {
+		std::snprintf(line, sizeof(line), "\nJob threads busy %.0f%%\n", 100.0 * busyUs / (busyUs + idleUs));
+		_textBuffer += line;
+	}
+	_text.setString(_textBuffer);
+}
+
+void ProfilerOverlay::_rebuildGraph() {
+	const Profiler& profiler = Profiler::instance();
+	size_t frames = profiler.getHistorySize();
+	float graphWidth = profilerOverlayWidth - 2 * profilerOverlayMargin;
+	if (frames > static_cast<size_t>(graphWidth)) {
+		frames = static_cast<size_t>(graphWidth);
+	}
+	float textHeight = _text.getLocalBounds().height;
+	float baseline = 2 * profilerOverlayMargin + textHeight + profilerGraphHeight;
+	float right = profilerOverlayMargin + graphWidth;
+
+	_text.setPosition(profilerOverlayMargin, profilerOverlayMargin);
+	_background.setPosition(0.0f, 0.0f);
+	_background.setSize(sf::Vector2f(profilerOverlayWidth, baseline + profilerOverlayMargin));
+
+	_graph.clear();
+	for (size_t age = 0; age < frames; age++) {
+		float frameTime = profiler.getHistoryValue(ProfileZoneId::Frame, age);
+		float height = frameTime * profilerGraphScale;
+		if (height > profilerGraphHeight) height = profilerGraphHeight;
+		sf::Color color = frameTime > 2 * profilerGraphTargetFrameTime ? sf::Color::Red :
+			(frameTime > profilerGraphTargetFrameTime ? sf::Color::Yellow : sf::Color::Green);
+		float x = right - static_cast<float>(age);
+		_graph.append(sf::Vertex(sf::Vector2f(x, baseline), color));
+		_graph.append(sf::Vertex(sf::Vector2f(x, baseline - height), color));
+	}
+	// Target frame time guideline
+	float targetY = baseline - profilerGraphTargetFrameTime * profilerGraphScale;
+	_graph.append(sf::Vertex(sf::Vector2f(profilerOverlayMargin, targetY), sf::Color::White));
+	_graph.append(sf::Vertex(sf::Vector2f(right, targetY), sf::Color::White));
+}
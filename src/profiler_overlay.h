@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <SFML/Graphics.hpp>
+
+namespace Archipelago {
+
+	/** On-screen profiler view: frame time graph, p50/p99/max table of every profile zone and perf counters.
+	* Drawn in screen space on top of everything, toggled with F3.
+	*/
+	class ProfilerOverlay {
+	public:
+		ProfilerOverlay();
+		bool loadFont(const std::string& filename);
+		void toggle() { _isVisible = !_isVisible; };
+		bool isVisible() const { return _isVisible; };
+		void update(float seconds);
+		void render(sf::RenderWindow& window);
+	private:
+		void _refreshText();
+		void _rebuildGraph();
+
+		bool _isVisible;
+		float _timeSinceRefresh; // seconds
+		sf::Font _font;
+		sf::Text _text;
+		sf::RectangleShape _background;
+		sf::VertexArray _graph;
+		std::string _textBuffer;
+	};
+
+} // namespace Archipelago
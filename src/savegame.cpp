@@ -0,0 +1,45 @@
+#include <cstdint>
+#include "savegame.h"
+#include "binary_stream.h"
+#include "lz_codec.h"
+
+namespace Archipelago {
+
+	const uint32_t saveGameMagic{ 0x53435241 }; // "ARCS"
+	const uint32_t saveGameVersion{ 2 }; // 2: settlements
+
+}
+
+using namespace Archipelago;
+
+void Archipelago::writeSaveGame(const SaveGameSnapshot& snapshot, std::vector<char>& payloadBuffer, std::vector<char>& compressBuffer,
+	std::vector<char>& fileImage) {
+	payloadBuffer.clear();
+	BinaryWriter payload(payloadBuffer);
+	payload.writeString(snapshot.mapFileName);
+	payload.write<uint32_t>(snapshot.gameTime);
+	payload.write<uint32_t>(snapshot.gameMonthDuration);
+	payload.write<uint32_t>(static_cast<uint32_t>(snapshot.settlementWares.size()));
+	for (const std::vector<WaresStack>& wares : snapshot.settlementWares) {
+		payload.write<uint32_t>(static_cast<uint32_t>(wares.size()));
+		for (const WaresStack& ws : wares) {
+			payload.write<uint32_t>(static_cast<uint32_t>(ws.type));
+			payload.write<int32_t>(ws.amount);
+		}
+	}
+	payload.write<uint32_t>(static_cast<uint32_t>(snapshot.buildings.size()));
+	for (const PlacedBuilding& pb : snapshot.buildings) {
+		payload.write<uint32_t>(static_cast<uint32_t>(pb.type));
+		payload.write<uint32_t>(pb.x);
+		payload.write<uint32_t>(pb.y);
+		payload.write<uint32_t>(pb.owner);
+	}
+
+	LzCodec::compress(payloadBuffer.data(), payloadBuffer.size(), compressBuffer);
+	fileImage.clear();
+	BinaryWriter file(fileImage);
+	file.write<uint32_t>(saveGameMagic);
+	file.write<uint32_t>(saveGameVersion);
+	file.write<uint32_t>(static_cast<uint32_t>(payloadBuffer.size()));
+	file.writeBytes(compressBuffer.data(), compressBuffer.size());
+}
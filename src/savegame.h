@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "wares_specification.h"
+#include "building_specification.h"
+#include "settlement.h"
+
+namespace Archipelago {
+
+	/// Building placed by the player or an AI settlement, i.e. a delta against the map file the game was started from
+	struct PlacedBuilding {
+		BuildingTypeId type;
+		unsigned int x;
+		unsigned int y;
+		SettlementId owner;
+	};
+
+	/** Immutable copy of the game state which is worth saving.
+	* Captured from simulation state between game months, on the simulation thread (see Simulation::captureSaveGame()),
+	* and then handed over to the autosave worker, so nothing in it may point into live game objects.
+	*/
+	struct SaveGameSnapshot {
+		std::string mapFileName;
+		unsigned int gameTime; // Months since game start
+		unsigned int gameMonthDuration; // Game month duration in realtime seconds
+		std::vector<std::vector<WaresStack>> settlementWares; // by settlement id
+		std::vector<PlacedBuilding> buildings;
+	};
+
+	/** Serializes snapshot into compressed save file image (header + LZ compressed payload).
+	* Buffers are caller-owned, so that a caller saving repeatedly reuses their capacity
+	*/
+	void writeSaveGame(const SaveGameSnapshot& snapshot, std::vector<char>& payloadBuffer, std::vector<char>& compressBuffer,
+		std::vector<char>& fileImage);
+
+} // namespace Archipelago
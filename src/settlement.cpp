@@ -0,0 +1,42 @@
+#include "settlement.h"
+
+using namespace Archipelago;
+
+Settlement::Settlement(SettlementId id) : _id(id) {
+	_wares.reserve(waresTypeCount - 1);
+	for (WaresTypeId type : waresTypeIds) {
+		_wares.push_back({ type, 0 });
+	}
+}
+
+bool Settlement::syncWare(size_t index, int amount) {
+	if (index >= _wares.size() || _wares[index].amount == amount) return false;
+	_wares[index].amount = amount;
+	return true;
+}
+
+bool Settlement::hasWaresForBuilding(const BuildingSpecification& bs) const {
+	for (const WaresStack& ware : _wares) {
+		for (const WaresStack& required : bs.waresRequired) {
+			if (ware.type == required.type && ware.amount < required.amount) return false;
+		}
+	}
+	return true;
+}
+
+bool Settlement::hasWareForBuilding(const BuildingSpecification& bs, WaresTypeId ware) const {
+	int amountNeeded{ 0 };
+	for (const WaresStack& required : bs.waresRequired) {
+		if (required.type == ware) {
+			amountNeeded = required.amount;
+		}
+	}
+	for (const WaresStack& settWare : _wares) {
+		if (settWare.type == ware && settWare.amount >= amountNeeded) return true;
+	}
+	return false;
+}
+
+bool Settlement::exceededAllowedBuildingAmount(const BuildingSpecification& bs) const {
+	return bs.maxAllowedOnMap != 0 && getBuildingCount(bs.id) >= bs.maxAllowedOnMap;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "building_specification.h"
+#include "wares_specification.h"
+
+namespace Archipelago {
+
+	/// Index of a settlement in the game and in the simulation, settlements are only ever added
+	typedef uint32_t SettlementId;
+	const SettlementId playerSettlementId{ 0 }; /// settlement of the human player, always the first one
+
+	/** Stockpile, building counts and build selection of one settlement, as the game sees them.
+	* The stockpile mirrors the simulation's one and already includes effects of commands the simulation
+	* hasn't applied yet, so placement rules can be checked right after a building was placed.
+	* Settlements of the player and of AI agents are the same thing, only who issues their commands differs.
+	*/
+	class Settlement {
+	public:
+		/// Stockpile starts with every ware type at zero
+		explicit Settlement(SettlementId id);
+		SettlementId getId() const { return _id; };
+		/// One stack per ware type, WaresTypeId::_First first
+		const std::vector<WaresStack>& getWares() const { return _wares; };
+		/// Overwrites amount from a simulation snapshot. Returns true if it changed
+		bool syncWare(size_t index, int amount);
+		bool hasWaresForBuilding(const BuildingSpecification& bs) const;
+		bool hasWareForBuilding(const BuildingSpecification& bs, WaresTypeId ware) const;
+		/// Buildings with max_allowed_on_map, like the base camp, are limited per settlement
+		bool exceededAllowedBuildingAmount(const BuildingSpecification& bs) const;
+		unsigned int getBuildingCount(BuildingTypeId type) const { return _buildingCounts[static_cast<size_t>(type)]; };
+		/** Takes required wares, adds instant ones and counts the building.
+		* Every change is passed to onWareChange(ware, amount) too, so the caller can forward it to the simulation
+		*/
+		template<typename Fn>
+		void addBuilding(const BuildingSpecification& bs, const Fn& onWareChange) {
+			for (WaresStack& ware : _wares) {
+				for (const WaresStack& required : bs.waresRequired) {
+					if (ware.type == required.type) {
+						ware.amount -= required.amount;
+						onWareChange(ware.type, -required.amount);
+					}
+				}
+				for (const WaresStack& provided : bs.providedInstantWares) {
+					if (ware.type == provided.type) {
+						ware.amount += provided.amount;
+						onWareChange(ware.type, provided.amount);
+					}
+				}
+			}
+			++_buildingCounts[static_cast<size_t>(bs.id)];
+		}
+		BuildingTypeId getSelectedForBuilding() const { return _selectedForBuilding; };
+		void setSelectedForBuilding(BuildingTypeId type) { _selectedForBuilding = type; };
+	private:
+		SettlementId _id;
+		std::vector<WaresStack> _wares;
+		unsigned int _buildingCounts[buildingTypeCount]{};
+		BuildingTypeId _selectedForBuilding{ BuildingTypeId::Unknown };
+	};
+
+} // namespace Archipelago
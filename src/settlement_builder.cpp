@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdlib>
+#include "settlement_builder.h"
+
+using namespace Archipelago;
+
+namespace {
+
+	bool hasResource(uint32_t resourceSet, NaturalResourceTypeId type) {
+		for (; resourceSet; resourceSet >>= 8) {
+			if (static_cast<NaturalResourceTypeId>(resourceSet & 0xFF) == type) return true;
+		}
+		return false;
+	}
+
+}
+
+SettlementBuilder::SettlementBuilder(SettlementWorld& world, SettlementId settlement, uint32_t seed) :
+	_world(world),
+	_settlement(settlement),
+	_random(seed),
+	_hasCenter(false),
+	_centerX(0),
+	_centerY(0),
+	_searchRadius(builderSearchRadius),
+	_placedCount(0) {
+	_candidates.reserve(buildingTypeCount);
+}
+
+bool SettlementBuilder::step() {
+	const Settlement& settlement = _world.getSettlement(_settlement);
+	_candidates.clear();
+	for (BuildingTypeId type : buildingTypeIds) {
+		const BuildingSpecification& bs = _world.getBuildingSpecification(type);
+		if (settlement.hasWaresForBuilding(bs) && !settlement.exceededAllowedBuildingAmount(bs)) {
+			_candidates.push_back(type);
+		}
+	}
+	// Fewest built first keeps production of the settlement balanced, ids break ties so steps are repeatable.
+	// Plain sort with ids in the key gives the same order as a stable one without its temporary buffer
+	std::sort(_candidates.begin(), _candidates.end(), [&settlement](BuildingTypeId a, BuildingTypeId b) {
+		unsigned int countA = settlement.getBuildingCount(a), countB = settlement.getBuildingCount(b);
+		return countA < countB || (countA == countB && a < b);
+	});
+	for (BuildingTypeId type : _candidates) {
+		const BuildingSpecification& bs = _world.getBuildingSpecification(type);
+		unsigned int tileX, tileY;
+		if (!_findSite(bs, tileX, tileY)) continue;
+		if (!_world.placeBuilding(_settlement, type, tileX, tileY)) {
+			_rejectedSites.insert(tileY * _world.getReachGrid().width + tileX);
+			continue;
+		}
+		if (!_hasCenter) {
+			_hasCenter = true;
+			_centerX = tileX;
+			_centerY = tileY;
+		}
+		++_placedCount;
+		return true;
+	}
+	return false;
+}
+
+size_t SettlementBuilder::run(size_t maxSteps) {
+	size_t placed = 0;
+	while (placed < maxSteps && step()) {
+		++placed;
+	}
+	return placed;
+}
+
+bool SettlementBuilder::_findSite(const BuildingSpecification& bs, unsigned int& tileX, unsigned int& tileY) {
+	if (!_hasCenter) return _findStartSite(bs, tileX, tileY);
+	const LogisticsGrid& grid = _world.getReachGrid();
+	for (;;) {
+		unsigned int x0 = _centerX > _searchRadius ? _centerX - _searchRadius : 0;
+		unsigned int y0 = _centerY > _searchRadius ? _centerY - _searchRadius : 0;
+		unsigned int x1 = std::min(_centerX + _searchRadius, grid.width - 1);
+		unsigned int y1 = std::min(_centerY + _searchRadius, grid.height - 1);
+		int bestScore = 0;
+		bool found = false;
+		// No tile can have more resources in reach than there are tiles in reach
+		int maxResourceScore = bs.natresRequired == NaturalResourceTypeId::Unknown ? 0 : static_cast<int>((2 * bs.natresRadius + 1) * (2 * bs.natresRadius + 1) * builderResourceWeight);
+		for (unsigned int y = y0; y <= y1; y++) {
+			for (unsigned int x = x0; x <= x1; x++) {
+				int distance = std::abs(static_cast<int>(x) - static_cast<int>(_centerX)) + std::abs(static_cast<int>(y) - static_cast<int>(_centerY));
+				if (found && maxResourceScore - distance <= bestScore) continue;
+				if (!_isSite(bs, x, y)) continue;
+				int score = static_cast<int>(_countResourcesInReach(bs, x, y) * builderResourceWeight) - distance;
+				if (!found || score > bestScore) {
+					found = true;
+					bestScore = score;
+					tileX = x;
+					tileY = y;
+				}
+			}
+		}
+		if (found) return true;
+		if (_searchRadius >= builderMaxSearchRadius) return false;
+		_searchRadius = std::min(_searchRadius * 2, builderMaxSearchRadius);
+	}
+}
+
+bool SettlementBuilder::_findStartSite(const BuildingSpecification& bs, unsigned int& tileX, unsigned int& tileY) {
+	const LogisticsGrid& grid = _world.getReachGrid();
+	if (grid.cost.empty()) return false;
+	for (unsigned int attempt = 0; attempt < builderStartTries; attempt++) {
+		unsigned int x = static_cast<unsigned int>(_random() % grid.width);
+		unsigned int y = static_cast<unsigned int>(_random() % grid.height);
+		if (!_isSite(bs, x, y)) continue;
+		// Keep clear of other settlements, so that each has room to grow
+		unsigned int x0 = x > builderSearchRadius ? x - builderSearchRadius : 0;
+		unsigned int y0 = y > builderSearchRadius ? y - builderSearchRadius : 0;
+		if (_world.anyBuildingInRect(x0, y0, x + builderSearchRadius, y + builderSearchRadius)) continue;
+		tileX = x;
+		tileY = y;
+		return true;
+	}
+	return false;
+}
+
+bool SettlementBuilder::_isSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const {
+	const LogisticsGrid& grid = _world.getReachGrid();
+	uint32_t tile = tileY * grid.width + tileX;
+	// Wares of buildings on water would never reach a storage
+	if (grid.cost[tile] == impassableTileCost || (!_rejectedSites.empty() && _rejectedSites.count(tile))) return false;
+	return _world.isBuildingSite(bs, tileX, tileY);
+}
+
+unsigned int SettlementBuilder::_countResourcesInReach(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const {
+	if (bs.natresRequired == NaturalResourceTypeId::Unknown) return 0;
+	const LogisticsGrid& grid = _world.getReachGrid();
+	unsigned int radius = bs.natresRadius;
+	unsigned int x0 = tileX > radius ? tileX - radius : 0;
+	unsigned int y0 = tileY > radius ? tileY - radius : 0;
+	unsigned int x1 = std::min(tileX + radius, grid.width - 1);
+	unsigned int y1 = std::min(tileY + radius, grid.height - 1);
+	unsigned int count = 0;
+	for (unsigned int y = y0; y <= y1; y++) {
+		for (unsigned int x = x0; x <= x1; x++) {
+			if (hasResource(_world.getTileResources(x, y), bs.natresRequired)) ++count;
+		}
+	}
+	return count;
+}
+
+void PlannedSettlementWorld::begin(size_t settlementCount) {
+	_placements.clear();
+	_plannedTiles.clear();
+	for (size_t id = 0; id < settlementCount; id++) {
+		const Settlement& settlement = _world.getSettlement(static_cast<SettlementId>(id));
+		if (id < _settlements.size()) {
+			_settlements[id] = settlement; // reuses stockpile storage
+		}
+		else {
+			_settlements.push_back(settlement);
+		}
+	}
+}
+
+bool PlannedSettlementWorld::anyBuildingInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const {
+	if (_world.anyBuildingInRect(x0, y0, x1, y1)) return true;
+	for (const PlannedBuilding& planned : _placements) {
+		if (planned.x >= x0 && planned.x <= x1 && planned.y >= y0 && planned.y <= y1) return true;
+	}
+	return false;
+}
+
+bool PlannedSettlementWorld::isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const {
+	if (!_world.isBuildingSite(bs, tileX, tileY)) return false;
+	uint32_t tile = tileY * _world.getReachGrid().width + tileX;
+	return !std::binary_search(_plannedTiles.begin(), _plannedTiles.end(), tile);
+}
+
+bool PlannedSettlementWorld::placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) {
+	if (settlementId >= _settlements.size()) return false;
+	Settlement& settlement = _settlements[settlementId];
+	const BuildingSpecification& bs = _world.getBuildingSpecification(buildingID);
+	if (!settlement.hasWaresForBuilding(bs) || settlement.exceededAllowedBuildingAmount(bs)) return false;
+	if (!isBuildingSite(bs, tileX, tileY)) return false;
+	settlement.addBuilding(bs, [](WaresTypeId, int) {});
+	_placements.push_back({ settlementId, buildingID, tileX, tileY });
+	uint32_t tile = tileY * _world.getReachGrid().width + tileX;
+	_plannedTiles.insert(std::upper_bound(_plannedTiles.begin(), _plannedTiles.end(), tile), tile);
+	return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <unordered_set>
+#include <vector>
+#include "building_specification.h"
+#include "hierarchical_pathfinder.h"
+#include "settlement.h"
+
+namespace Archipelago {
+
+	const unsigned int builderSearchRadius{ 8 }; /// tiles around settlement center searched for building sites at first
+	const unsigned int builderMaxSearchRadius{ 64 }; /// search area grows up to this when the settlement runs out of sites
+	const unsigned int builderStartTries{ 4096 }; /// random tiles tried for the first building
+	const unsigned int builderResourceWeight{ 4 }; /// tile score of a required resource in reach, against one tile of distance from center
+	const size_t aiStepsPerMonth{ 16 }; /// buildings an AI settlement may place every game month
+
+	/** What a settlement builder sees of the world and does in it. The game implements it on its map and settlements,
+	* balance sweeps on a bare map and a single economy, so that both are expanded by the very same builder.
+	*/
+	class SettlementWorld {
+	public:
+		virtual ~SettlementWorld() {};
+		virtual const Settlement& getSettlement(SettlementId id) const = 0;
+		virtual const BuildingSpecification& getBuildingSpecification(BuildingTypeId type) const = 0;
+		/// Terrain costs of the map, empty if there is no map
+		virtual const LogisticsGrid& getReachGrid() const = 0;
+		/// Natural resources of the tile, one type id per byte as in map files
+		virtual uint32_t getTileResources(unsigned int tileX, unsigned int tileY) const = 0;
+		/// True if a building of any settlement stands within the inclusive rectangle
+		virtual bool anyBuildingInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const = 0;
+		/// Placement rules of the tile alone, i.e. for a settlement which can afford the building. Checked for many tiles, so it shouldn't be expensive
+		virtual bool isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const = 0;
+		/// Returns false if the building can't be placed after all
+		virtual bool placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) = 0;
+	};
+
+	/** Greedy AI which expands one settlement, for AI opponents, balance sweeps and as load generator for benchmarks.
+	* Every step takes the building types the settlement can afford and may still build, fewest built first,
+	* and places the first of them which has a site: the tile within the search area around the settlement
+	* center with most of the required natural resource in reach and closest to the center.
+	* Sites are checked with the same rules as player buildings, on map layers only, so headless
+	* settlements take thousands of steps per second. Given the same seed and game, steps are the same.
+	*/
+	class SettlementBuilder {
+	public:
+		SettlementBuilder(SettlementWorld& world, SettlementId settlement, uint32_t seed);
+		SettlementBuilder(const SettlementBuilder&) = delete;
+		/// Places one building. Returns false if the settlement can't afford anything or has no site for it
+		bool step();
+		/// Steps until nothing more can be placed or maxSteps buildings were placed, returns number placed
+		size_t run(size_t maxSteps);
+		SettlementId getSettlement() const { return _settlement; };
+		size_t getPlacedCount() const { return _placedCount; };
+	private:
+		bool _findSite(const BuildingSpecification& bs, unsigned int& tileX, unsigned int& tileY);
+		bool _findStartSite(const BuildingSpecification& bs, unsigned int& tileX, unsigned int& tileY);
+		bool _isSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const;
+		/// Required resource tiles within natres radius of the tile
+		unsigned int _countResourcesInReach(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const;
+
+		SettlementWorld& _world;
+		SettlementId _settlement;
+		std::mt19937 _random;
+		bool _hasCenter;
+		unsigned int _centerX;
+		unsigned int _centerY;
+		unsigned int _searchRadius;
+		size_t _placedCount;
+		std::unordered_set<uint32_t> _rejectedSites; // passed the site rules but the world refused them
+		std::vector<BuildingTypeId> _candidates; // reused
+	};
+
+	/// Building a builder placed into a PlannedSettlementWorld, for the owner of the world to place for real
+	struct PlannedBuilding {
+		SettlementId settlement;
+		BuildingTypeId type;
+		unsigned int x;
+		unsigned int y;
+	};
+
+	/** Lets builders run on another thread than the one owning the world, e.g. on the job system while the game renders.
+	* The world is only read, and must not change until the plan is done. Placements go into the plan alone: planned
+	* buildings and copies of settlement stockpiles are laid over the world, so every step sees the steps before it.
+	* The owner places planned buildings for real afterwards, checking its rules once more.
+	*/
+	class PlannedSettlementWorld : public SettlementWorld {
+	public:
+		explicit PlannedSettlementWorld(SettlementWorld& world) : _world(world) {};
+		PlannedSettlementWorld(const PlannedSettlementWorld&) = delete;
+		/// Owner thread. Empties the plan and copies state of settlements with ids below settlementCount
+		void begin(size_t settlementCount);
+		const std::vector<PlannedBuilding>& getPlacements() const { return _placements; };
+		virtual const Settlement& getSettlement(SettlementId id) const override { return _settlements[id]; };
+		virtual const BuildingSpecification& getBuildingSpecification(BuildingTypeId type) const override { return _world.getBuildingSpecification(type); };
+		virtual const LogisticsGrid& getReachGrid() const override { return _world.getReachGrid(); };
+		virtual uint32_t getTileResources(unsigned int tileX, unsigned int tileY) const override { return _world.getTileResources(tileX, tileY); };
+		virtual bool anyBuildingInRect(unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1) const override;
+		virtual bool isBuildingSite(const BuildingSpecification& bs, unsigned int tileX, unsigned int tileY) const override;
+		virtual bool placeBuilding(SettlementId settlementId, BuildingTypeId buildingID, unsigned int tileX, unsigned int tileY) override;
+	private:
+		SettlementWorld& _world;
+		std::vector<Settlement> _settlements; // by id, copied by begin() into kept storage
+		std::vector<PlannedBuilding> _placements; // in placement order
+		std::vector<uint32_t> _plannedTiles; // sorted, for site checks of every scanned tile
+	};
+
+} // namespace Archipelago
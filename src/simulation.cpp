@@ -0,0 +1,245 @@
+#include <chrono>
+#include <limits>
+#include "simulation.h"
+#include "job_system.h"
+#include "perf_counters.h"
+#include "profiler.h"
+
+namespace Archipelago {
+
+	const std::chrono::milliseconds simulationStepInterval{ 5 }; /// realtime between simulation steps
+	const unsigned int freshSnapshotFlag{ 4 };
+	const size_t logisticsPathBudget{ 32 }; /// route searches per simulation step, the rest waits for following steps
+
+}
+
+using namespace Archipelago;
+
+SimulationCommand SimulationCommand::addSettlement() {
+	SimulationCommand command{};
+	command.type = Type::AddSettlement;
+	return command;
+}
+
+SimulationCommand SimulationCommand::addBuilding(SettlementId settlement, const BuildingSpecification* building, unsigned int tileX, unsigned int tileY) {
+	SimulationCommand command{};
+	command.type = Type::AddBuilding;
+	command.settlement = settlement;
+	command.building = building;
+	command.tileX = tileX;
+	command.tileY = tileY;
+	return command;
+}
+
+SimulationCommand SimulationCommand::changeWare(SettlementId settlement, WaresTypeId ware, int amount) {
+	SimulationCommand command{};
+	command.type = Type::ChangeWare;
+	command.settlement = settlement;
+	command.ware = ware;
+	command.amount = amount;
+	return command;
+}
+
+SimulationCommand SimulationCommand::setMonthDuration(unsigned int monthDuration) {
+	SimulationCommand command{};
+	command.type = Type::SetMonthDuration;
+	command.monthDuration = monthDuration;
+	return command;
+}
+
+Simulation::Simulation(JobSystem* jobSystem, const std::vector<WaresStack>& startingWares, unsigned int monthDuration) :
+	_jobSystem(jobSystem),
+	_startingWares(startingWares),
+	_forecastVersion(1),
+	_gameTime(0),
+	_gameMonthDuration(monthDuration),
+	_accumulatedSeconds(0),
+	_commandsApplied(0),
+	_middleSlot(1),
+	_backSlot(2),
+	_frontSlot(0),
+	_stopRequested(false) {
+	_settlements.emplace_back(_jobSystem, _startingWares); // playerSettlementId
+	_publish();
+	// Every slot holds initial state, so the game never sees an empty snapshot
+	const SimulationSnapshot& initial = _snapshots[_middleSlot.load() & ~freshSnapshotFlag];
+	for (SimulationSnapshot& snapshot : _snapshots) {
+		if (&snapshot != &initial) snapshot = initial;
+	}
+}
+
+Simulation::~Simulation() {
+	stop();
+}
+
+void Simulation::start() {
+	if (isRunning()) return;
+	_stopRequested = false;
+	_thread = std::thread(&Simulation::_threadLoop, this);
+}
+
+void Simulation::stop() {
+	if (!isRunning()) return;
+	_stopRequested = true;
+	_thread.join();
+}
+
+void Simulation::push(const SimulationCommand& command) {
+	while (!_commands.push(command)) {
+		if (isRunning()) {
+			std::this_thread::yield();
+		}
+		else {
+			_applyCommands();
+		}
+	}
+}
+
+const SimulationSnapshot& Simulation::getSnapshot() {
+	if (_middleSlot.load(std::memory_order_relaxed) & freshSnapshotFlag) {
+		_frontSlot = _middleSlot.exchange(_frontSlot, std::memory_order_acq_rel) & ~freshSnapshotFlag;
+	}
+	return _snapshots[_frontSlot];
+}
+
+void Simulation::setLogisticsGrid(LogisticsGrid grid) {
+	_logistics.setGrid(std::move(grid));
+	_updateLogistics(std::numeric_limits<size_t>::max());
+}
+
+void Simulation::refreshSpecifications() {
+	for (SettlementState& settlement : _settlements) {
+		settlement.economy.refreshSpecifications();
+	}
+	++_forecastVersion;
+}
+
+void Simulation::step(float seconds) {
+	_applyCommands();
+	_updateLogistics(logisticsPathBudget);
+	_accumulatedSeconds += seconds;
+	if (_accumulatedSeconds >= _gameMonthDuration) {
+		_advanceMonth();
+	}
+	_publish();
+}
+
+void Simulation::advanceMonth() {
+	_applyCommands();
+	// Every route is found before the tick, so that month results don't depend on step timing
+	_updateLogistics(std::numeric_limits<size_t>::max());
+	_advanceMonth();
+	_publish();
+}
+
+void Simulation::captureSaveGame(SaveGameSnapshot& snapshot) const {
+	snapshot.gameTime = _gameTime;
+	snapshot.gameMonthDuration = _gameMonthDuration;
+	snapshot.settlementWares.clear();
+	for (const SettlementState& settlement : _settlements) {
+		snapshot.settlementWares.push_back(settlement.wares);
+	}
+	snapshot.buildings.clear();
+	snapshot.buildings.reserve(_buildingOwners.size());
+	for (const BuildingOwner& owner : _buildingOwners) { // placement order, which loading replays
+		const EconomyBuilding& building = _settlements[owner.settlement].economy.getBuildings()[owner.economyBuilding];
+		snapshot.buildings.push_back({ building.spec->id, building.x, building.y, owner.settlement });
+	}
+}
+
+void Simulation::_threadLoop() {
+	std::chrono::steady_clock::time_point lastStep = std::chrono::steady_clock::now();
+	while (!_stopRequested) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		{
+			ProfileZone zone(ProfileZoneId::Simulation);
+			step(std::chrono::duration<float>(now - lastStep).count());
+		}
+		lastStep = now;
+		std::this_thread::sleep_until(now + simulationStepInterval);
+	}
+}
+
+void Simulation::_applyCommands() {
+	SimulationCommand command;
+	while (_commands.pop(command)) {
+		switch (command.type) {
+		case SimulationCommand::Type::AddSettlement:
+			_settlements.emplace_back(_jobSystem, _startingWares);
+			break;
+		case SimulationCommand::Type::AddBuilding: {
+			if (command.settlement >= _settlements.size()) break;
+			Economy& economy = _settlements[command.settlement].economy;
+			size_t economyBuilding = economy.getBuildings().size();
+			economy.addBuilding(command.building, command.tileX, command.tileY);
+			size_t building = _logistics.addBuilding(command.tileX, command.tileY, command.building->isStorage, command.settlement);
+			_buildingOwners.push_back({ command.settlement, economyBuilding });
+			economy.setDeliveryMonths(economyBuilding, _logistics.getDeliveryMonths(building));
+			if (command.settlement == playerSettlementId) ++_forecastVersion;
+			break;
+		}
+		case SimulationCommand::Type::ChangeWare:
+			if (command.settlement >= _settlements.size()) break;
+			for (WaresStack& ware : _settlements[command.settlement].wares) {
+				if (ware.type == command.ware) {
+					ware.amount += command.amount;
+				}
+			}
+			break;
+		case SimulationCommand::Type::SetMonthDuration:
+			_gameMonthDuration = command.monthDuration;
+			break;
+		}
+		++_commandsApplied;
+	}
+}
+
+void Simulation::_advanceMonth() {
+	_gameTime++;
+	_accumulatedSeconds = 0;
+	auto tickSettlements = [this](size_t begin, size_t end) {
+		for (size_t settlement = begin; settlement < end; settlement++) {
+			_settlements[settlement].economy.tick(_settlements[settlement].wares);
+		}
+	};
+	if (_jobSystem) {
+		// One settlement per job, economies of big settlements split their own tick further
+		_jobSystem->parallelFor(_settlements.size(), 1, tickSettlements);
+	}
+	else {
+		tickSettlements(0, _settlements.size());
+	}
+	PerfCounters::instance().add(PerfCounterId::EntitiesIterated, _buildingOwners.size());
+	++_forecastVersion;
+	if (_monthCallback) {
+		_monthCallback(_gameTime);
+	}
+}
+
+void Simulation::_updateLogistics(size_t pathBudget) {
+	_logistics.update(pathBudget);
+	for (size_t building : _logistics.getChangedBuildings()) {
+		const BuildingOwner& owner = _buildingOwners[building];
+		_settlements[owner.settlement].economy.setDeliveryMonths(owner.economyBuilding, _logistics.getDeliveryMonths(building));
+		if (owner.settlement == playerSettlementId) ++_forecastVersion;
+	}
+	_logistics.clearChangedBuildings();
+}
+
+void Simulation::_publish() {
+	SimulationSnapshot& snapshot = _snapshots[_backSlot];
+	snapshot.commandsApplied = _commandsApplied;
+	snapshot.gameTime = _gameTime;
+	snapshot.gameMonthDuration = _gameMonthDuration;
+	snapshot.monthProgress = static_cast<unsigned int>(_accumulatedSeconds * 1000.0f);
+	snapshot.buildingCount = _buildingOwners.size();
+	snapshot.settlementWares.resize(_settlements.size()); // settlements are only added, stacks reuse capacity
+	for (size_t settlement = 0; settlement < _settlements.size(); settlement++) {
+		snapshot.settlementWares[settlement] = _settlements[settlement].wares;
+	}
+	if (snapshot.forecastVersion != _forecastVersion) {
+		_settlements[playerSettlementId].economy.captureForecast(snapshot.forecast);
+		snapshot.forecastVersion = _forecastVersion;
+	}
+	_backSlot = _middleSlot.exchange(_backSlot | freshSnapshotFlag, std::memory_order_acq_rel) & ~freshSnapshotFlag;
+}
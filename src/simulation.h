@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "building_specification.h"
+#include "economy.h"
+#include "economy_forecast.h"
+#include "logistics.h"
+#include "savegame.h"
+#include "settlement.h"
+#include "spsc_queue.h"
+#include "wares_specification.h"
+
+namespace Archipelago {
+
+	class JobSystem;
+
+	/// Change of simulation state requested by the game. Only fields relevant to the type are meaningful
+	struct SimulationCommand {
+		enum class Type : uint8_t { AddSettlement, AddBuilding, ChangeWare, SetMonthDuration };
+		Type type;
+		SettlementId settlement; // AddBuilding, ChangeWare
+		const BuildingSpecification* building; // AddBuilding
+		unsigned int tileX; // AddBuilding
+		unsigned int tileY; // AddBuilding
+		WaresTypeId ware; // ChangeWare
+		int amount; // ChangeWare: added to stockpile, may be negative
+		unsigned int monthDuration; // SetMonthDuration: realtime seconds
+
+		/// New settlement gets the next id and the starting stockpile
+		static SimulationCommand addSettlement();
+		static SimulationCommand addBuilding(SettlementId settlement, const BuildingSpecification* building, unsigned int tileX, unsigned int tileY);
+		static SimulationCommand changeWare(SettlementId settlement, WaresTypeId ware, int amount);
+		static SimulationCommand setMonthDuration(unsigned int monthDuration);
+	};
+
+	/// Immutable copy of simulation state for the render thread, published after every simulation step
+	struct SimulationSnapshot {
+		uint64_t commandsApplied{ 0 }; // commands taken from the queue so far
+		unsigned int gameTime{ 0 }; // Months since game start
+		unsigned int gameMonthDuration{ 0 }; // Game month duration in realtime seconds
+		unsigned int monthProgress{ 0 }; // Realtime milliseconds elapsed within current month
+		size_t buildingCount{ 0 };
+		std::vector<std::vector<WaresStack>> settlementWares; // by settlement id
+		uint64_t forecastVersion{ 0 }; // changes whenever forecast does
+		EconomyForecast forecast; // player settlement
+	};
+
+	/** Game time, settlement stockpiles and economies, and logistics.
+	* In the interactive game simulation runs on its own thread, so that month ticks never stall a frame:
+	* the game pushes commands through a lock-free queue and picks up the latest snapshot once per frame.
+	* Snapshots are triple buffered, neither side waits for the other.
+	* Without start() nothing runs by itself and the owner calls step()/advanceMonth() instead,
+	* which is how headless runs and replays stay deterministic.
+	* Every settlement has its own stockpile and economy, and its buildings only deliver to its own storages.
+	* Settlements don't share any state during the month tick, so they are ticked in parallel on the job system.
+	*/
+	class Simulation {
+	public:
+		/// Starts with the player settlement, which gets startingWares like every settlement added later
+		Simulation(JobSystem* jobSystem, const std::vector<WaresStack>& startingWares, unsigned int monthDuration);
+		Simulation(const Simulation&) = delete;
+		~Simulation();
+		void start();
+		void stop();
+		bool isRunning() const { return _thread.joinable(); };
+		/// Game thread only. Never drops a command: waits for free space if the simulation lags behind
+		void push(const SimulationCommand& command);
+		/// Game thread only. Latest published snapshot, stays valid until next call
+		const SimulationSnapshot& getSnapshot();
+		/// Owner only, before start(). Without a grid wares reach storage instantly
+		void setLogisticsGrid(LogisticsGrid grid);
+		/// Owner only, while not running. Specifications were replaced in place, economy rereads what it keeps of them
+		void refreshSpecifications();
+		/// Called on simulation thread after every game month, e.g. for autosaves
+		void setMonthCallback(std::function<void(unsigned int gameTime)> callback) { _monthCallback = std::move(callback); };
+		/// Applies pending commands and advances game time by given realtime seconds
+		void step(float seconds);
+		/// Applies pending commands and advances game time to the next month
+		void advanceMonth();
+		/// Simulation thread (or owner, if not started) only, e.g. from month callback
+		void captureSaveGame(SaveGameSnapshot& snapshot) const;
+	private:
+		void _threadLoop();
+		void _applyCommands();
+		void _advanceMonth();
+		/// Repaths dirty routes and passes new delivery times to the economy
+		void _updateLogistics(size_t pathBudget);
+		void _publish();
+
+		struct SettlementState {
+			SettlementState(JobSystem* jobSystem, const std::vector<WaresStack>& startingWares) : economy(jobSystem), wares(startingWares) {};
+			Economy economy;
+			std::vector<WaresStack> wares;
+		};
+		/// Where a logistics building is kept in the economies
+		struct BuildingOwner {
+			SettlementId settlement;
+			size_t economyBuilding;
+		};
+
+		JobSystem* _jobSystem;
+		std::deque<SettlementState> _settlements; // by settlement id, economies never move
+		std::vector<BuildingOwner> _buildingOwners; // by logistics building index, i.e. in placement order
+		std::vector<WaresStack> _startingWares;
+		uint64_t _forecastVersion; // bumped when player economy changes, snapshots copy the forecast only then
+		Logistics _logistics;
+		unsigned int _gameTime;
+		unsigned int _gameMonthDuration;
+		float _accumulatedSeconds;
+		uint64_t _commandsApplied;
+		std::function<void(unsigned int)> _monthCallback;
+		SpscQueue<SimulationCommand, 1024> _commands;
+
+		// Triple buffer: simulation fills back slot and swaps it with the middle one, game swaps middle one with front
+		SimulationSnapshot _snapshots[3];
+		std::atomic<unsigned int> _middleSlot; // slot index, plus freshSnapshotFlag if not yet taken by the game
+		unsigned int _backSlot; // simulation side
+		unsigned int _frontSlot; // game side
+
+		std::thread _thread;
+		std::atomic<bool> _stopRequested;
+	};
+
+} // namespace Archipelago
@@ -0,0 +1,183 @@
+#include "spec_cache.h"
+#include "binary_stream.h"
+#include "file_utils.h"
+
+namespace Archipelago {
+
+	const uint32_t specCacheMagic{ 0x43505341 }; /// "ASPC"
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	const char* const* generatedKeys(const wares_atlas_t&) { return waresTypeKeys; }
+	const char* const* generatedKeys(const natres_atlas_t&) { return naturalResourceTypeKeys; }
+	const char* const* generatedKeys(const buildings_atlas_t&) { return buildingTypeKeys; }
+
+	void writeWares(BinaryWriter& writer, const std::vector<WaresStack>& wares) {
+		writer.write<uint32_t>(static_cast<uint32_t>(wares.size()));
+		for (const WaresStack& ware : wares) {
+			writer.write<int32_t>(static_cast<int32_t>(ware.type));
+			writer.write<int32_t>(ware.amount);
+		}
+	}
+
+	bool readWares(BinaryReader& reader, std::vector<WaresStack>& wares) {
+		uint32_t count;
+		if (!reader.read(count) || count > reader.remaining() / (2 * sizeof(int32_t))) return false;
+		wares.resize(count);
+		for (WaresStack& ware : wares) {
+			int32_t type, amount;
+			if (!reader.read(type) || !reader.read(amount)) return false;
+			ware.type = static_cast<WaresTypeId>(type);
+			ware.amount = amount;
+		}
+		return true;
+	}
+
+	void writeSpec(BinaryWriter& writer, const WaresSpecification& spec) {
+		writer.writeString(spec.name);
+	}
+
+	bool readSpec(BinaryReader& reader, WaresSpecification& spec) {
+		spec.icon = noTextureHandle;
+		return reader.readString(spec.name);
+	}
+
+	void writeSpec(BinaryWriter& writer, const NaturalResourceSpecification& spec) {
+		writer.writeString(spec.name);
+	}
+
+	bool readSpec(BinaryReader& reader, NaturalResourceSpecification& spec) {
+		spec.icon = noTextureHandle;
+		return reader.readString(spec.name);
+	}
+
+	void writeSpec(BinaryWriter& writer, const BuildingSpecification& spec) {
+		writer.write<int32_t>(static_cast<int32_t>(spec.id));
+		writer.writeString(spec.name);
+		writer.writeString(spec.description);
+		writer.write<uint32_t>(spec.tileRising);
+		writer.write<uint32_t>(spec.maxAllowedOnMap);
+		writer.write<int32_t>(static_cast<int32_t>(spec.natresRequired));
+		writer.write<uint32_t>(spec.natresRadius);
+		writer.write<uint8_t>(spec.isStorage ? 1 : 0);
+		writer.write<uint32_t>(spec.workers);
+		writeWares(writer, spec.waresRequired);
+		writer.write<uint32_t>(static_cast<uint32_t>(spec.buildingsRequired.size()));
+		for (BuildingTypeId required : spec.buildingsRequired) {
+			writer.write<int32_t>(static_cast<int32_t>(required));
+		}
+		writeWares(writer, spec.providedInstantWares);
+		writeWares(writer, spec.waresProduced);
+		writeWares(writer, spec.waresConsumed);
+	}
+
+	bool readSpec(BinaryReader& reader, BuildingSpecification& spec) {
+		int32_t id, natresRequired;
+		uint8_t isStorage;
+		uint32_t requiredCount;
+		spec.icon = noTextureHandle;
+		if (!reader.read(id) || !reader.readString(spec.name) || !reader.readString(spec.description) ||
+			!reader.read(spec.tileRising) || !reader.read(spec.maxAllowedOnMap) || !reader.read(natresRequired) ||
+			!reader.read(spec.natresRadius) || !reader.read(isStorage) || !reader.read(spec.workers) ||
+			!readWares(reader, spec.waresRequired) || !reader.read(requiredCount) || requiredCount > reader.remaining() / sizeof(int32_t)) {
+			return false;
+		}
+		spec.id = static_cast<BuildingTypeId>(id);
+		spec.natresRequired = static_cast<NaturalResourceTypeId>(natresRequired);
+		spec.isStorage = isStorage != 0;
+		spec.buildingsRequired.resize(requiredCount);
+		for (BuildingTypeId& required : spec.buildingsRequired) {
+			int32_t requiredId;
+			if (!reader.read(requiredId)) return false;
+			required = static_cast<BuildingTypeId>(requiredId);
+		}
+		return readWares(reader, spec.providedInstantWares) && readWares(reader, spec.waresProduced) && readWares(reader, spec.waresConsumed);
+	}
+
+	/// Cache layout: magic, version, source hash, generated keys, icon list, then every specification by id
+	template<typename Atlas>
+	bool loadCache(const std::string& sourceFileName, uint64_t sourceHash, Atlas& atlas, texture_list_t& icons) {
+		std::vector<char> data;
+		if (!FileUtils::readFile(sourceFileName + specCacheExtension, data)) return false;
+		BinaryReader reader(data.data(), data.size());
+		uint32_t magic, version, count, iconCount;
+		uint64_t hash;
+		if (!reader.read(magic) || !reader.read(version) || !reader.read(hash) || !reader.read(count) ||
+			magic != specCacheMagic || version != specCacheVersion || hash != sourceHash || count != atlas.size()) {
+			return false;
+		}
+		// Cache written by a build with other ids would put specifications under wrong types
+		const char* const* keys = generatedKeys(atlas);
+		std::string key;
+		for (uint32_t id = 0; id < count; id++) {
+			if (!reader.readString(key) || key != keys[id]) return false;
+		}
+		if (!reader.read(iconCount) || iconCount > reader.remaining()) return false;
+		icons.resize(iconCount);
+		for (auto& icon : icons) {
+			if (!reader.readString(icon.first) || !reader.readString(icon.second)) return false;
+		}
+		Atlas cached{};
+		for (auto& spec : cached) {
+			if (!readSpec(reader, spec)) return false;
+		}
+		atlas = std::move(cached);
+		return true;
+	}
+
+	template<typename Atlas>
+	bool saveCache(const std::string& sourceFileName, uint64_t sourceHash, const Atlas& atlas, const texture_list_t& icons) {
+		std::vector<char> data;
+		BinaryWriter writer(data);
+		writer.write<uint32_t>(specCacheMagic);
+		writer.write<uint32_t>(specCacheVersion);
+		writer.write<uint64_t>(sourceHash);
+		writer.write<uint32_t>(static_cast<uint32_t>(atlas.size()));
+		const char* const* keys = generatedKeys(atlas);
+		for (size_t id = 0; id < atlas.size(); id++) {
+			writer.writeString(keys[id]);
+		}
+		writer.write<uint32_t>(static_cast<uint32_t>(icons.size()));
+		for (const auto& icon : icons) {
+			writer.writeString(icon.first);
+			writer.writeString(icon.second);
+		}
+		for (const auto& spec : atlas) {
+			writeSpec(writer, spec);
+		}
+		return FileUtils::writeFileAtomically(sourceFileName + specCacheExtension, data.data(), data.size());
+	}
+
+}
+
+uint64_t Archipelago::hashSpecSource(const std::vector<char>& source) {
+	return FileUtils::hashData(source.data(), source.size());
+}
+
+bool Archipelago::loadSpecCache(const std::string& sourceFileName, uint64_t sourceHash, wares_atlas_t& atlas, texture_list_t& icons) {
+	return loadCache(sourceFileName, sourceHash, atlas, icons);
+}
+
+bool Archipelago::loadSpecCache(const std::string& sourceFileName, uint64_t sourceHash, natres_atlas_t& atlas, texture_list_t& icons) {
+	return loadCache(sourceFileName, sourceHash, atlas, icons);
+}
+
+bool Archipelago::loadSpecCache(const std::string& sourceFileName, uint64_t sourceHash, buildings_atlas_t& atlas, texture_list_t& icons) {
+	return loadCache(sourceFileName, sourceHash, atlas, icons);
+}
+
+bool Archipelago::saveSpecCache(const std::string& sourceFileName, uint64_t sourceHash, const wares_atlas_t& atlas, const texture_list_t& icons) {
+	return saveCache(sourceFileName, sourceHash, atlas, icons);
+}
+
+bool Archipelago::saveSpecCache(const std::string& sourceFileName, uint64_t sourceHash, const natres_atlas_t& atlas, const texture_list_t& icons) {
+	return saveCache(sourceFileName, sourceHash, atlas, icons);
+}
+
+bool Archipelago::saveSpecCache(const std::string& sourceFileName, uint64_t sourceHash, const buildings_atlas_t& atlas, const texture_list_t& icons) {
+	return saveCache(sourceFileName, sourceHash, atlas, icons);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "asset_registry.h"
+
+namespace Archipelago {
+
+	const char* const specCacheExtension{ ".cache" }; /// cache of a specification file is stored next to it
+	const uint32_t specCacheVersion{ 1 }; /// bump when layout of cached specifications changes
+
+	/// 64-bit FNV-1a of specification file content, the key of its cache
+	uint64_t hashSpecSource(const std::vector<char>& source);
+
+	/** Binary cache of one parsed specification file, so that unchanged files skip JSON parsing.
+	* A cache is valid only for the source hash it was written for and for the ids and keys of spec_ids.h
+	* of this build. Anything else, a truncated file included, reads as a miss and the caller parses the source.
+	* Icons aren't cached as textures: specifications come back without icon handles and their icon files in a list.
+	*/
+	bool loadSpecCache(const std::string& sourceFileName, uint64_t sourceHash, wares_atlas_t& atlas, texture_list_t& icons);
+	bool loadSpecCache(const std::string& sourceFileName, uint64_t sourceHash, natres_atlas_t& atlas, texture_list_t& icons);
+	bool loadSpecCache(const std::string& sourceFileName, uint64_t sourceHash, buildings_atlas_t& atlas, texture_list_t& icons);
+	bool saveSpecCache(const std::string& sourceFileName, uint64_t sourceHash, const wares_atlas_t& atlas, const texture_list_t& icons);
+	bool saveSpecCache(const std::string& sourceFileName, uint64_t sourceHash, const natres_atlas_t& atlas, const texture_list_t& icons);
+	bool saveSpecCache(const std::string& sourceFileName, uint64_t sourceHash, const buildings_atlas_t& atlas, const texture_list_t& icons);
+
+} // namespace Archipelago
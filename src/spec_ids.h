@@ -0,0 +1,32 @@
+// Generated by 'archipelago --generate-spec-ids' from specification files in assets. Don't edit, regenerate
+#pragma once
+
+#include <cstddef>
+
+namespace Archipelago {
+
+	enum class NaturalResourceTypeId { Unknown = 0, FertileSoil = 1, Forest = 2, SaltWater = 3, FreshWater = 4, _Last = FreshWater, _First = FertileSoil };
+	constexpr size_t naturalResourceTypeCount{ 5 }; /// size of tables indexed by NaturalResourceTypeId, Unknown included
+	constexpr NaturalResourceTypeId naturalResourceTypeIds[]{ NaturalResourceTypeId::FertileSoil, NaturalResourceTypeId::Forest, NaturalResourceTypeId::SaltWater, NaturalResourceTypeId::FreshWater }; /// known ids in order, for range-based loops
+	constexpr const char* naturalResourceTypeKeys[]{ "Unknown", "FertileSoil", "Forest", "SaltWater", "FreshWater" };
+	constexpr bool isKnownId(NaturalResourceTypeId id) { return id >= NaturalResourceTypeId::_First && id <= NaturalResourceTypeId::_Last; }
+	static_assert(static_cast<size_t>(NaturalResourceTypeId::_Last) + 1 == naturalResourceTypeCount, "NaturalResourceTypeId ids have gaps");
+	static_assert(sizeof(naturalResourceTypeKeys) / sizeof(naturalResourceTypeKeys[0]) == naturalResourceTypeCount, "naturalResourceTypeKeys doesn't cover every id");
+
+	enum class WaresTypeId { Unknown = 0, People = 1, FreshWater = 2, SaltWater = 3, Crops = 4, Wood = 5, _Last = Wood, _First = People };
+	constexpr size_t waresTypeCount{ 6 }; /// size of tables indexed by WaresTypeId, Unknown included
+	constexpr WaresTypeId waresTypeIds[]{ WaresTypeId::People, WaresTypeId::FreshWater, WaresTypeId::SaltWater, WaresTypeId::Crops, WaresTypeId::Wood }; /// known ids in order, for range-based loops
+	constexpr const char* waresTypeKeys[]{ "Unknown", "People", "FreshWater", "SaltWater", "Crops", "Wood" };
+	constexpr bool isKnownId(WaresTypeId id) { return id >= WaresTypeId::_First && id <= WaresTypeId::_Last; }
+	static_assert(static_cast<size_t>(WaresTypeId::_Last) + 1 == waresTypeCount, "WaresTypeId ids have gaps");
+	static_assert(sizeof(waresTypeKeys) / sizeof(waresTypeKeys[0]) == waresTypeCount, "waresTypeKeys doesn't cover every id");
+
+	enum class BuildingTypeId { Unknown = 0, BaseCamp = 1, Woodcutter = 2, Farm = 3, _Last = Farm, _First = BaseCamp };
+	constexpr size_t buildingTypeCount{ 4 }; /// size of tables indexed by BuildingTypeId, Unknown included
+	constexpr BuildingTypeId buildingTypeIds[]{ BuildingTypeId::BaseCamp, BuildingTypeId::Woodcutter, BuildingTypeId::Farm }; /// known ids in order, for range-based loops
+	constexpr const char* buildingTypeKeys[]{ "Unknown", "BaseCamp", "Woodcutter", "Farm" };
+	constexpr bool isKnownId(BuildingTypeId id) { return id >= BuildingTypeId::_First && id <= BuildingTypeId::_Last; }
+	static_assert(static_cast<size_t>(BuildingTypeId::_Last) + 1 == buildingTypeCount, "BuildingTypeId ids have gaps");
+	static_assert(sizeof(buildingTypeKeys) / sizeof(buildingTypeKeys[0]) == buildingTypeCount, "buildingTypeKeys doesn't cover every id");
+
+} // namespace Archipelago
@@ -0,0 +1,121 @@
+#include <cctype>
+#include <cstdio>
+#include <set>
+#include <vector>
+#include <json.hpp>
+#include "spec_ids_generator.h"
+#include "file_utils.h"
+
+using namespace Archipelago;
+
+namespace {
+
+	/// One specification file and the names generated for it
+	struct SpecIdsSource {
+		const char* fileName;
+		const char* enumName;
+		const char* tablePrefix; // of <prefix>Count, <prefix>Ids and <prefix>Keys
+	};
+
+	const SpecIdsSource specIdsSources[]{
+		{ "assets/natural_resources_specification.json", "NaturalResourceTypeId", "naturalResourceType" },
+		{ "assets/wares_specification.json", "WaresTypeId", "waresType" },
+		{ "assets/buildings_specification.json", "BuildingTypeId", "buildingType" }
+	};
+
+	bool isIdentifier(const std::string& key) {
+		if (key.empty() || key[0] == '_' || std::isdigit(static_cast<unsigned char>(key[0])) || key == "Unknown") return false;
+		for (char c : key) {
+			if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+		}
+		return true;
+	}
+
+	/// Reads keys of one specification file ordered by id, keys[0] is "Unknown"
+	bool readKeys(const SpecIdsSource& source, std::vector<std::string>& keys) {
+		std::vector<char> data;
+		if (!FileUtils::readFile(source.fileName, data)) {
+			std::printf("Can't read specification file '%s'\n", source.fileName);
+			return false;
+		}
+		nlohmann::json specs = nlohmann::json::parse(data.begin(), data.end(), nullptr, false);
+		if (!specs.is_array() || specs.empty()) {
+			std::printf("Specification file '%s' is not a non-empty JSON array\n", source.fileName);
+			return false;
+		}
+		keys.assign(specs.size() + 1, std::string());
+		keys[0] = "Unknown";
+		std::set<std::string> uniqueKeys;
+		for (const nlohmann::json& spec : specs) {
+			if (!spec.is_object() || !spec.count("id") || !spec.count("key") || !spec.at("id").is_number_integer() || !spec.at("key").is_string()) {
+				std::printf("Every specification in '%s' needs an integer \"id\" and a string \"key\"\n", source.fileName);
+				return false;
+			}
+			int id = spec.at("id").get<int>();
+			std::string key = spec.at("key").get<std::string>();
+			if (id < 1 || static_cast<size_t>(id) >= keys.size() || !keys[id].empty()) {
+				std::printf("Ids in '%s' must be 1..%zu without gaps or repeats, found %d\n", source.fileName, specs.size(), id);
+				return false;
+			}
+			if (!isIdentifier(key) || !uniqueKeys.insert(key).second) {
+				std::printf("Key '%s' of id %d in '%s' is not a unique identifier\n", key.c_str(), id, source.fileName);
+				return false;
+			}
+			keys[id] = key;
+		}
+		return true;
+	}
+
+	void appendIds(const SpecIdsSource& source, const std::vector<std::string>& keys, std::string& out) {
+		const std::string enumName(source.enumName), prefix(source.tablePrefix);
+		out += "\tenum class " + enumName + " {";
+		for (size_t id = 0; id < keys.size(); id++) {
+			out += " " + keys[id] + " = " + std::to_string(id) + ",";
+		}
+		out += " _Last = " + keys.back() + ", _First = " + keys[1] + " };\n";
+		out += "\tconstexpr size_t " + prefix + "Count{ " + std::to_string(keys.size()) + " }; /// size of tables indexed by " + enumName + ", Unknown included\n";
+		out += "\tconstexpr " + enumName + " " + prefix + "Ids[]{";
+		for (size_t id = 1; id < keys.size(); id++) {
+			out += (id > 1 ? ", " : " ") + enumName + "::" + keys[id];
+		}
+		out += " }; /// known ids in order, for range-based loops\n";
+		out += "\tconstexpr const char* " + prefix + "Keys[]{";
+		for (size_t id = 0; id < keys.size(); id++) {
+			out += (id > 0 ? ", \"" : " \"") + keys[id] + "\"";
+		}
+		out += " };\n";
+		out += "\tconstexpr bool isKnownId(" + enumName + " id) { return id >= " + enumName + "::_First && id <= " + enumName + "::_Last; }\n";
+		out += "\tstatic_assert(static_cast<size_t>(" + enumName + "::_Last) + 1 == " + prefix + "Count, \"" + enumName + " ids have gaps\");\n";
+		out += "\tstatic_assert(sizeof(" + prefix + "Keys) / sizeof(" + prefix + "Keys[0]) == " + prefix + "Count, \"" + prefix + "Keys doesn't cover every id\");\n\n";
+	}
+
+}
+
+int Archipelago::generateSpecIds(const std::string& fileName) {
+	std::string header =
+		"// Generated by 'archipelago --generate-spec-ids' from specification files in assets. Don't edit, regenerate\n"
+		"#pragma once\n"
+		"\n"
+		"#include <cstddef>\n"
+		"\n"
+		"namespace Archipelago {\n"
+		"\n";
+	for (const SpecIdsSource& source : specIdsSources) {
+		std::vector<std::string> keys;
+		if (!readKeys(source, keys)) return 1;
+		appendIds(source, keys, header);
+	}
+	header += "} // namespace Archipelago\n";
+
+	std::vector<char> current;
+	if (FileUtils::readFile(fileName, current) && std::string(current.begin(), current.end()) == header) {
+		std::printf("'%s' is up to date\n", fileName.c_str());
+		return 0;
+	}
+	if (!FileUtils::writeFileAtomically(fileName, header.data(), header.size())) {
+		std::printf("Can't write '%s'\n", fileName.c_str());
+		return 1;
+	}
+	std::printf("Generated '%s'\n", fileName.c_str());
+	return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace Archipelago {
+
+	const char* const defaultSpecIdsFileName{ "../src/spec_ids.h" }; /// relative to working directory of the game, bin
+
+	/** Generates header with type id enums and dense id tables from specification files in assets.
+	* Every specification needs an "id" and a "key", the identifier of its enum value. Ids of a file must be
+	* 1..N without gaps, so that tables indexed by id have no holes, and keys must be unique identifiers.
+	* The header is only rewritten if its content changes. Returns process exit code.
+	*/
+	int generateSpecIds(const std::string& fileName);
+
+} // namespace Archipelago
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace Archipelago {
+
+	/** Bounded lock-free queue for exactly one producer thread and one consumer thread.
+	* Items are copied into a fixed ring buffer, so neither side ever allocates or blocks.
+	*/
+	template<typename T, size_t Capacity>
+	class SpscQueue {
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be power of two");
+	public:
+		SpscQueue() : _head(0), _tail(0) {};
+		SpscQueue(const SpscQueue&) = delete;
+		/// Producer only, returns false if queue is full
+		bool push(const T& item) {
+			size_t tail = _tail.load(std::memory_order_relaxed);
+			if (tail - _head.load(std::memory_order_acquire) == Capacity) return false;
+			_items[tail & (Capacity - 1)] = item;
+			_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+		/// Consumer only, returns false if queue is empty
+		bool pop(T& item) {
+			size_t head = _head.load(std::memory_order_relaxed);
+			if (head == _tail.load(std::memory_order_acquire)) return false;
+			item = _items[head & (Capacity - 1)];
+			_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+	private:
+		T _items[Capacity];
+		alignas(64) std::atomic<size_t> _head; // next item to pop, written by consumer
+		alignas(64) std::atomic<size_t> _tail; // next free slot, written by producer
+	};
+
+} // namespace Archipelago
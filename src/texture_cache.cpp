@@ -0,0 +1,91 @@
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include "texture_cache.h"
+#include "binary_stream.h"
+#include "file_utils.h"
+#include "lz_codec.h"
+
+namespace Archipelago {
+
+	extern const std::string& loggerName;
+
+	const uint32_t textureCacheMagic{ 0x43585441 }; /// "ATXC"
+	const size_t textureCacheTimeOffset{ 2 * sizeof(uint32_t) }; /// source modification time follows magic and version
+
+}
+
+using namespace Archipelago;
+
+namespace {
+
+	/// Cache layout: magic, version, source modification time, source hash, width, height, then compressed pixels
+	struct TextureCacheHeader {
+		int64_t modificationTime;
+		uint64_t sourceHash;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	bool readHeader(BinaryReader& reader, TextureCacheHeader& header) {
+		uint32_t magic, version;
+		return reader.read(magic) && reader.read(version) && magic == textureCacheMagic && version == textureCacheVersion &&
+			reader.read(header.modificationTime) && reader.read(header.sourceHash) && reader.read(header.width) && reader.read(header.height);
+	}
+
+	bool decodePixels(const BinaryReader& reader, const TextureCacheHeader& header, std::vector<char>& pixels, sf::Image& image) {
+		pixels.resize(static_cast<size_t>(header.width) * header.height * 4);
+		if (pixels.empty() || !LzCodec::decompress(reader.current(), reader.remaining(), pixels.data(), pixels.size())) return false;
+		image.create(header.width, header.height, reinterpret_cast<const sf::Uint8*>(pixels.data()));
+		return true;
+	}
+
+	void saveCache(const std::string& cacheFileName, int64_t modificationTime, uint64_t sourceHash, const sf::Image& image) {
+		std::vector<char> compressed;
+		size_t pixelsSize = static_cast<size_t>(image.getSize().x) * image.getSize().y * 4;
+		LzCodec::compress(reinterpret_cast<const char*>(image.getPixelsPtr()), pixelsSize, compressed);
+		std::vector<char> data;
+		BinaryWriter writer(data);
+		writer.write<uint32_t>(textureCacheMagic);
+		writer.write<uint32_t>(textureCacheVersion);
+		writer.write<int64_t>(modificationTime);
+		writer.write<uint64_t>(sourceHash);
+		writer.write<uint32_t>(image.getSize().x);
+		writer.write<uint32_t>(image.getSize().y);
+		writer.writeBytes(compressed.data(), compressed.size());
+		if (!FileUtils::writeFileAtomically(cacheFileName, data.data(), data.size())) {
+			spdlog::get(loggerName)->warn("Can't write texture cache '{}'", cacheFileName);
+		}
+	}
+
+}
+
+bool Archipelago::loadCachedImage(const std::string& fileName, sf::Image& image) {
+	std::string cacheFileName = fileName + textureCacheExtension;
+	int64_t modificationTime = 0;
+	FileUtils::getModificationTime(fileName, modificationTime);
+	std::vector<char> cache, pixels;
+	TextureCacheHeader header{};
+	bool hasCache = false;
+	if (FileUtils::readFile(cacheFileName, cache)) {
+		BinaryReader reader(cache.data(), cache.size());
+		hasCache = readHeader(reader, header);
+		// Fast path: source wasn't touched since the cache was written, it isn't even read
+		if (hasCache && header.modificationTime == modificationTime && decodePixels(reader, header, pixels, image)) return true;
+	}
+	std::vector<char> source;
+	if (!FileUtils::readFile(fileName, source)) return false;
+	uint64_t sourceHash = FileUtils::hashData(source.data(), source.size());
+	if (hasCache && header.sourceHash == sourceHash) {
+		BinaryReader reader(cache.data(), cache.size());
+		readHeader(reader, header);
+		if (decodePixels(reader, header, pixels, image)) {
+			// Content is the same, only the time moved: remember new time so next load takes the fast path
+			std::memcpy(cache.data() + textureCacheTimeOffset, &modificationTime, sizeof(modificationTime));
+			FileUtils::writeFileAtomically(cacheFileName, cache.data(), cache.size());
+			return true;
+		}
+	}
+	if (!image.loadFromMemory(source.data(), source.size())) return false;
+	saveCache(cacheFileName, modificationTime, sourceHash, image);
+	return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <SFML/Graphics/Image.hpp>
+
+namespace Archipelago {
+
+	const char* const textureCacheExtension{ ".cache" }; /// cache of an image file is stored next to it
+	const uint32_t textureCacheVersion{ 1 }; /// bump when layout of cached images changes
+
+	/** Decodes image file through a cache of its decoded RGBA pixels, LZ compressed, so that loading an
+	* unchanged image costs a file read and a copy loop instead of PNG decoding.
+	* Cache is keyed by modification time of the source, and by hash of its content when the time moved:
+	* a file which was only touched keeps its cache. Any other mismatch decodes the source and rewrites the cache.
+	* Safe to call on worker threads for different files.
+	*/
+	bool loadCachedImage(const std::string& fileName, sf::Image& image);
+
+} // namespace Archipelago
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Archipelago {
+
+	/// Index of a texture in the registry, resolved from asset name once when registering. Handles stay valid while textures come and go
+	typedef uint32_t TextureHandle;
+	const TextureHandle noTextureHandle{ ~0u };
+
+} // namespace Archipelago
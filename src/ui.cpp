@@ -33,7 +33,7 @@ void Ui::update(float seconds)
 {
 	_timeSincelastFpsUpdate += seconds;
 	if (_timeSincelastFpsUpdate > _fpsUpdateInterval) {
-		std::dynamic_pointer_cast<sfg::Label>(_uiBottomStatusBar->GetWidgetById(UI_BOTTOM_STATUSBAR_LABEL_ID))->SetText(_game->getStatusString());
+		_statusLabel->SetText(_game->getStatusString());
 		_timeSincelastFpsUpdate = 0;
 	}
 
@@ -41,14 +41,13 @@ void Ui::update(float seconds)
 }
 
 void Ui::updateSettlementWares() {
-	for (unsigned int wareIndex = 0; wareIndex < _game->getSettlementWaresNumber(); wareIndex++) {
-		auto s = UI_TOP_STATUSBAR_GOODS_LABEL_ID + std::to_string(wareIndex);
-		std::dynamic_pointer_cast<sfg::Label>(_uiTopStatusBar->GetWidgetById(s))->SetText(std::to_string(_game->getWareAmount(wareIndex)));
+	for (unsigned int wareIndex = 0; wareIndex < _wareAmountLabels.size(); wareIndex++) {
+		_wareAmountLabels[wareIndex]->SetText(std::to_string(_game->getWareAmount(wareIndex)));
 	};
 }
 
 void Ui::updateGameTimeString() {
-	std::dynamic_pointer_cast<sfg::Label>(_uiTopStatusBar->GetWidgetById(UI_TOP_STATUSBAR_GAME_TIME_LABEL_ID))->SetText(_game->composeGameTimeString());
+	_gameTimeLabel->SetText(_game->composeGameTimeString().c_str());
 }
 
 void Ui::handleEvent(const sf::Event& event)
@@ -85,6 +84,7 @@ void Ui::_constructTopStatusBar() {
 	_uiTopStatusBar->SetStyle(sfg::Window::BACKGROUND);
 	auto currentGameTimeLabel = sfg::Label::Create();
 	currentGameTimeLabel->SetId(UI_TOP_STATUSBAR_GAME_TIME_LABEL_ID);
+	_gameTimeLabel = currentGameTimeLabel;
 	auto mainBox = sfg::Box::Create(sfg::Box::Orientation::HORIZONTAL, 0.0f);
 	auto waresBox = sfg::Box::Create(sfg::Box::Orientation::HORIZONTAL, 0.0f);
 	waresBox->SetSpacing(10.0f);
@@ -94,6 +94,7 @@ void Ui::_constructTopStatusBar() {
 		auto spacer = sfg::Label::Create("  ");
 		waresAmountText->SetAlignment(sf::Vector2f(0.0f, 0.5f));
 		waresAmountText->SetId(UI_TOP_STATUSBAR_GOODS_LABEL_ID + std::to_string(wareIndex));
+		_wareAmountLabels.push_back(waresAmountText);
 		waresBox->Pack(wareIcon, false, true);
 		waresBox->Pack(waresAmountText, false, true);
 		waresBox->Pack(spacer, false, true);
@@ -109,6 +110,7 @@ void Ui::_constructBottomStatusBar() {
 	_uiBottomStatusBar->SetStyle(sfg::Window::BACKGROUND);
 	auto _uiBottomStatusBarLabel = sfg::Label::Create();
 	_uiBottomStatusBarLabel->SetId(UI_BOTTOM_STATUSBAR_LABEL_ID);
+	_statusLabel = _uiBottomStatusBarLabel;
 	_uiBottomStatusBar->Add(_uiBottomStatusBarLabel);
 	_uiDesktop->Add(_uiBottomStatusBar);
 }
@@ -124,10 +126,9 @@ void Ui::_constructMainInterfaceWindow() {
 	auto gamePtr = _game;
 	_constructBuildingTipWindow();
 	auto bldWindow = _uiBuildingTipWindow.get();
-	BuildingSpecification bs;
-	for (BuildingTypeId bldId = BuildingTypeId::_First; bldId <= BuildingTypeId::_Last; bldId = static_cast<BuildingTypeId>(std::underlying_type<BuildingTypeId>::type(bldId) + 1)) {
-		bs = _game->getAssetRegistry().getBuildingSpecification(bldId);
-		buildingIconImg = bs.icon->copyToImage();
+	for (BuildingTypeId bldId : buildingTypeIds) {
+		const BuildingSpecification& bs = _game->getAssetRegistry().getBuildingSpecification(bldId);
+		buildingIconImg = _game->getAssetRegistry().getTexture(bs.icon)->copyToImage();
 		buildingBox = sfg::Box::Create(sfg::Box::Orientation::HORIZONTAL, 10.0f);
 		buildingBox->Pack(sfg::Image::Create(buildingIconImg), false);
 		buildingBox->Pack(sfg::Label::Create(bs.name), false);
@@ -36,6 +36,9 @@ namespace Archipelago {
 		sfg::Window::Ptr _uiMainInterfaceWindow;
 		std::unique_ptr<UiTerrainInfoWindow> _uiTerrainInfoWindow;
 		std::unique_ptr<UiBuildingTipWindow> _uiBuildingTipWindow;
+		sfg::Label::Ptr _statusLabel;
+		sfg::Label::Ptr _gameTimeLabel;
+		std::vector<sfg::Label::Ptr> _wareAmountLabels; // cached to avoid widget lookups by composed string IDs
 		float _fpsUpdateInterval; // seconds
 		float _timeSincelastFpsUpdate; // seconds
 	};
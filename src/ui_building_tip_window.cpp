@@ -32,7 +32,7 @@ void UiBuildingTipWindow::_show(bool show) {
 		_window->Show(false);
 		return;
 	}
-	BuildingSpecification bs = _game->getAssetRegistry().getBuildingSpecification(_buildingId);
+	const BuildingSpecification& bs = _game->getAssetRegistry().getBuildingSpecification(_buildingId);
 	_window->RemoveAll();
 	_window->SetTitle(bs.name);
 	_window->SetPosition(sf::Vector2f(sf::Mouse::getPosition(_game->getRenderWindow())) + sf::Vector2f(1.3f * _game->getMouseSprite().getTexture()->getSize().x, 0));
@@ -53,25 +53,32 @@ void UiBuildingTipWindow::_show(bool show) {
 	resNeedsLabel->SetZOrder(BaseZOrder + 1);
 	rootLayoutBox->Pack(resNeedsLabel);
 
+	if (bs.workers > 0) {
+		auto workersLabel = sfg::Label::Create("Workers: " + std::to_string(bs.workers));
+		workersLabel->SetAlignment({ 0.0f, 0.0f });
+		workersLabel->SetZOrder(BaseZOrder + 1);
+		rootLayoutBox->Pack(workersLabel);
+	}
+
 	auto waresNeedsLabel = sfg::Label::Create("Required wares:");
 	waresNeedsLabel->SetAlignment({ 0.0f, 0.0f });
 	waresNeedsLabel->SetZOrder(BaseZOrder + 1);
 	rootLayoutBox->Pack(waresNeedsLabel);
 
-	auto wares = bs.waresRequired;
+	const std::vector<WaresStack>& wares = bs.waresRequired;
 	if (wares.size() == 0) {
 		waresNeedsLabel = sfg::Label::Create("None");
 		waresNeedsLabel->SetAlignment({ 0.0f, 0.0f });
 		waresNeedsLabel->SetZOrder(BaseZOrder + 1);
 		rootLayoutBox->Pack(waresNeedsLabel);
 	}
-	for (WaresStack ware : wares) {
-		WaresSpecification wareSpec = _game->getAssetRegistry().getWaresSpecification(ware.type);
+	for (const WaresStack& ware : wares) {
+		const WaresSpecification& wareSpec = _game->getAssetRegistry().getWaresSpecification(ware.type);
 		int amount = ware.amount;
 		auto wareHLayoutBox = sfg::Box::Create(sfg::Box::Orientation::HORIZONTAL, 10.0f);
 
 		auto wareIcon = sfg::Image::Create();
-		wareIcon->SetImage(wareSpec.icon->copyToImage());
+		wareIcon->SetImage(_game->getAssetRegistry().getTexture(wareSpec.icon)->copyToImage());
 		wareIcon->SetZOrder(BaseZOrder + 1);
 		wareIcon->SetAlignment({ 0.0f, 0.0f });
 		wareHLayoutBox->Pack(wareIcon, false);
@@ -81,7 +88,7 @@ void UiBuildingTipWindow::_show(bool show) {
 		wareAmountLabel->SetAlignment({ 0.0f, 0.0f });
 		wareHLayoutBox->Pack(wareAmountLabel, false);
 
-		if (!_game->settlementHasWareForBuilding(bs, ware.type)) {
+		if (!_game->getSettlement(playerSettlementId).hasWareForBuilding(bs, ware.type)) {
 			auto warnIcon = sfg::Image::Create();
 			warnIcon->SetImage(_game->getAssetRegistry().getTexture("triangle_atention")->copyToImage());
 			warnIcon->SetZOrder(BaseZOrder + 1);
@@ -92,6 +99,22 @@ void UiBuildingTipWindow::_show(bool show) {
 		rootLayoutBox->Pack(wareHLayoutBox);
 	}
 
+	// Forecast is computed from the economy model, the simulation doesn't run ahead for it
+	unsigned int monthsUntilAffordable = _game->forecastMonthsUntilAffordable(bs);
+	if (monthsUntilAffordable > 0) {
+		std::string eta;
+		if (monthsUntilAffordable == noForecast) {
+			eta = "Not affordable within " + std::to_string(forecastHorizonDefault / 12) + " years at current production";
+		}
+		else {
+			eta = "Affordable in " + std::to_string(monthsUntilAffordable) + (monthsUntilAffordable == 1 ? " month" : " months");
+		}
+		auto etaLabel = sfg::Label::Create(eta);
+		etaLabel->SetAlignment({ 0.0f, 0.0f });
+		etaLabel->SetZOrder(BaseZOrder + 1);
+		rootLayoutBox->Pack(etaLabel);
+	}
+
 	_isShown = true;
 	_window->Show(true);
 	_window->SetZOrder(BaseZOrder);
@@ -34,8 +34,9 @@ void UiTerrainInfoWindow::receive(ECS::World* world, const TerrainInfoWindowData
 
 	tileInfoBox->Pack(_hTileSprite, false);
 	tileInfoBox->Pack(_hTileName, false);
-	sf::Image img = (event.tileSprite->getTexture())->copyToImage();
-	_hTileSprite->SetImage(img);
+	if (event.tileTexture) {
+		_hTileSprite->SetImage(event.tileTexture->copyToImage());
+	}
 	_hTileName->SetText(event.name);
 	
 	if (event.tileType == TileType::BUILDING) {
@@ -87,13 +88,15 @@ void UiTerrainInfoWindow::_addTerrainInfoLayout(sfg::Box::Ptr rootLayoutWidget,
 		int numWares = 1;
 		NaturalResourceTypeId natresType = static_cast<NaturalResourceTypeId>((resourceSet & mask) >> (g * 8));
 		mask = mask << 8;
-		if ((natresType >= NaturalResourceTypeId::_First) && (natresType <= NaturalResourceTypeId::_Last)) {
+		if (isKnownId(natresType)) {
 			auto natresImage = sfg::Image::Create();
 			auto natresName = sfg::Label::Create();
 			auto natresHBox = sfg::Box::Create(sfg::Box::Orientation::HORIZONTAL, 10.0f);
 			rootLayoutWidget->Pack(natresHBox);
-			sf::Image i = _game->getAssetRegistry().getNatresSpecification(natresType).icon->copyToImage();
-			natresImage->SetImage(i);
+			const sf::Texture* icon = _game->getAssetRegistry().getTexture(_game->getAssetRegistry().getNatresSpecification(natresType).icon);
+			if (icon) {
+				natresImage->SetImage(icon->copyToImage());
+			}
 			natresImage->SetAlignment(sf::Vector2f(0.0f, 0.0f));
 			natresHBox->Pack(natresImage);
 			natresName->SetText(_game->getAssetRegistry().getNatresSpecification(natresType).name);
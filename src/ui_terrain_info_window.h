@@ -20,7 +20,7 @@ namespace Archipelago {
 		bool show;
 		sf::Vector2f position;
 		TileType tileType;
-		sf::Sprite* tileSprite;
+		const sf::Texture* tileTexture; // of tile or building, null if it can't be loaded
 		std::string name; // Name of terrain tile or building
 		std::string buildingDescription; // If BUILDING, then this value contains description of building
 		const std::vector<WaresStack>* production; // If BUILDING, then this value contains produced wares
@@ -2,16 +2,14 @@
 #define RESOURCE_H
 
 #include <string>
-
-class sf::Texture;
+#include "spec_ids.h"
+#include "texture_handle.h"
 
 namespace Archipelago {
 
-	enum class WaresTypeId { Unknown = 0, People = 1, FreshWater = 2, SaltWater = 3, Crops = 4, Wood = 5, _Last = Wood, _First = People };
-
 	struct WaresSpecification {
 		std::string name;
-		sf::Texture* icon; // non-owning pointer
+		TextureHandle icon{ noTextureHandle }; // loaded on first use
 	};
 
 	struct WaresStack {